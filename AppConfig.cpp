@@ -0,0 +1,407 @@
+#include "AppConfig.h"
+
+#include <cstdlib>
+#include <sstream>
+
+static bool ParseInt(const std::string& text, int minValue, int maxValue, int& value)
+{
+    char* end = nullptr;
+    const long parsed = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || parsed < minValue || parsed > maxValue)
+    {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+static bool ParseDouble(const std::string& text, double minValue, double maxValue, double& value)
+{
+    char* end = nullptr;
+    const double parsed = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0' || !(parsed >= minValue && parsed <= maxValue))
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+static bool ParseSize(const std::string& text, int maxSize, int& width, int& height)
+{
+    const size_t split = text.find('x');
+    return split != std::string::npos &&
+           ParseInt(text.substr(0, split), 16, maxSize, width) &&
+           ParseInt(text.substr(split + 1), 16, maxSize, height);
+}
+
+// "role:setting" for the per-thread placement options.
+static bool ParseRoleValue(const std::string& text, ThreadRole& role, std::string& setting)
+{
+    const size_t split = text.find(':');
+    if (split == std::string::npos || !ParseThreadRole(text.substr(0, split), role))
+    {
+        return false;
+    }
+    setting = text.substr(split + 1);
+    return true;
+}
+
+static bool ParseSwitch(const std::string& text, bool& value)
+{
+    if (text == "on")
+        value = true;
+    else if (text == "off")
+        value = false;
+    else
+        return false;
+    return true;
+}
+
+const char* TransferModeName(TransferMode mode)
+{
+    return mode == TransferMode::Cpu ? "cpu" : "interop";
+}
+
+const char* GLProfileName(GLProfile profile)
+{
+    switch (profile)
+    {
+    case GLProfile::Compatibility: return "compat";
+    case GLProfile::Core:          return "core";
+    default:                       return "legacy";
+    }
+}
+
+bool ParseTransferMode(const std::string& name, TransferMode& mode)
+{
+    if (name == "interop")
+        mode = TransferMode::Interop;
+    else if (name == "cpu")
+        mode = TransferMode::Cpu;
+    else
+        return false;
+    return true;
+}
+
+bool ParseFrameFormat(const std::string& name, FrameFormat& format)
+{
+    if (name == "rgba8")
+        format = FrameFormat::Rgba8;
+    else if (name == "bgra8")
+        format = FrameFormat::Bgra8;
+    else if (name == "rgb10a2")
+        format = FrameFormat::Rgb10A2;
+    else if (name == "rgba16f")
+        format = FrameFormat::Rgba16F;
+    else if (name == "nv12")
+        format = FrameFormat::Nv12;
+    else if (name == "i420")
+        format = FrameFormat::I420;
+    else
+        return false;
+    return true;
+}
+
+bool ParseProducerBackend(const std::string& name, ProducerBackend& producer)
+{
+    if (name == "d3d11")
+        producer = ProducerBackend::D3D11;
+    else if (name == "software")
+        producer = ProducerBackend::Software;
+    else
+        return false;
+    return true;
+}
+
+const char* CommandLineUsage()
+{
+    return
+        "Usage: SharedResource [options]\n"
+        "\n"
+        "-transfer auto|interop|cpu  -producer d3d11|software  -instances N\n"
+        "-format rgba8|bgra8|rgb10a2|rgba16f|nv12|i420  -srgb on|off\n"
+        "-srgb-convert none|to-linear|to-srgb\n"
+        "-canvas WxH  -tile-size N  -tile-stats <file>\n"
+        "-target-size WxH  -scale-filter box|lanczos\n"
+        "-gl-profile legacy|compat|core  -gl-no-error on|off\n"
+        "-parallel-init on|off  -startup-log <file>  -probe-cache <file>\n"
+        "-job-threads N  -affinity render|worker:<cpu list>\n"
+        "-priority render|worker:normal|high|realtime  -numa any|local|N\n"
+        "-frames-in-flight N  -max-fps N  -frame-queue fifo|mailbox|bounded  -frame-max-age MS\n"
+        "-dynamic-res MS  -dynamic-res-min PERCENT\n"
+        "-hud on|off  -lock-log <file>  -lock-budget MS\n"
+        "-trace <file.json>  -latency <file>  -stats <file[.json]>  -baseline <file.csv>\n"
+        "-bench context|copy|matrix|pipeline|placement|raster|scale|srgb  -bench-frames N";
+}
+
+bool ParseCommandLine(const char* cmdLine, AppConfig& config)
+{
+    if (!cmdLine)
+    {
+        return true;
+    }
+
+    std::istringstream args(cmdLine);
+    std::string option;
+    while (args >> option)
+    {
+        std::string value;
+        if (!(args >> value))
+        {
+            return false;
+        }
+
+        if (option == "-transfer")
+        {
+            config.transferAuto = value == "auto";
+            if (!config.transferAuto && !ParseTransferMode(value, config.transfer))
+                return false;
+        }
+        else if (option == "-format")
+        {
+            if (!ParseFrameFormat(value, config.frameFormat))
+                return false;
+        }
+        else if (option == "-srgb")
+        {
+            if (!ParseSwitch(value, config.srgb))
+                return false;
+        }
+        else if (option == "-srgb-convert")
+        {
+            if (value == "none")
+                config.srgbConvert = SrgbConversion::None;
+            else if (value == "to-linear")
+                config.srgbConvert = SrgbConversion::ToLinear;
+            else if (value == "to-srgb")
+                config.srgbConvert = SrgbConversion::ToSrgb;
+            else
+                return false;
+        }
+        else if (option == "-gl-profile")
+        {
+            if (value == "legacy")
+                config.glContext.profile = GLProfile::Legacy;
+            else if (value == "compat")
+                config.glContext.profile = GLProfile::Compatibility;
+            else if (value == "core")
+                config.glContext.profile = GLProfile::Core;
+            else
+                return false;
+        }
+        else if (option == "-gl-no-error")
+        {
+            if (!ParseSwitch(value, config.glContext.noError))
+                return false;
+        }
+        else if (option == "-parallel-init")
+        {
+            if (!ParseSwitch(value, config.parallelInit))
+                return false;
+        }
+        else if (option == "-startup-log")
+        {
+            config.startupLogPath = value;
+        }
+        else if (option == "-probe-cache")
+        {
+            config.probeCachePath = value;
+        }
+        else if (option == "-job-threads")
+        {
+            if (!ParseInt(value, 0, 64, config.jobThreads))
+                return false;
+        }
+        else if (option == "-frames-in-flight")
+        {
+            if (!ParseInt(value, 1, kMaxFramesInFlight, config.framesInFlight))
+                return false;
+        }
+        else if (option == "-max-fps")
+        {
+            if (!ParseInt(value, 0, 1000, config.maxFps))
+                return false;
+        }
+        else if (option == "-dynamic-res")
+        {
+            if (!ParseDouble(value, 0.0, 1000.0, config.resolutionBudgetMs))
+                return false;
+        }
+        else if (option == "-dynamic-res-min")
+        {
+            if (!ParseInt(value, 25, 100, config.minResolutionPercent))
+                return false;
+        }
+        else if (option == "-frame-queue")
+        {
+            if (value == "fifo")
+                config.queuePolicy = QueuePolicy::Fifo;
+            else if (value == "mailbox")
+                config.queuePolicy = QueuePolicy::Mailbox;
+            else if (value == "bounded")
+                config.queuePolicy = QueuePolicy::BoundedLatency;
+            else
+                return false;
+        }
+        else if (option == "-frame-max-age")
+        {
+            if (!ParseInt(value, 1, 1000, config.queueMaxAgeMs))
+                return false;
+        }
+        else if (option == "-bench")
+        {
+            config.benchmark = value;
+        }
+        else if (option == "-trace")
+        {
+            config.tracePath = value;
+        }
+        else if (option == "-latency")
+        {
+            config.latencyPath = value;
+        }
+        else if (option == "-stats")
+        {
+            config.statsPath = value;
+        }
+        else if (option == "-baseline")
+        {
+            config.baselinePath = value;
+        }
+        else if (option == "-bench-frames")
+        {
+            if (!ParseInt(value, 1, 100000, config.benchFrames))
+                return false;
+        }
+        else if (option == "-hud")
+        {
+            if (!ParseSwitch(value, config.hud))
+                return false;
+        }
+        else if (option == "-lock-log")
+        {
+            config.lockLogPath = value;
+        }
+        else if (option == "-lock-budget")
+        {
+            if (!ParseInt(value, 1, 60000, config.lockBudgetMs))
+                return false;
+        }
+        else if (option == "-producer")
+        {
+            if (!ParseProducerBackend(value, config.producer))
+                return false;
+        }
+        else if (option == "-instances")
+        {
+            if (!ParseInt(value, 1, 1 << 20, config.instances))
+                return false;
+        }
+        else if (option == "-target-size")
+        {
+            if (!ParseSize(value, kMaxTextureSize, config.targetWidth, config.targetHeight))
+                return false;
+        }
+        else if (option == "-canvas")
+        {
+            if (!ParseSize(value, kMaxCanvasSize, config.canvasWidth, config.canvasHeight))
+                return false;
+        }
+        else if (option == "-tile-size")
+        {
+            if (!ParseInt(value, 256, kMaxTextureSize, config.tileSize))
+                return false;
+        }
+        else if (option == "-tile-stats")
+        {
+            config.tileStatsPath = value;
+        }
+        else if (option == "-affinity" || option == "-priority")
+        {
+            ThreadRole role;
+            std::string setting;
+            if (!ParseRoleValue(value, role, setting))
+                return false;
+            ThreadPlacement& placement = config.threads[static_cast<int>(role)];
+            if (option == "-affinity" ? !ParseCpuList(setting, placement.cpus)
+                                      : !ParseThreadPriority(setting, placement.priority))
+                return false;
+        }
+        else if (option == "-numa")
+        {
+            if (value == "any")
+                config.numaNode = kNumaNodeAny;
+            else if (value == "local")
+                config.numaNode = kNumaNodeLocal;
+            else if (!ParseInt(value, 0, 63, config.numaNode))
+                return false;
+        }
+        else if (option == "-scale-filter")
+        {
+            if (value == "box")
+                config.scaleFilter = ScaleFilter::Box;
+            else if (value == "lanczos")
+                config.scaleFilter = ScaleFilter::Lanczos3;
+            else
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Only the 8-bit formats have sRGB variants, the rasterizer and the
+    // resampler work on 8-bit RGBA, and YUV is always converted from RGBA8.
+    const bool eightBit = config.frameFormat == FrameFormat::Rgba8 || config.frameFormat == FrameFormat::Bgra8;
+    if ((config.srgb && !eightBit) ||
+        (config.srgbConvert != SrgbConversion::None && IsYuvFormat(config.frameFormat)))
+    {
+        return false;
+    }
+    if (config.producer == ProducerBackend::Software && config.frameFormat != FrameFormat::Rgba8 &&
+        !IsYuvFormat(config.frameFormat))
+    {
+        return false;
+    }
+
+    if (IsYuvFormat(config.frameFormat) || config.producer == ProducerBackend::Software ||
+        config.srgbConvert != SrgbConversion::None)
+    {
+        config.transfer = TransferMode::Cpu;
+        config.transferAuto = false;
+    }
+    if (config.transfer == TransferMode::Cpu && !CpuTransferSupported(config))
+    {
+        return false;
+    }
+    return true;
+}
+
+void ResolveTargetSize(const AppConfig& config, int& width, int& height)
+{
+    const int canvasWidth = config.canvasWidth > 0 ? config.canvasWidth : kDefaultCanvasSize;
+    const int canvasHeight = config.canvasHeight > 0 ? config.canvasHeight : kDefaultCanvasSize;
+    const int maxWidth = config.targetWidth > 0 ? config.targetWidth : kDefaultCanvasSize;
+    const int maxHeight = config.targetHeight > 0 ? config.targetHeight : kDefaultCanvasSize;
+    width = canvasWidth < maxWidth ? canvasWidth : maxWidth;
+    height = canvasHeight < maxHeight ? canvasHeight : maxHeight;
+}
+
+bool CpuTransferSupported(const AppConfig& config)
+{
+    // The resampler only handles 8-bit RGBA (YUV is converted from it), so a
+    // frame delivered smaller than the canvas, whether from -target-size or
+    // the default window cap, needs one of those formats. Only the interop
+    // path can tile a canvas over several textures.
+    int targetWidth = 0;
+    int targetHeight = 0;
+    ResolveTargetSize(config, targetWidth, targetHeight);
+    const int canvasWidth = config.canvasWidth > 0 ? config.canvasWidth : kDefaultCanvasSize;
+    const int canvasHeight = config.canvasHeight > 0 ? config.canvasHeight : kDefaultCanvasSize;
+    const bool scaled = targetWidth != canvasWidth || targetHeight != canvasHeight;
+    const bool eightBit = config.frameFormat == FrameFormat::Rgba8 || config.frameFormat == FrameFormat::Bgra8;
+    return (!scaled || eightBit || IsYuvFormat(config.frameFormat)) &&
+           canvasWidth <= kMaxTextureSize && canvasHeight <= kMaxTextureSize;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+
+#include "VideoFrame.h"
+#include "FrameScale.h"
+#include "SrgbConvert.h"
+#include "GLContextOptions.h"
+#include "ThreadPlacement.h"
+#include "FrameQueue.h"
+
+// D3D11 texture dimension limit (feature level 11), and the canvas limit set
+// by D3D11 viewport bounds (a tile's viewport reaches across the canvas).
+const int kMaxTextureSize = 16384;
+const int kMaxCanvasSize = 32767;
+
+// The canvas without -canvas, and the largest consumer window by default.
+const int kDefaultCanvasSize = 1024;
+
+const int kMaxFramesInFlight = 4;
+
+enum class TransferMode
+{
+    Interop,
+    Cpu,
+};
+
+enum class ProducerBackend
+{
+    D3D11,
+    Software,
+};
+
+struct AppConfig
+{
+    TransferMode transfer = TransferMode::Interop;
+    bool transferAuto = true;   // probe interop at startup, fall back to cpu
+    ProducerBackend producer = ProducerBackend::D3D11;
+    int instances = 1;
+    int canvasWidth = 0;    // 0: the default 1024x1024 source
+    int canvasHeight = 0;
+    int tileSize = 0;       // 0: kMaxTextureSize, capped by GL_MAX_TEXTURE_SIZE
+    std::string tileStatsPath;
+    int targetWidth = 0;    // 0: the canvas, at most kDefaultCanvasSize
+    int targetHeight = 0;
+    ScaleFilter scaleFilter = ScaleFilter::Box;
+    FrameFormat frameFormat = FrameFormat::Rgba8;
+    bool srgb = false;      // sRGB variant of the shared texture (rgba8/bgra8)
+    SrgbConversion srgbConvert = SrgbConversion::None;
+    int jobThreads = 0;     // JobSystem threads incl. the render thread; 0: all cores
+    int framesInFlight = 1; // 1: the serial loop; more: the coroutine pipeline
+    int maxFps = 0;         // frame pacing; 0: frames back to back
+    double resolutionBudgetMs = 0.0;    // producer budget; 0: always full size
+    int minResolutionPercent = 50;      // per axis
+    QueuePolicy queuePolicy = QueuePolicy::Fifo;    // with -frames-in-flight 2+
+    int queueMaxAgeMs = 50;                         // QueuePolicy::BoundedLatency
+    std::string benchmark;
+    std::string tracePath;
+    std::string latencyPath;
+    std::string statsPath;
+    std::string baselinePath;
+    int benchFrames = 60;
+    bool hud = false;
+    std::string lockLogPath;
+    int lockBudgetMs = 100;
+    GLContextOptions glContext;
+    bool parallelInit = true;
+    std::string startupLogPath;
+    std::string probeCachePath = "transfer_probe.txt";
+    ThreadPlacement threads[static_cast<int>(ThreadRole::Count)];
+    int numaNode = kNumaNodeAny;    // frame buffers; or kNumaNodeLocal
+};
+
+const char* TransferModeName(TransferMode mode);
+bool ParseTransferMode(const std::string& name, TransferMode& mode);
+bool ParseFrameFormat(const std::string& name, FrameFormat& format);
+bool ParseProducerBackend(const std::string& name, ProducerBackend& producer);
+
+// Every option and its values, one group per line; shown when parsing fails.
+const char* CommandLineUsage();
+
+// Parses the options listed by CommandLineUsage(); "-affinity" and
+// "-priority" are repeatable, one role each. YUV formats, sRGB conversion
+// and the software producer only exist on the CPU path, so they imply
+// "-transfer cpu". sRGB conversion needs a packed
+// format, "-srgb" and CPU-side resampling need an 8-bit one, and the
+// software producer renders rgba8 (or YUV from it). Canvases larger than
+// one texture are tiled, which only the interop path can deliver.
+bool ParseCommandLine(const char* cmdLine, AppConfig& config);
+
+// The consumer's frame size: -target-size (no larger than the canvas), or
+// else the canvas capped at kDefaultCanvasSize per axis.
+void ResolveTargetSize(const AppConfig& config, int& width, int& height);
+
+// Whether the CPU path can deliver this configuration (the fallback target
+// of "-transfer auto").
+bool CpuTransferSupported(const AppConfig& config);
@@ -0,0 +1,243 @@
+#include "BenchmarkMatrix.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "FrameAllocator.h"
+#include "FrameCopy.h"
+#include "YuvConvert.h"
+
+namespace
+{
+    // Fills the source like a rendered frame so conversion work is realistic.
+    // |width| counts 4-byte groups, so wider packed formats are filled too.
+    void FillTestPattern(uint8_t* rgba, size_t pitch, int width, int height)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = rgba + y * pitch;
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 4 + 0] = static_cast<uint8_t>(x);
+                row[x * 4 + 1] = static_cast<uint8_t>(y);
+                row[x * 4 + 2] = static_cast<uint8_t>(x ^ y);
+                row[x * 4 + 3] = 0xFF;
+            }
+        }
+    }
+
+    BenchResult RunCpuCell(const BenchCell& cell, int warmupFrames, int frames)
+    {
+        BenchResult result{ cell, false, frames, 0, 0, 0, 0, 0 };
+
+        // Staging textures pad rows to 256 bytes; the upload side is packed.
+        const size_t rowBytes = static_cast<size_t>(cell.width) * (IsYuvFormat(cell.format) ? 4 : FramePixelBytes(cell.format));
+        const size_t srcPitch = (rowBytes + 255) & ~static_cast<size_t>(255);
+        const size_t frameBytes = FrameByteSize(cell.format, cell.width, cell.height);
+        const int views = cell.stereo ? 2 : 1;
+
+        FrameBuffer source(srcPitch * cell.height);
+        FillTestPattern(source.Data(), srcPitch, static_cast<int>(rowBytes / 4), cell.height);
+
+        std::vector<FrameBuffer> targets;
+        for (int i = 0; i < cell.bufferDepth; ++i)
+        {
+            targets.emplace_back(frameBytes);
+        }
+
+        JobSystem jobs(cell.threads);
+        FrameCopyEngine engine(jobs);
+        std::vector<double> samplesMs;
+        samplesMs.reserve(frames);
+
+        for (int frame = 0; frame < warmupFrames + frames; ++frame)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int view = 0; view < views; ++view)
+            {
+                uint8_t* target = targets[(frame * views + view) % cell.bufferDepth].Data();
+                if (IsYuvFormat(cell.format))
+                {
+                    ConvertRgbaToYuv(source.Data(), static_cast<int>(srcPitch),
+                                     MakeVideoFrame(cell.format, cell.width, cell.height, target), &jobs);
+                }
+                else
+                {
+                    engine.Copy(target, rowBytes, source.Data(), srcPitch, rowBytes, cell.height);
+                }
+            }
+            const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (frame >= warmupFrames)
+            {
+                samplesMs.push_back(elapsedMs);
+            }
+        }
+
+        double sum = 0.0;
+        for (double sample : samplesMs)
+        {
+            sum += sample;
+        }
+        result.meanMs = sum / samplesMs.size();
+
+        double squares = 0.0;
+        for (double sample : samplesMs)
+        {
+            squares += (sample - result.meanMs) * (sample - result.meanMs);
+        }
+        result.stddevMs = samplesMs.size() > 1 ? std::sqrt(squares / (samplesMs.size() - 1)) : 0.0;
+
+        std::sort(samplesMs.begin(), samplesMs.end());
+        result.p50Ms = samplesMs[samplesMs.size() / 2];
+        result.p99Ms = samplesMs[std::min(samplesMs.size() - 1, static_cast<size_t>(samplesMs.size() * 0.99))];
+        result.gbPerSecond = frameBytes * views / (result.meanMs / 1e3) / 1e9;
+        return result;
+    }
+
+    // Two-sided p-value of Welch's t statistic. With the frame counts used
+    // here the t distribution is close enough to normal.
+    double WelchPValue(const BenchResult& a, const BenchResult& b)
+    {
+        const double va = a.stddevMs * a.stddevMs / std::max(1, a.frames);
+        const double vb = b.stddevMs * b.stddevMs / std::max(1, b.frames);
+        if (va + vb <= 0.0)
+        {
+            return a.meanMs == b.meanMs ? 1.0 : 0.0;
+        }
+        const double t = (b.meanMs - a.meanMs) / std::sqrt(va + vb);
+        return std::erfc(std::fabs(t) / std::sqrt(2.0));
+    }
+}
+
+std::string BenchCellKey(const BenchCell& cell)
+{
+    char key[128];
+    std::snprintf(key, sizeof(key), "%s/%s/%dx%d/depth%d/threads%d/%s",
+        TransferModeName(cell.transfer), FrameFormatName(cell.format), cell.width, cell.height,
+        cell.bufferDepth, cell.threads, cell.stereo ? "stereo" : "mono");
+    return key;
+}
+
+std::vector<BenchResult> RunBenchmarkMatrix(const BenchMatrixOptions& options)
+{
+    std::vector<BenchResult> results;
+    for (TransferMode transfer : options.transfers)
+    for (FrameFormat format : options.formats)
+    for (const auto& resolution : options.resolutions)
+    for (int depth : options.bufferDepths)
+    for (int threads : options.threadCounts)
+    for (bool stereo : options.stereoModes)
+    {
+        const BenchCell cell{ transfer, format, resolution.first, resolution.second, depth, threads, stereo };
+
+        // Interop moves packed formats only and has no CPU-side threads to
+        // sweep; copies and YUV conversion both run on |threads|.
+        if ((transfer == TransferMode::Interop && IsYuvFormat(format)) ||
+            (transfer == TransferMode::Interop && threads != options.threadCounts.front()))
+        {
+            continue;
+        }
+
+        if (transfer == TransferMode::Interop)
+        {
+            results.push_back(BenchResult{ cell, true, 0, 0, 0, 0, 0, 0 });
+            continue;
+        }
+
+        results.push_back(RunCpuCell(cell, options.warmupFrames, options.frames));
+    }
+    return results;
+}
+
+void WriteBenchResultsCsv(std::FILE* out, const std::vector<BenchResult>& results)
+{
+    std::fprintf(out, "transfer,format,width,height,depth,threads,stereo,skipped,frames,mean_ms,stddev_ms,p50_ms,p99_ms,gb_per_s\n");
+    for (const BenchResult& result : results)
+    {
+        const BenchCell& cell = result.cell;
+        std::fprintf(out, "%s,%s,%d,%d,%d,%d,%d,%d,%d,%.5f,%.5f,%.5f,%.5f,%.4f\n",
+            TransferModeName(cell.transfer), FrameFormatName(cell.format), cell.width, cell.height,
+            cell.bufferDepth, cell.threads, cell.stereo ? 1 : 0, result.skipped ? 1 : 0, result.frames,
+            result.meanMs, result.stddevMs, result.p50Ms, result.p99Ms, result.gbPerSecond);
+    }
+}
+
+void WriteBenchResultsJson(std::FILE* out, const std::vector<BenchResult>& results)
+{
+    std::fprintf(out, "[\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        const BenchCell& cell = result.cell;
+        std::fprintf(out,
+            "  {\"transfer\":\"%s\",\"format\":\"%s\",\"width\":%d,\"height\":%d,\"depth\":%d,\"threads\":%d,"
+            "\"stereo\":%s,\"skipped\":%s,\"frames\":%d,\"mean_ms\":%.5f,\"stddev_ms\":%.5f,"
+            "\"p50_ms\":%.5f,\"p99_ms\":%.5f,\"gb_per_s\":%.4f}%s\n",
+            TransferModeName(cell.transfer), FrameFormatName(cell.format), cell.width, cell.height,
+            cell.bufferDepth, cell.threads, cell.stereo ? "true" : "false", result.skipped ? "true" : "false",
+            result.frames, result.meanMs, result.stddevMs, result.p50Ms, result.p99Ms, result.gbPerSecond,
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "]\n");
+}
+
+std::vector<BenchResult> ReadBenchResultsCsv(std::FILE* in)
+{
+    std::vector<BenchResult> results;
+    char line[512];
+    while (std::fgets(line, sizeof(line), in))
+    {
+        char transfer[16] = {};
+        char format[16] = {};
+        BenchResult result{};
+        int stereo = 0;
+        int skipped = 0;
+        const int fields = std::sscanf(line, "%15[^,],%15[^,],%d,%d,%d,%d,%d,%d,%d,%lf,%lf,%lf,%lf,%lf",
+            transfer, format, &result.cell.width, &result.cell.height, &result.cell.bufferDepth,
+            &result.cell.threads, &stereo, &skipped, &result.frames, &result.meanMs, &result.stddevMs,
+            &result.p50Ms, &result.p99Ms, &result.gbPerSecond);
+        if (fields != 14 ||
+            !ParseTransferMode(transfer, result.cell.transfer) ||
+            !ParseFrameFormat(format, result.cell.format))
+        {
+            continue;
+        }
+        result.cell.stereo = stereo != 0;
+        result.skipped = skipped != 0;
+        results.push_back(result);
+    }
+    return results;
+}
+
+int CompareBenchResults(std::FILE* out, const std::vector<BenchResult>& baseline,
+                        const std::vector<BenchResult>& current, double alpha, double minRegression)
+{
+    int regressions = 0;
+    for (const BenchResult& now : current)
+    {
+        if (now.skipped)
+        {
+            continue;
+        }
+
+        const std::string key = BenchCellKey(now.cell);
+        auto before = std::find_if(baseline.begin(), baseline.end(), [&](const BenchResult& result)
+        {
+            return !result.skipped && BenchCellKey(result.cell) == key;
+        });
+        if (before == baseline.end())
+        {
+            continue;
+        }
+
+        const double change = before->meanMs > 0.0 ? now.meanMs / before->meanMs - 1.0 : 0.0;
+        const double pValue = WelchPValue(*before, now);
+        const bool regressed = change > minRegression && pValue < alpha;
+        regressions += regressed ? 1 : 0;
+
+        std::fprintf(out, "%-48s %8.3f -> %8.3f ms (%+6.1f%%, p=%.4f)%s\n", key.c_str(),
+            before->meanMs, now.meanMs, change * 100.0, pValue, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "AppConfig.h"
+
+// Sweeps the CPU transfer path over transfer backend, pixel format,
+// resolution, buffering depth, job threads and stereo/mono. Each cell runs a
+// warm-up, then a fixed number of timed frames. Results go to CSV or JSON and
+// can be checked against a stored baseline CSV with Welch's t-test. Only
+// standard C++ is used, so the runner also builds without Windows headers.
+
+struct BenchCell
+{
+    TransferMode transfer;
+    FrameFormat format;
+    int width;
+    int height;
+    int bufferDepth;
+    int threads;
+    bool stereo;
+};
+
+struct BenchResult
+{
+    BenchCell cell;
+    bool skipped;
+    int frames;
+    double meanMs;
+    double stddevMs;
+    double p50Ms;
+    double p99Ms;
+    double gbPerSecond;
+};
+
+struct BenchMatrixOptions
+{
+    std::vector<TransferMode> transfers = { TransferMode::Interop, TransferMode::Cpu };
+    std::vector<FrameFormat> formats = { FrameFormat::Rgba8, FrameFormat::Bgra8, FrameFormat::Rgb10A2,
+                                         FrameFormat::Rgba16F, FrameFormat::Nv12, FrameFormat::I420 };
+    std::vector<std::pair<int, int>> resolutions = { { 512, 512 }, { 1024, 1024 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+    std::vector<int> bufferDepths = { 1, 2, 3 };
+    std::vector<int> threadCounts = { 1, 2, 4 };
+    std::vector<bool> stereoModes = { false, true };
+    int warmupFrames = 10;
+    int frames = 60;
+};
+
+std::string BenchCellKey(const BenchCell& cell);
+
+// Interop cells need a live D3D11/GL pair and are reported as skipped.
+std::vector<BenchResult> RunBenchmarkMatrix(const BenchMatrixOptions& options);
+
+void WriteBenchResultsCsv(std::FILE* out, const std::vector<BenchResult>& results);
+void WriteBenchResultsJson(std::FILE* out, const std::vector<BenchResult>& results);
+
+// Reads a CSV written by WriteBenchResultsCsv.
+std::vector<BenchResult> ReadBenchResultsCsv(std::FILE* in);
+
+// Flags cells whose mean frame time is slower than the baseline by more than
+// |minRegression| (relative) with a two-sided p-value below |alpha|. Returns
+// the number of regressions and prints one line per compared cell.
+int CompareBenchResults(std::FILE* out, const std::vector<BenchResult>& baseline,
+                        const std::vector<BenchResult>& current, double alpha = 0.01, double minRegression = 0.03);
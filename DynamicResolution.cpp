@@ -0,0 +1,132 @@
+#include "DynamicResolution.h"
+
+#include <cmath>
+
+namespace
+{
+    // Shrink above the budget, grow below 70% of it, and size for 85% so a
+    // change lands between the two.
+    const double kUpperThreshold = 1.0;
+    const double kLowerThreshold = 0.7;
+    const double kTarget = 0.85;
+
+    const int kFramesToShrink = 3;
+    const int kFramesToGrow = 60;
+    const int kSettleFrames = 8;
+
+    const double kStep = 0.05;
+    const double kSmoothing = 0.2;
+
+    // Sizes are kept to multiples of 8 so NV12/I420 chroma and the resampler's
+    // SIMD blocks stay aligned.
+    const int kSizeAlignment = 8;
+}
+
+DynamicResolution::DynamicResolution()
+    : m_fullWidth(0)
+    , m_fullHeight(0)
+    , m_budgetMs(0.0)
+    , m_minScale(1.0)
+    , m_scale(1.0)
+    , m_width(0)
+    , m_height(0)
+    , m_smoothedMs(0.0)
+    , m_overBudget(0)
+    , m_underBudget(0)
+    , m_settling(0)
+    , m_frames(0)
+    , m_framesOverBudget(0)
+    , m_decreases(0)
+    , m_increases(0)
+{
+}
+
+void DynamicResolution::Configure(int fullWidth, int fullHeight, double budgetMs, double minScale)
+{
+    m_fullWidth = fullWidth;
+    m_fullHeight = fullHeight;
+    m_budgetMs = budgetMs;
+    m_minScale = minScale < 1.0 ? minScale : 1.0;
+    m_smoothedMs = 0.0;
+    m_overBudget = 0;
+    m_underBudget = 0;
+    m_settling = 0;
+    Resize(1.0);
+}
+
+bool DynamicResolution::Update(double producerMs)
+{
+    ++m_frames;
+    m_framesOverBudget += producerMs > m_budgetMs ? 1 : 0;
+    m_scales.Record(static_cast<uint64_t>(m_scale * 1000.0 + 0.5));
+
+    if (m_settling > 0)
+    {
+        // Timings still in the pipeline belong to the old size.
+        --m_settling;
+        m_smoothedMs = 0.0;
+        return false;
+    }
+
+    m_smoothedMs = m_smoothedMs > 0.0 ? m_smoothedMs + kSmoothing * (producerMs - m_smoothedMs) : producerMs;
+    m_overBudget = producerMs > m_budgetMs * kUpperThreshold ? m_overBudget + 1 : 0;
+    m_underBudget = m_smoothedMs < m_budgetMs * kLowerThreshold ? m_underBudget + 1 : 0;
+
+    double scale = m_scale;
+    if (m_overBudget >= kFramesToShrink && m_scale > m_minScale)
+    {
+        // Pixels scale with the square of the axis scale. The worse of the
+        // smoothed and latest times sizes the cut so a sudden spike is met
+        // in one step.
+        const double worstMs = producerMs > m_smoothedMs ? producerMs : m_smoothedMs;
+        scale = m_scale * std::sqrt(m_budgetMs * kTarget / worstMs);
+        scale = scale < m_scale - kStep ? scale : m_scale - kStep;
+        ++m_decreases;
+    }
+    else if (m_underBudget >= kFramesToGrow && m_scale < 1.0)
+    {
+        const double grown = m_scale + kStep < 1.0 ? m_scale + kStep : 1.0;
+        const double predictedMs = m_smoothedMs * (grown * grown) / (m_scale * m_scale);
+        if (predictedMs > m_budgetMs * kTarget)
+        {
+            m_underBudget = 0;
+            return false;
+        }
+        scale = grown;
+        ++m_increases;
+    }
+    else
+    {
+        return false;
+    }
+
+    Resize(scale);
+    m_overBudget = 0;
+    m_underBudget = 0;
+    m_settling = kSettleFrames;
+    return true;
+}
+
+void DynamicResolution::Resize(double scale)
+{
+    m_scale = scale < m_minScale ? m_minScale : (scale > 1.0 ? 1.0 : scale);
+    auto axis = [this](int full)
+    {
+        const int aligned = static_cast<int>(full * m_scale) / kSizeAlignment * kSizeAlignment;
+        return aligned < kSizeAlignment ? (full < kSizeAlignment ? full : kSizeAlignment) : aligned;
+    };
+    m_width = m_scale >= 1.0 ? m_fullWidth : axis(m_fullWidth);
+    m_height = m_scale >= 1.0 ? m_fullHeight : axis(m_fullHeight);
+}
+
+void DynamicResolution::Report(std::FILE* out) const
+{
+    std::fprintf(out, "dynamic resolution: %.2f ms budget, %dx%d full size, scale %.0f%% to 100%%\n", m_budgetMs,
+                 m_fullWidth, m_fullHeight, m_minScale * 100.0);
+    std::fprintf(out, "frames %llu, over budget %llu (%.1f%%), %llu decreases, %llu increases\n",
+                 static_cast<unsigned long long>(m_frames), static_cast<unsigned long long>(m_framesOverBudget),
+                 m_frames ? 100.0 * m_framesOverBudget / m_frames : 0.0,
+                 static_cast<unsigned long long>(m_decreases), static_cast<unsigned long long>(m_increases));
+    std::fprintf(out, "scale per frame: mean %.1f%%, p1 %.1f%%, p50 %.1f%%, max %.1f%%\n", m_scales.MeanNs() / 10.0,
+                 m_scales.ValueAtQuantile(0.01) / 10.0, m_scales.ValueAtQuantile(0.5) / 10.0, m_scales.MaxNs() / 10.0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "FrameHistogram.h"
+
+// Keeps the producer inside a frame-time budget by rendering fewer pixels
+// instead of dropping frames. The producer draws into the top-left
+// Width() x Height() of its full-size target through a smaller viewport, so
+// nothing is reallocated, and the consumer stretches that sub-rectangle over
+// the window.
+//
+// Producer time is taken to scale with the pixel count. Several frames in a
+// row over budget shrink the scale by as much as the smoothed time says is
+// needed; a long run well under budget grows it one step, and only if the
+// predicted time stays under the target. The gap between the two thresholds,
+// the longer run needed to grow and a settling period after each change
+// (the new size only shows up in timings a few frames later) keep the size
+// from oscillating.
+class DynamicResolution
+{
+public:
+    DynamicResolution();
+
+    // |minScale| bounds each axis, e.g. 0.5 = a quarter of the pixels.
+    void Configure(int fullWidth, int fullHeight, double budgetMs, double minScale);
+
+    // Feeds the producer time of one frame rendered at the current size;
+    // returns true when the size changed.
+    bool Update(double producerMs);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    double Scale() const { return m_scale; }
+    double SmoothedMs() const { return m_smoothedMs; }
+
+    // Budget, size changes and the per-frame scale distribution.
+    void Report(std::FILE* out) const;
+
+private:
+    void Resize(double scale);
+
+    int m_fullWidth;
+    int m_fullHeight;
+    double m_budgetMs;
+    double m_minScale;
+
+    double m_scale;
+    int m_width;
+    int m_height;
+    double m_smoothedMs;
+    int m_overBudget;       // consecutive frames above the upper threshold
+    int m_underBudget;      // consecutive frames below the lower threshold
+    int m_settling;         // frames left to ignore after a change
+
+    uint64_t m_frames;
+    uint64_t m_framesOverBudget;
+    uint64_t m_decreases;
+    uint64_t m_increases;
+    FrameHistogram m_scales;    // per frame, in 1/1000
+};
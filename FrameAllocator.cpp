@@ -0,0 +1,337 @@
+#include "FrameAllocator.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t kPageSize = 4096;
+
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege, which is normally granted by
+    // policy but disabled in the process token.
+    bool EnableLargePages()
+    {
+        if (GetLargePageMinimum() == 0)
+        {
+            return false;
+        }
+
+        HANDLE token = nullptr;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        {
+            return false;
+        }
+
+        TOKEN_PRIVILEGES privileges{};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool enabled = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+            AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+            GetLastError() == ERROR_SUCCESS;
+        CloseHandle(token);
+        return enabled;
+    }
+#else
+    // mbind(MPOL_PREFERRED) through the raw syscall, so libnuma is not needed.
+    // Must run before the pages are first touched.
+    void PreferNode(void* buffer, size_t size, int node)
+    {
+        const int kMpolPreferred = 1;
+        unsigned long mask[16] = {};
+        const int bits = static_cast<int>(sizeof(unsigned long) * 8);
+        if (node >= bits * 16)
+        {
+            return;
+        }
+        mask[node / bits] = 1ul << (node % bits);
+        syscall(SYS_mbind, buffer, size, kMpolPreferred, mask, sizeof(mask) * 8, 0);
+    }
+#endif
+}
+
+uint64_t QueryPageFaultCount()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    counters.cb = sizeof(counters);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PageFaultCount;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+#endif
+}
+
+FrameAllocator::FrameAllocator()
+    : m_stats{}
+    , m_pageFaultsAtStart(QueryPageFaultCount())
+#ifdef _WIN32
+    , m_largePagesEnabled(EnableLargePages())
+#else
+    , m_largePagesEnabled(true)
+#endif
+    , m_numaNode(-1)
+{
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    for (const auto& entry : m_blocks)
+    {
+        UnmapPages(entry.first, entry.second.size, entry.second.hugePages);
+    }
+}
+
+size_t FrameAllocator::SizeClass(size_t bytes)
+{
+    const size_t granularity = bytes >= kHugePageSize ? kHugePageSize : kPageSize;
+    return (bytes + granularity - 1) / granularity * granularity;
+}
+
+void* FrameAllocator::Acquire(size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return nullptr;
+    }
+
+    const size_t size = SizeClass(bytes);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.acquires;
+
+    std::vector<void*>& freeList = m_freeLists[size];
+    if (!freeList.empty())
+    {
+        void* buffer = freeList.back();
+        freeList.pop_back();
+        ++m_stats.reuses;
+        m_stats.bytesInUse += size;
+        return buffer;
+    }
+
+    bool hugePages = false;
+    void* buffer = MapPages(size, hugePages);
+    if (!buffer)
+    {
+        return nullptr;
+    }
+
+    // Fault every page in now so the first frame does not pay for it.
+    const size_t stride = hugePages ? kHugePageSize : kPageSize;
+    for (size_t offset = 0; offset < size; offset += stride)
+    {
+        static_cast<volatile uint8_t*>(buffer)[offset] = 0;
+    }
+
+    m_blocks[buffer] = Block{ size, hugePages };
+    ++m_stats.osAllocations;
+    m_stats.bytesReserved += size;
+    m_stats.bytesInUse += size;
+    if (hugePages)
+    {
+        m_stats.hugePageBytes += size;
+    }
+    return buffer;
+}
+
+void FrameAllocator::Release(void* buffer)
+{
+    if (!buffer)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto block = m_blocks.find(buffer);
+    if (block == m_blocks.end())
+    {
+        return;
+    }
+
+    m_stats.bytesInUse -= block->second.size;
+    m_freeLists[block->second.size].push_back(buffer);
+}
+
+void FrameAllocator::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& freeList : m_freeLists)
+    {
+        for (void* buffer : freeList.second)
+        {
+            const Block block = m_blocks[buffer];
+            UnmapPages(buffer, block.size, block.hugePages);
+            m_blocks.erase(buffer);
+            m_stats.bytesReserved -= block.size;
+            if (block.hugePages)
+            {
+                m_stats.hugePageBytes -= block.size;
+            }
+        }
+        freeList.second.clear();
+    }
+}
+
+void FrameAllocator::SetNumaNode(int node)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_numaNode = node >= 0 ? node : -1;
+}
+
+int FrameAllocator::NumaNode() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numaNode;
+}
+
+FrameAllocatorStats FrameAllocator::Stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FrameAllocatorStats stats = m_stats;
+    stats.pageFaults = QueryPageFaultCount() - m_pageFaultsAtStart;
+    return stats;
+}
+
+void FrameAllocator::Report(std::FILE* out) const
+{
+    const FrameAllocatorStats stats = Stats();
+    std::fprintf(out,
+        "frame allocator: %llu acquires, %llu reused, %llu OS allocations, "
+        "%.1f MB reserved (%.1f MB large pages), %.1f MB in use, %llu page faults\n",
+        static_cast<unsigned long long>(stats.acquires),
+        static_cast<unsigned long long>(stats.reuses),
+        static_cast<unsigned long long>(stats.osAllocations),
+        stats.bytesReserved / 1048576.0,
+        stats.hugePageBytes / 1048576.0,
+        stats.bytesInUse / 1048576.0,
+        static_cast<unsigned long long>(stats.pageFaults));
+}
+
+#ifdef _WIN32
+void* FrameAllocator::MapOnNode(size_t size, unsigned long allocationType) const
+{
+    if (m_numaNode >= 0)
+    {
+        return VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, allocationType, PAGE_READWRITE,
+                                  static_cast<DWORD>(m_numaNode));
+    }
+    return VirtualAlloc(nullptr, size, allocationType, PAGE_READWRITE);
+}
+#endif
+
+void* FrameAllocator::MapPages(size_t size, bool& hugePages)
+{
+#ifdef _WIN32
+    const size_t largePage = GetLargePageMinimum();
+    if (m_largePagesEnabled && largePage != 0 && size % largePage == 0)
+    {
+        void* buffer = MapOnNode(size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES);
+        if (buffer)
+        {
+            hugePages = true;
+            return buffer;
+        }
+    }
+
+    hugePages = false;
+    return MapOnNode(size, MEM_RESERVE | MEM_COMMIT);
+#else
+    if (m_largePagesEnabled && size % kHugePageSize == 0)
+    {
+        void* buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buffer != MAP_FAILED)
+        {
+            if (m_numaNode >= 0)
+            {
+                PreferNode(buffer, size, m_numaNode);
+            }
+            hugePages = true;
+            return buffer;
+        }
+    }
+
+    hugePages = false;
+    void* buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED)
+    {
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    // No reserved hugetlbfs pages: ask transparent huge pages instead.
+    if (size >= kHugePageSize)
+    {
+        madvise(buffer, size, MADV_HUGEPAGE);
+    }
+#endif
+    if (m_numaNode >= 0)
+    {
+        PreferNode(buffer, size, m_numaNode);
+    }
+    return buffer;
+#endif
+}
+
+void FrameAllocator::UnmapPages(void* buffer, size_t size, bool hugePages)
+{
+    (void)hugePages;
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+    munmap(buffer, size);
+#endif
+}
+
+FrameAllocator& GetFrameAllocator()
+{
+    static FrameAllocator allocator;
+    return allocator;
+}
+
+FrameBuffer::FrameBuffer(size_t bytes)
+    : m_data(static_cast<uint8_t*>(GetFrameAllocator().Acquire(bytes)))
+    , m_size(m_data ? bytes : 0)
+{
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    GetFrameAllocator().Release(m_data);
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        GetFrameAllocator().Release(m_data);
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct FrameAllocatorStats
+{
+    uint64_t acquires;
+    uint64_t reuses;
+    uint64_t osAllocations;
+    uint64_t bytesReserved;
+    uint64_t hugePageBytes;
+    uint64_t bytesInUse;
+    uint64_t pageFaults;
+};
+
+// Pool of page-aligned frame buffers. Buffers are rounded up to a size class
+// (4 KB pages below 2 MB, 2 MB above), backed by large pages where the OS
+// grants them (MEM_LARGE_PAGES on Windows, MAP_HUGETLB or THP on Linux),
+// pre-faulted on first allocation and recycled by size class. Memory only
+// goes back to the OS in Trim() or the destructor, never on Release().
+class FrameAllocator
+{
+public:
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+    FrameAllocator();
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    void* Acquire(size_t bytes);
+    void Release(void* buffer);
+
+    // Returns every pooled (released) buffer to the OS.
+    void Trim();
+
+    // NUMA node for buffers mapped from now on (-1: wherever the OS puts the
+    // first touch, which is the node of the allocating thread). Pooled
+    // buffers keep their node, so Trim() first when changing it.
+    void SetNumaNode(int node);
+    int NumaNode() const;
+
+    FrameAllocatorStats Stats() const;
+    void Report(std::FILE* out) const;
+
+private:
+    struct Block
+    {
+        size_t size;
+        bool hugePages;
+    };
+
+    static size_t SizeClass(size_t bytes);
+    void* MapPages(size_t size, bool& hugePages);
+#ifdef _WIN32
+    void* MapOnNode(size_t size, unsigned long allocationType) const;
+#endif
+    static void UnmapPages(void* buffer, size_t size, bool hugePages);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<size_t, std::vector<void*>> m_freeLists;
+    std::unordered_map<void*, Block> m_blocks;
+    FrameAllocatorStats m_stats;
+    uint64_t m_pageFaultsAtStart;
+    bool m_largePagesEnabled;
+    int m_numaNode;
+};
+
+// Process-wide pool shared by the CPU staging paths.
+FrameAllocator& GetFrameAllocator();
+
+// Owns one buffer from GetFrameAllocator() and hands it back on destruction.
+class FrameBuffer
+{
+public:
+    FrameBuffer() : m_data(nullptr), m_size(0) {}
+    explicit FrameBuffer(size_t bytes);
+    ~FrameBuffer();
+
+    FrameBuffer(FrameBuffer&& other) noexcept;
+    FrameBuffer& operator=(FrameBuffer&& other) noexcept;
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    uint8_t* m_data;
+    size_t m_size;
+};
+
+// Returns the process' page-fault count so far.
+uint64_t QueryPageFaultCount();
@@ -0,0 +1,140 @@
+#include "FrameCopy.h"
+
+#include "FrameAllocator.h"
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    // Below this size the wake-up cost outweighs the extra bandwidth.
+    const size_t kParallelThreshold = 512 * 1024;
+
+    void StreamCopyRow(uint8_t* dst, const uint8_t* src, size_t bytes)
+    {
+        const size_t head = std::min(bytes, (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15);
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        bytes -= head;
+
+        for (; bytes >= 64; bytes -= 64, dst += 64, src += 64)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+        }
+
+        memcpy(dst, src, bytes);
+    }
+}
+
+void StreamCopyRows(uint8_t* dst, size_t dstPitch, const uint8_t* src, size_t srcPitch, size_t rowBytes, int rows)
+{
+    if (dstPitch == rowBytes && srcPitch == rowBytes)
+    {
+        StreamCopyRow(dst, src, rowBytes * rows);
+    }
+    else
+    {
+        for (int row = 0; row < rows; ++row)
+        {
+            StreamCopyRow(dst + row * dstPitch, src + row * srcPitch, rowBytes);
+        }
+    }
+    _mm_sfence();
+}
+
+FrameCopyEngine::FrameCopyEngine(JobSystem& jobs)
+    : m_jobs(jobs)
+{
+}
+
+void FrameCopyEngine::Copy(uint8_t* dst, size_t dstPitch, const uint8_t* src, size_t srcPitch, size_t rowBytes, int rows)
+{
+    if (!dst || !src || rows <= 0 || rowBytes == 0)
+    {
+        return;
+    }
+
+    const int bands = std::min(ThreadCount(), rows);
+    if (bands <= 1 || rowBytes * rows < kParallelThreshold)
+    {
+        StreamCopyRows(dst, dstPitch, src, srcPitch, rowBytes, rows);
+        return;
+    }
+
+    m_jobs.ParallelFor(bands, 1, [&](int firstBand, int lastBand)
+    {
+        TRACE_ZONE("CopyBand");
+        const int first = static_cast<int>(static_cast<int64_t>(rows) * firstBand / bands);
+        const int last = static_cast<int>(static_cast<int64_t>(rows) * lastBand / bands);
+        StreamCopyRows(dst + first * dstPitch, dstPitch, src + first * srcPitch, srcPitch, rowBytes, last - first);
+    });
+}
+
+void RunCopyBenchmark(std::FILE* out)
+{
+    struct FrameSize { int width; int height; };
+    const FrameSize sizes[] = { { 1024, 1024 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+    const int iterations = 20;
+    const int maxThreads = std::max(1, std::min(8, static_cast<int>(std::thread::hardware_concurrency())));
+
+    using Clock = std::chrono::steady_clock;
+    auto gbPerSecond = [](size_t bytes, Clock::duration elapsed)
+    {
+        return static_cast<double>(bytes) / std::chrono::duration<double>(elapsed).count() / 1e9;
+    };
+
+    std::fprintf(out, "%-10s %-8s %-8s %10s\n", "size", "method", "threads", "GB/s");
+    for (const FrameSize& size : sizes)
+    {
+        // Staging textures pad RowPitch; model that with 256-byte alignment.
+        const size_t rowBytes = static_cast<size_t>(size.width) * 4;
+        const size_t srcPitch = (rowBytes + 255) & ~static_cast<size_t>(255);
+        FrameBuffer src(srcPitch * size.height);
+        FrameBuffer dst(rowBytes * size.height);
+        uint8_t* dstAligned = dst.Data();
+        memset(src.Data(), 0x5A, src.Size());
+        const size_t frameBytes = rowBytes * size.height;
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "%dx%d", size.width, size.height);
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            for (int row = 0; row < size.height; ++row)
+            {
+                memcpy(dstAligned + row * rowBytes, src.Data() + row * srcPitch, rowBytes);
+            }
+        }
+        std::fprintf(out, "%-10s %-8s %-8d %10.2f\n", label, "memcpy", 1,
+                     gbPerSecond(frameBytes * iterations, Clock::now() - start));
+
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            JobSystem jobs(threads);
+            FrameCopyEngine engine(jobs);
+            engine.Copy(dstAligned, rowBytes, src.Data(), srcPitch, rowBytes, size.height);
+
+            start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                engine.Copy(dstAligned, rowBytes, src.Data(), srcPitch, rowBytes, size.height);
+            }
+            std::fprintf(out, "%-10s %-8s %-8d %10.2f\n", label, "stream", threads,
+                         gbPerSecond(frameBytes * iterations, Clock::now() - start));
+        }
+    }
+
+    GetFrameAllocator().Report(out);
+}
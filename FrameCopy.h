@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "JobSystem.h"
+
+// Copies pitched 2D surfaces (e.g. a mapped staging texture into a mapped
+// PBO). Large copies are split into row bands run on the shared JobSystem and
+// written with non-temporal stores so the frame does not evict the caches.
+class FrameCopyEngine
+{
+public:
+    explicit FrameCopyEngine(JobSystem& jobs);
+
+    FrameCopyEngine(const FrameCopyEngine&) = delete;
+    FrameCopyEngine& operator=(const FrameCopyEngine&) = delete;
+
+    void Copy(uint8_t* dst, size_t dstPitch, const uint8_t* src, size_t srcPitch, size_t rowBytes, int rows);
+
+    int ThreadCount() const { return m_jobs.ThreadCount(); }
+
+private:
+    JobSystem& m_jobs;
+};
+
+// Copies rows with streaming stores on the calling thread.
+void StreamCopyRows(uint8_t* dst, size_t dstPitch, const uint8_t* src, size_t srcPitch, size_t rowBytes, int rows);
+
+// Times FrameCopyEngine against memcpy across frame sizes and thread counts
+// and writes one line per case (GB/s) to |out|.
+void RunCopyBenchmark(std::FILE* out);
@@ -0,0 +1,169 @@
+#include "FrameHistogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    inline int HighestBit(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index = 0;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+        {
+            return static_cast<int>(index) + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    const double kQuantiles[] = { 0.50, 0.90, 0.99, 0.999 };
+    const char* kQuantileNames[] = { "p50", "p90", "p99", "p99.9" };
+}
+
+FrameHistogram::FrameHistogram()
+{
+    Reset();
+}
+
+int FrameHistogram::IndexOf(uint64_t value)
+{
+    if (value < kSubBucketCount)
+    {
+        return static_cast<int>(value);
+    }
+
+    // Shift the value into [kSubBucketHalf, kSubBucketCount) and index by
+    // (shift, leading sub-bucket).
+    int shift = HighestBit(value) - (kSubBucketBits - 1);
+    if (shift > kMaxValueBits - kSubBucketBits + 1)
+    {
+        return kBucketCount - 1;
+    }
+    return kSubBucketCount + (shift - 1) * kSubBucketHalf + static_cast<int>(value >> shift) - kSubBucketHalf;
+}
+
+uint64_t FrameHistogram::ValueOf(int index)
+{
+    if (index < kSubBucketCount)
+    {
+        return static_cast<uint64_t>(index);
+    }
+
+    const int shift = (index - kSubBucketCount) / kSubBucketHalf + 1;
+    const uint64_t subBucket = static_cast<uint64_t>((index - kSubBucketCount) % kSubBucketHalf + kSubBucketHalf);
+    const uint64_t lower = subBucket << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+void FrameHistogram::Record(uint64_t valueNs)
+{
+    m_counts[IndexOf(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total.fetch_add(valueNs, std::memory_order_relaxed);
+
+    uint64_t seen = m_max.load(std::memory_order_relaxed);
+    while (valueNs > seen && !m_max.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed))
+    {
+    }
+}
+
+void FrameHistogram::Reset()
+{
+    for (std::atomic<uint64_t>& count : m_counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_total.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+double FrameHistogram::MeanNs() const
+{
+    const uint64_t count = Count();
+    return count ? static_cast<double>(m_total.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+uint64_t FrameHistogram::ValueAtQuantile(double quantile) const
+{
+    uint64_t total = 0;
+    for (const std::atomic<uint64_t>& count : m_counts)
+    {
+        total += count.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t target = static_cast<uint64_t>(quantile * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int index = 0; index < kBucketCount; ++index)
+    {
+        seen += m_counts[index].load(std::memory_order_relaxed);
+        if (seen >= target)
+        {
+            const uint64_t value = ValueOf(index);
+            const uint64_t max = MaxNs();
+            return value < max ? value : max;
+        }
+    }
+    return MaxNs();
+}
+
+const char* FrameStageName(FrameStage stage)
+{
+    switch (stage)
+    {
+    case FrameStage::Producer: return "producer";
+    case FrameStage::Transfer: return "transfer";
+    case FrameStage::Consumer: return "consumer";
+    case FrameStage::Present:  return "present";
+    case FrameStage::Frame:    return "frame";
+    default:                   return "unknown";
+    }
+}
+
+void FrameStats::Report(std::FILE* out) const
+{
+    std::fprintf(out, "%-10s %8s %9s %9s %9s %9s %9s %9s\n",
+        "stage", "frames", "mean", "p50", "p90", "p99", "p99.9", "max(ms)");
+    for (int stage = 0; stage < static_cast<int>(FrameStage::Count); ++stage)
+    {
+        const FrameHistogram& histogram = m_stages[stage];
+        std::fprintf(out, "%-10s %8llu %9.3f", FrameStageName(static_cast<FrameStage>(stage)),
+            static_cast<unsigned long long>(histogram.Count()), histogram.MeanNs() / 1e6);
+        for (double quantile : kQuantiles)
+        {
+            std::fprintf(out, " %9.3f", histogram.ValueAtQuantile(quantile) / 1e6);
+        }
+        std::fprintf(out, " %9.3f\n", histogram.MaxNs() / 1e6);
+    }
+}
+
+void FrameStats::ReportJson(std::FILE* out) const
+{
+    std::fprintf(out, "{");
+    for (int stage = 0; stage < static_cast<int>(FrameStage::Count); ++stage)
+    {
+        const FrameHistogram& histogram = m_stages[stage];
+        std::fprintf(out, "%s\"%s\":{\"count\":%llu,\"mean_ms\":%.4f", stage ? "," : "",
+            FrameStageName(static_cast<FrameStage>(stage)),
+            static_cast<unsigned long long>(histogram.Count()), histogram.MeanNs() / 1e6);
+        for (size_t i = 0; i < sizeof(kQuantiles) / sizeof(kQuantiles[0]); ++i)
+        {
+            std::fprintf(out, ",\"%s_ms\":%.4f", kQuantileNames[i], histogram.ValueAtQuantile(kQuantiles[i]) / 1e6);
+        }
+        std::fprintf(out, ",\"max_ms\":%.4f}", histogram.MaxNs() / 1e6);
+    }
+    std::fprintf(out, "}\n");
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Log-linear (HDR) histogram of nanosecond durations: 64 linear sub-buckets
+// per power of two gives better than 1.6% relative precision from 1 ns up to
+// ~18 minutes in a fixed 18 KB table. Record() is O(1) and lock-free, so it
+// can stay on in release builds and be recorded from any thread.
+class FrameHistogram
+{
+public:
+    FrameHistogram();
+
+    void Record(uint64_t valueNs);
+    void Reset();
+
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t MaxNs() const { return m_max.load(std::memory_order_relaxed); }
+    double MeanNs() const;
+
+    // |quantile| in [0, 1]; returns the representative value of the bucket.
+    uint64_t ValueAtQuantile(double quantile) const;
+
+private:
+    static const int kSubBucketBits = 7;
+    static const int kSubBucketCount = 1 << kSubBucketBits;
+    static const int kSubBucketHalf = kSubBucketCount / 2;
+    static const int kMaxValueBits = 40;
+    static const int kBucketCount = kSubBucketCount + (kMaxValueBits - kSubBucketBits + 1) * kSubBucketHalf;
+
+    static int IndexOf(uint64_t value);
+    static uint64_t ValueOf(int index);
+
+    std::atomic<uint64_t> m_counts[kBucketCount];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_total;
+    std::atomic<uint64_t> m_max;
+};
+
+enum class FrameStage
+{
+    Producer,
+    Transfer,
+    Consumer,
+    Present,
+    Frame,
+    Count,
+};
+
+const char* FrameStageName(FrameStage stage);
+
+// One histogram per pipeline stage.
+class FrameStats
+{
+public:
+    void Record(FrameStage stage, uint64_t durationNs)
+    {
+        m_stages[static_cast<int>(stage)].Record(durationNs);
+    }
+
+    const FrameHistogram& Stage(FrameStage stage) const { return m_stages[static_cast<int>(stage)]; }
+
+    void Reset()
+    {
+        for (FrameHistogram& stage : m_stages)
+        {
+            stage.Reset();
+        }
+    }
+
+    // p50/p90/p99/p99.9/max per stage in milliseconds.
+    void Report(std::FILE* out) const;
+    void ReportJson(std::FILE* out) const;
+
+private:
+    FrameHistogram m_stages[static_cast<int>(FrameStage::Count)];
+};
@@ -0,0 +1,103 @@
+#include "FrameLatency.h"
+
+#include <cstring>
+
+namespace
+{
+    // The top 8 bits carry a check byte over the 24-bit sequence number.
+    uint32_t MarkerWord(uint32_t sequence)
+    {
+        sequence &= 0xFFFFFF;
+        const uint32_t check = ~((sequence & 0xFF) + ((sequence >> 8) & 0xFF) + (sequence >> 16)) & 0xFF;
+        return (check << 24) | sequence;
+    }
+
+    void ReportSeries(std::FILE* out, const char* mode, const char* metric, const FrameHistogram& samples)
+    {
+        if (samples.Count() == 0)
+        {
+            std::fprintf(out, "%s %s: no samples\n", mode, metric);
+            return;
+        }
+
+        std::fprintf(out, "%s %s: n=%llu min=%.3f p50=%.3f p90=%.3f p99=%.3f max=%.3f ms\n",
+            mode, metric, static_cast<unsigned long long>(samples.Count()), samples.ValueAtQuantile(0.0) / 1e6,
+            samples.ValueAtQuantile(0.50) / 1e6, samples.ValueAtQuantile(0.90) / 1e6,
+            samples.ValueAtQuantile(0.99) / 1e6, samples.MaxNs() / 1e6);
+    }
+}
+
+void EncodeFrameMarker(uint32_t sequence, uint8_t* rgba, int pitch)
+{
+    const uint32_t word = MarkerWord(sequence);
+    for (int row = 0; row < kMarkerHeight; ++row)
+    {
+        uint8_t* pixel = rgba + row * pitch;
+        for (int bit = 0; bit < kMarkerBits; ++bit)
+        {
+            const uint8_t value = (word >> bit) & 1 ? 0xFF : 0x00;
+            for (int x = 0; x < kMarkerBlockWidth; ++x, pixel += 4)
+            {
+                pixel[0] = pixel[1] = pixel[2] = value;
+                pixel[3] = 0xFF;
+            }
+        }
+    }
+}
+
+bool DecodeFrameMarker(const uint8_t* rgbaRow, uint32_t& sequence)
+{
+    uint32_t word = 0;
+    for (int bit = 0; bit < kMarkerBits; ++bit)
+    {
+        // Sample the block centre, using green which survives YUV round trips best.
+        const uint8_t* pixel = rgbaRow + (bit * kMarkerBlockWidth + kMarkerBlockWidth / 2) * 4;
+        if (pixel[1] >= 128)
+        {
+            word |= 1u << bit;
+        }
+    }
+
+    if (MarkerWord(word & 0xFFFFFF) != word)
+    {
+        return false;
+    }
+    sequence = word & 0xFFFFFF;
+    return true;
+}
+
+LatencyTracker::LatencyTracker()
+    : m_lostMarkers(0)
+    , m_unmatched(0)
+{
+    memset(m_producedNs, 0, sizeof(m_producedNs));
+    memset(m_producedSeq, 0xFF, sizeof(m_producedSeq));
+}
+
+void LatencyTracker::OnProduced(uint32_t sequence, uint64_t producedNs)
+{
+    sequence &= 0xFFFFFF;
+    m_producedSeq[sequence % kHistory] = sequence;
+    m_producedNs[sequence % kHistory] = producedNs;
+}
+
+void LatencyTracker::OnDisplayed(uint32_t sequence, uint64_t drawnNs, uint64_t presentedNs)
+{
+    const uint32_t slot = sequence % kHistory;
+    if (m_producedSeq[slot] != sequence || m_producedNs[slot] > drawnNs)
+    {
+        ++m_unmatched;
+        return;
+    }
+
+    m_toDrawNs.Record(drawnNs - m_producedNs[slot]);
+    m_toPresentNs.Record(presentedNs - m_producedNs[slot]);
+}
+
+void LatencyTracker::Report(std::FILE* out, const char* mode) const
+{
+    ReportSeries(out, mode, "produce->draw", m_toDrawNs);
+    ReportSeries(out, mode, "produce->present", m_toPresentNs);
+    std::fprintf(out, "%s markers lost=%llu unmatched=%llu\n", mode,
+        static_cast<unsigned long long>(m_lostMarkers), static_cast<unsigned long long>(m_unmatched));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "FrameHistogram.h"
+
+// Producer-to-display latency. The producer stamps each frame by writing its
+// sequence number as a row of black/white blocks into the top-left corner of
+// the shared texture and remembers when it started the frame. The consumer
+// reads the marker back from the drawn back buffer, so the measurement covers
+// whatever transfer path actually delivered the pixels.
+
+const int kMarkerBits = 32;
+const int kMarkerBlockWidth = 8;
+const int kMarkerWidth = kMarkerBits * kMarkerBlockWidth;
+const int kMarkerHeight = 4;
+
+inline uint64_t FrameClockNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Fills a kMarkerWidth x kMarkerHeight RGBA8 block encoding |sequence|.
+void EncodeFrameMarker(uint32_t sequence, uint8_t* rgba, int pitch);
+
+// Decodes one RGBA8 row of at least kMarkerWidth pixels. Fails when the check
+// byte does not match, e.g. when the marker was scaled or torn.
+bool DecodeFrameMarker(const uint8_t* rgbaRow, uint32_t& sequence);
+
+class LatencyTracker
+{
+public:
+    LatencyTracker();
+
+    void OnProduced(uint32_t sequence, uint64_t producedNs);
+    void OnDisplayed(uint32_t sequence, uint64_t drawnNs, uint64_t presentedNs);
+    void OnMarkerLost() { ++m_lostMarkers; }
+
+    // One line per metric with min/p50/p90/p99/max in milliseconds; all but
+    // max are FrameHistogram bucket values.
+    void Report(std::FILE* out, const char* mode) const;
+
+private:
+    static const uint32_t kHistory = 256;
+
+    uint64_t m_producedNs[kHistory];
+    uint32_t m_producedSeq[kHistory];
+    FrameHistogram m_toDrawNs;
+    FrameHistogram m_toPresentNs;
+    uint64_t m_lostMarkers;
+    uint64_t m_unmatched;
+};
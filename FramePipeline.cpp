@@ -0,0 +1,111 @@
+#include "FramePipeline.h"
+
+#include <utility>
+
+FrameTask::FrameTask(FrameTask&& other) noexcept
+    : m_handle(std::exchange(other.m_handle, nullptr))
+{
+}
+
+FrameTask& FrameTask::operator=(FrameTask&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+        m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+}
+
+FrameTask::~FrameTask()
+{
+    if (m_handle)
+    {
+        m_handle.destroy();
+    }
+}
+
+void PipelineCondition::await_suspend(std::coroutine_handle<> handle)
+{
+    executor->m_waiting.push_back({ handle, std::move(ready) });
+}
+
+void PipelineExecutor::Spawn(FrameTask task)
+{
+    std::coroutine_handle<> handle = task.m_handle;
+    m_tasks.push_back(std::move(task));
+    handle.resume();
+    Retire();
+}
+
+int PipelineExecutor::Poll()
+{
+    // Rescan from the front after every resumption: a resumed frame may
+    // release a slot or advance a sequence that an older waiter is blocked
+    // on, and older frames go first.
+    int resumed = 0;
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (size_t i = 0; i < m_waiting.size(); ++i)
+        {
+            if (!m_waiting[i].ready())
+            {
+                continue;
+            }
+            const std::coroutine_handle<> handle = m_waiting[i].handle;
+            m_waiting.erase(m_waiting.begin() + i);
+            handle.resume();
+            ++resumed;
+            progress = true;
+            break;
+        }
+        Retire();
+    }
+    return resumed;
+}
+
+void PipelineExecutor::Retire()
+{
+    for (size_t i = 0; i < m_tasks.size();)
+    {
+        const std::coroutine_handle<FrameTask::promise_type> handle = m_tasks[i].m_handle;
+        if (!handle.done())
+        {
+            ++i;
+            continue;
+        }
+        const std::exception_ptr error = handle.promise().error;
+        m_tasks.erase(m_tasks.begin() + i);
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+FrameSlots::FrameSlots(int count)
+    : m_count(count)
+{
+    for (int slot = 0; slot < count; ++slot)
+    {
+        m_free.push_back(slot);
+    }
+}
+
+void FrameSlots::Acquisition::await_suspend(std::coroutine_handle<> handle)
+{
+    FrameSlots* owner = slots;
+    executor->When([owner] { return !owner->m_free.empty(); }).await_suspend(handle);
+}
+
+int FrameSlots::Acquisition::await_resume()
+{
+    const int slot = slots->m_free.front();
+    slots->m_free.erase(slots->m_free.begin());
+    return slot;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <vector>
+
+// Coroutine frame pipeline. Each frame is a FrameTask that runs its stages in
+// order and co_awaits wherever the serial loop would block: a free frame
+// slot, a GPU fence, its turn to present. The executor resumes whichever
+// frames can make progress, so while frame N waits for its readback fence
+// frame N+1 is already being produced. Everything runs on the thread that
+// calls Poll(), so the D3D11 immediate context and the GL context stay
+// single-threaded; the overlap comes from work the GPU (or the job system)
+// does while a frame is suspended.
+class PipelineExecutor;
+
+class FrameTask
+{
+public:
+    struct promise_type
+    {
+        FrameTask get_return_object()
+        {
+            return FrameTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // Frames start when spawned and stay alive after finishing until the
+        // executor has checked them for errors.
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        std::exception_ptr error;
+    };
+
+    FrameTask() = default;
+    FrameTask(FrameTask&& other) noexcept;
+    FrameTask& operator=(FrameTask&& other) noexcept;
+    ~FrameTask();
+
+    FrameTask(const FrameTask&) = delete;
+    FrameTask& operator=(const FrameTask&) = delete;
+
+private:
+    friend class PipelineExecutor;
+    explicit FrameTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Awaitable that suspends until |ready| returns true. It is tested when
+// awaited, so a condition that already holds does not suspend, and then on
+// every Poll() in the order the frames started waiting.
+struct PipelineCondition
+{
+    PipelineExecutor* executor;
+    std::function<bool()> ready;
+
+    bool await_ready() { return ready(); }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() {}
+};
+
+class PipelineExecutor
+{
+public:
+    // Runs |task| up to its first suspension point.
+    void Spawn(FrameTask task);
+
+    // Resumes every waiting frame whose condition holds, again until none
+    // does, and returns how many resumptions that took. An exception thrown
+    // by a frame is rethrown here.
+    int Poll();
+
+    int InFlight() const { return static_cast<int>(m_tasks.size()); }
+    bool Idle() const { return m_tasks.empty(); }
+
+    PipelineCondition When(std::function<bool()> ready) { return PipelineCondition{ this, std::move(ready) }; }
+
+private:
+    friend struct PipelineCondition;
+
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        std::function<bool()> ready;
+    };
+
+    void Retire();
+
+    std::vector<Waiter> m_waiting;
+    std::vector<FrameTask> m_tasks;
+};
+
+// A fixed set of per-frame resources (staging textures, fences). Acquire()
+// hands out a free index, suspending the frame until one is released.
+class FrameSlots
+{
+public:
+    struct Acquisition
+    {
+        FrameSlots* slots;
+        PipelineExecutor* executor;
+
+        bool await_ready() const { return !slots->m_free.empty(); }
+        void await_suspend(std::coroutine_handle<> handle);
+        int await_resume();
+    };
+
+    explicit FrameSlots(int count);
+
+    int Count() const { return m_count; }
+    Acquisition Acquire(PipelineExecutor& executor) { return Acquisition{ this, &executor }; }
+    void Release(int slot) { m_free.push_back(slot); }
+
+private:
+    int m_count;
+    std::vector<int> m_free;
+};
+
+// Keeps stages that must stay in frame order (presenting, anything touching a
+// single shared resource) in order: frame N's Turn() resumes after Advance()
+// has been called for every earlier frame.
+class FrameSequence
+{
+public:
+    PipelineCondition Turn(PipelineExecutor& executor, uint64_t frame)
+    {
+        return executor.When([this, frame] { return m_next == frame; });
+    }
+    void Advance() { ++m_next; }
+    uint64_t Next() const { return m_next; }
+
+private:
+    uint64_t m_next = 0;
+};
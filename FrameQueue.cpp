@@ -0,0 +1,108 @@
+#include "FrameQueue.h"
+
+#include "FrameLatency.h"
+
+const char* QueuePolicyName(QueuePolicy policy)
+{
+    switch (policy)
+    {
+    case QueuePolicy::Mailbox:        return "mailbox";
+    case QueuePolicy::BoundedLatency: return "bounded";
+    default:                          return "fifo";
+    }
+}
+
+FrameQueue::FrameQueue(QueuePolicy policy, uint64_t maxAgeNs)
+    : m_policy(policy)
+    , m_maxAgeNs(maxAgeNs)
+    , m_beginNs(FrameClockNs())
+    , m_delivered(0)
+    , m_droppedStale(0)
+    , m_droppedOld(0)
+    , m_blockedDepth(0)
+    , m_blockedSinceNs(0)
+    , m_blockedNs(0)
+{
+}
+
+void FrameQueue::Push(uint64_t frame, int slot, uint64_t producedNs)
+{
+    m_entries.push_back({ frame, slot, producedNs });
+}
+
+bool FrameQueue::Take(uint64_t frame, uint64_t nowNs, const std::function<bool(int)>& slotReady)
+{
+    size_t index = 0;
+    while (index < m_entries.size() && m_entries[index].frame != frame)
+    {
+        ++index;
+    }
+    if (index == m_entries.size())
+    {
+        // Never pushed; nothing to decide.
+        ++m_delivered;
+        return true;
+    }
+
+    const Entry entry = m_entries[index];
+    m_entries.erase(m_entries.begin() + index);
+    const bool newerQueued = index < m_entries.size();
+
+    bool deliver = true;
+    if (m_policy == QueuePolicy::Mailbox && newerQueued)
+    {
+        // Readbacks complete in submission order, so the last queued frame
+        // is the one to check: if it is ready, so is everything before it.
+        deliver = !slotReady(m_entries.back().slot);
+        m_droppedStale += deliver ? 0 : 1;
+    }
+    else if (m_policy == QueuePolicy::BoundedLatency && newerQueued)
+    {
+        deliver = nowNs - entry.producedNs <= m_maxAgeNs;
+        m_droppedOld += deliver ? 0 : 1;
+    }
+
+    if (deliver)
+    {
+        ++m_delivered;
+        m_queuedNs.Record(nowNs - entry.producedNs);
+    }
+    return deliver;
+}
+
+void FrameQueue::BeginProducerBlocked(uint64_t nowNs)
+{
+    if (m_blockedDepth++ == 0)
+    {
+        m_blockedSinceNs = nowNs;
+    }
+}
+
+void FrameQueue::EndProducerBlocked(uint64_t nowNs)
+{
+    if (m_blockedDepth > 0 && --m_blockedDepth == 0)
+    {
+        m_blockedNs += nowNs - m_blockedSinceNs;
+    }
+}
+
+void FrameQueue::Report(std::FILE* out) const
+{
+    const uint64_t nowNs = FrameClockNs();
+    const double wallNs = static_cast<double>(nowNs - m_beginNs);
+    const uint64_t blockedNs = m_blockedNs + (m_blockedDepth > 0 ? nowNs - m_blockedSinceNs : 0);
+    const uint64_t frames = m_delivered + m_droppedStale + m_droppedOld;
+    std::fprintf(out, "frame queue: %s", QueuePolicyName(m_policy));
+    if (m_policy == QueuePolicy::BoundedLatency)
+    {
+        std::fprintf(out, " (%.1f ms)", m_maxAgeNs / 1e6);
+    }
+    std::fprintf(out, ", %llu delivered, %llu dropped stale, %llu dropped old (%.1f%%)\n",
+                 static_cast<unsigned long long>(m_delivered), static_cast<unsigned long long>(m_droppedStale),
+                 static_cast<unsigned long long>(m_droppedOld),
+                 frames ? 100.0 * (m_droppedStale + m_droppedOld) / frames : 0.0);
+    std::fprintf(out, "producer blocked %.1f ms (%.1f%% of %.1f s)\n", blockedNs / 1e6,
+                 wallNs > 0.0 ? 100.0 * blockedNs / wallNs : 0.0, wallNs / 1e9);
+    std::fprintf(out, "queued until delivered (ms): mean %.3f, p50 %.3f, p99 %.3f, max %.3f\n", m_queuedNs.MeanNs() / 1e6,
+                 m_queuedNs.ValueAtQuantile(0.5) / 1e6, m_queuedNs.ValueAtQuantile(0.99) / 1e6, m_queuedNs.MaxNs() / 1e6);
+}
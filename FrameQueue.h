@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "FrameHistogram.h"
+
+enum class QueuePolicy
+{
+    Fifo,           // every frame, in order; a slow consumer stalls the producer
+    Mailbox,        // only the newest ready frame
+    BoundedLatency, // frames older than the age limit are skipped
+};
+
+const char* QueuePolicyName(QueuePolicy policy);
+
+// Decides which produced frames reach the consumer. Frames enter when they
+// are produced and leave when their turn to present comes: Take() says
+// whether to deliver them or drop them unseen, which frees their slot at
+// once instead of after a transfer and a draw. A dropped frame is only ever
+// replaced by a newer one already in the queue, so the consumer never runs
+// dry. The queue also keeps the delivery counters and the time the producer
+// spent unable to start a frame (all slots taken or the pipeline full).
+class FrameQueue
+{
+public:
+    FrameQueue(QueuePolicy policy, uint64_t maxAgeNs);
+
+    QueuePolicy Policy() const { return m_policy; }
+
+    // Frame |frame| finished producing into |slot| at |producedNs|.
+    void Push(uint64_t frame, int slot, uint64_t producedNs);
+
+    // Called when |frame|'s turn to present comes; removes it and returns
+    // whether to deliver it. |slotReady| says whether a slot's readback has
+    // completed, for the frames behind it that have not resumed yet.
+    bool Take(uint64_t frame, uint64_t nowNs, const std::function<bool(int)>& slotReady);
+
+    // Brackets a period the producer is stalled. Periods may nest or overlap
+    // (several frames waiting for a slot); only their union is counted.
+    void BeginProducerBlocked(uint64_t nowNs);
+    void EndProducerBlocked(uint64_t nowNs);
+
+    uint64_t Delivered() const { return m_delivered; }
+    uint64_t Dropped() const { return m_droppedStale + m_droppedOld; }
+    uint64_t ProducerBlockedNs() const { return m_blockedNs; }
+
+    // Policy, delivered and dropped frames, producer blocked time against
+    // wall time, and how long delivered frames waited in the queue.
+    void Report(std::FILE* out) const;
+
+private:
+    struct Entry
+    {
+        uint64_t frame;
+        int slot;
+        uint64_t producedNs;
+    };
+
+    QueuePolicy m_policy;
+    uint64_t m_maxAgeNs;
+    std::vector<Entry> m_entries;   // in frame order
+
+    uint64_t m_beginNs;
+    uint64_t m_delivered;
+    uint64_t m_droppedStale;
+    uint64_t m_droppedOld;
+    int m_blockedDepth;
+    uint64_t m_blockedSinceNs;
+    uint64_t m_blockedNs;
+    FrameHistogram m_queuedNs;      // produced to delivered
+};
@@ -0,0 +1,328 @@
+#include "FrameScale.h"
+
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    const int kWeightBits = 14;
+    const int kWeightOne = 1 << kWeightBits;
+    const double kPi = 3.14159265358979323846;
+
+    // Rows per job when Scale() is given a JobSystem.
+    const int kRowsPerJob = 16;
+
+    double Lanczos3(double t)
+    {
+        t = std::fabs(t);
+        if (t < 1e-9)
+        {
+            return 1.0;
+        }
+        if (t >= 3.0)
+        {
+            return 0.0;
+        }
+        return 3.0 * std::sin(kPi * t) * std::sin(kPi * t / 3.0) / (kPi * kPi * t * t);
+    }
+
+    inline __m128i RoundAndPack(__m128i acc0, __m128i acc1)
+    {
+        const __m128i half = _mm_set1_epi32(kWeightOne / 2);
+        acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, half), kWeightBits);
+        acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, half), kWeightBits);
+        return _mm_packs_epi32(acc0, acc1);
+    }
+
+    // One output pixel from |count| consecutive RGBA pixels, two taps per madd.
+    inline uint32_t FilterPixel(const uint8_t* src, const int16_t* weights, int count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        int tap = 0;
+        for (; tap + 1 < count; tap += 2)
+        {
+            // [r0 g0 b0 a0 r1 g1 b1 a1] -> [r0 r1 g0 g1 b0 b1 a0 a1]
+            const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + tap * 4)), zero);
+            const __m128i channels = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+            int32_t weightPair;
+            memcpy(&weightPair, weights + tap, sizeof(weightPair));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(channels, _mm_set1_epi32(weightPair)));
+        }
+        if (tap < count)
+        {
+            int32_t pixel;
+            memcpy(&pixel, src + tap * 4, sizeof(pixel));
+            const __m128i channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(channels, _mm_set1_epi32(static_cast<uint16_t>(weights[tap]))));
+        }
+
+        const __m128i packed = RoundAndPack(acc, acc);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed)));
+    }
+
+    // One output row from |count| source rows, 16 bytes (4 pixels) per step.
+    void FilterRows(const uint8_t* const* rows, const int16_t* weights, int count, uint8_t* dst, int bytes)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        int x = 0;
+        for (; x + 16 <= bytes; x += 16)
+        {
+            __m128i acc[4] = { zero, zero, zero, zero };
+            for (int tap = 0; tap < count; tap += 2)
+            {
+                const bool pair = tap + 1 < count;
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[tap] + x));
+                const __m128i b = pair ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[tap + 1] + x)) : zero;
+                const __m128i weight = _mm_set1_epi32(static_cast<uint16_t>(weights[tap]) |
+                    (pair ? static_cast<int32_t>(weights[tap + 1]) << 16 : 0));
+
+                const __m128i aLo = _mm_unpacklo_epi8(a, zero);
+                const __m128i aHi = _mm_unpackhi_epi8(a, zero);
+                const __m128i bLo = _mm_unpacklo_epi8(b, zero);
+                const __m128i bHi = _mm_unpackhi_epi8(b, zero);
+                acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), weight));
+                acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), weight));
+                acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), weight));
+                acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), weight));
+            }
+            const __m128i result = _mm_packus_epi16(RoundAndPack(acc[0], acc[1]), RoundAndPack(acc[2], acc[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), result);
+        }
+
+        for (; x < bytes; ++x)
+        {
+            int sum = kWeightOne / 2;
+            for (int tap = 0; tap < count; ++tap)
+            {
+                sum += rows[tap][x] * weights[tap];
+            }
+            sum >>= kWeightBits;
+            dst[x] = static_cast<uint8_t>(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+        }
+    }
+}
+
+const char* ScaleFilterName(ScaleFilter filter)
+{
+    return filter == ScaleFilter::Lanczos3 ? "lanczos" : "box";
+}
+
+FrameScaler::FrameScaler()
+    : m_srcWidth(0)
+    , m_srcHeight(0)
+    , m_dstWidth(0)
+    , m_dstHeight(0)
+    , m_horizontal{ {}, {}, 0 }
+    , m_vertical{ {}, {}, 0 }
+{
+}
+
+void FrameScaler::BuildTaps(int srcSize, int dstSize, ScaleFilter filter, Taps& taps)
+{
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const double stretch = std::max(scale, 1.0);
+    const double support = filter == ScaleFilter::Box ? 0.5 * stretch : 3.0 * stretch;
+
+    const int count = std::min(srcSize, static_cast<int>(std::ceil(2.0 * support)) + 2);
+    taps.count = count;
+    taps.first.assign(dstSize, 0);
+    taps.weights.assign(static_cast<size_t>(dstSize) * count, 0);
+
+    std::vector<double> weights(srcSize);
+    for (int i = 0; i < dstSize; ++i)
+    {
+        // Source pixel j covers [j, j + 1); edge taps are clamped onto the border.
+        const double center = (i + 0.5) * scale;
+        const int lo = static_cast<int>(std::floor(center - support));
+        const int hi = static_cast<int>(std::ceil(center + support));
+        const int clampedLo = std::min(std::max(lo, 0), srcSize - 1);
+        const int clampedHi = std::min(std::max(hi - 1, 0), srcSize - 1);
+        std::fill(weights.begin() + clampedLo, weights.begin() + clampedHi + 1, 0.0);
+
+        int minIndex = srcSize;
+        int maxIndex = -1;
+        double total = 0.0;
+        for (int j = lo; j < hi; ++j)
+        {
+            double w;
+            if (filter == ScaleFilter::Box)
+            {
+                w = std::min(j + 1.0, center + support) - std::max(static_cast<double>(j), center - support);
+                w = std::max(w, 0.0);
+            }
+            else
+            {
+                w = Lanczos3((j + 0.5 - center) / stretch);
+            }
+            if (w == 0.0)
+            {
+                continue;
+            }
+
+            const int index = std::min(std::max(j, 0), srcSize - 1);
+            minIndex = std::min(minIndex, index);
+            maxIndex = std::max(maxIndex, index);
+            weights[index] += w;
+            total += w;
+        }
+
+        const int start = std::min(minIndex, srcSize - count);
+        taps.first[i] = start;
+        int16_t* out = &taps.weights[static_cast<size_t>(i) * count];
+        int sum = 0;
+        int largest = minIndex - start;
+        for (int j = minIndex; j <= maxIndex; ++j)
+        {
+            const int value = static_cast<int>(std::lround(weights[j] / total * kWeightOne));
+            out[j - start] = static_cast<int16_t>(value);
+            sum += value;
+            if (std::abs(value) > std::abs(out[largest]))
+            {
+                largest = j - start;
+            }
+        }
+        // Make every row sum to exactly 1.0 so flat areas stay flat.
+        out[largest] = static_cast<int16_t>(out[largest] + kWeightOne - sum);
+    }
+}
+
+bool FrameScaler::Configure(int srcWidth, int srcHeight, int dstWidth, int dstHeight, ScaleFilter filter)
+{
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0)
+    {
+        return false;
+    }
+
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+    BuildTaps(srcWidth, dstWidth, filter, m_horizontal);
+    BuildTaps(srcHeight, dstHeight, filter, m_vertical);
+    m_intermediate.resize(static_cast<size_t>(dstWidth) * 4 * srcHeight);
+    return true;
+}
+
+void FrameScaler::Scale(const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch, JobSystem* jobs)
+{
+    const size_t midPitch = static_cast<size_t>(m_dstWidth) * 4;
+    auto horizontal = [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
+        {
+            const uint8_t* row = src + y * srcPitch;
+            uint32_t* out = reinterpret_cast<uint32_t*>(&m_intermediate[y * midPitch]);
+            for (int x = 0; x < m_dstWidth; ++x)
+            {
+                const int16_t* weights = &m_horizontal.weights[static_cast<size_t>(x) * m_horizontal.count];
+                out[x] = FilterPixel(row + m_horizontal.first[x] * 4, weights, m_horizontal.count);
+            }
+        }
+    };
+    auto vertical = [&](int first, int last)
+    {
+        std::vector<const uint8_t*> rows(m_vertical.count);
+        for (int y = first; y < last; ++y)
+        {
+            for (int tap = 0; tap < m_vertical.count; ++tap)
+            {
+                rows[tap] = &m_intermediate[(m_vertical.first[y] + tap) * midPitch];
+            }
+            const int16_t* weights = &m_vertical.weights[static_cast<size_t>(y) * m_vertical.count];
+            FilterRows(rows.data(), weights, m_vertical.count, dst + y * dstPitch, static_cast<int>(midPitch));
+        }
+    };
+
+    // The vertical pass reads intermediate rows from anywhere in its window,
+    // so the passes stay two separate fork-joins.
+    if (!jobs)
+    {
+        horizontal(0, m_srcHeight);
+        vertical(0, m_dstHeight);
+        return;
+    }
+    jobs->ParallelFor(m_srcHeight, kRowsPerJob, horizontal);
+    jobs->ParallelFor(m_dstHeight, kRowsPerJob, vertical);
+}
+
+int MipLevelForTarget(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    int level = 0;
+    while ((srcWidth >> (level + 1)) >= dstWidth && (srcHeight >> (level + 1)) >= dstHeight &&
+           (srcWidth >> (level + 1)) > 0 && (srcHeight >> (level + 1)) > 0)
+    {
+        ++level;
+    }
+    return level;
+}
+
+void RunScaleBenchmark(std::FILE* out)
+{
+    struct FrameSize { int width; int height; };
+    const FrameSize sources[] = { { 1024, 1024 }, { 3840, 2160 } };
+    const int iterations = 10;
+
+    std::fprintf(out, "%-10s %-10s %5s %12s %12s %10s %9s %9s\n",
+        "source", "target", "level", "readback MB", "upload MB", "MB/s@60", "box ms", "lanczos ms");
+    for (const FrameSize& source : sources)
+    {
+        // Targets: every mip level down to 1/16 plus one non power-of-two size.
+        std::vector<FrameSize> targets;
+        for (int level = 0; level <= 4; ++level)
+        {
+            targets.push_back({ source.width >> level, source.height >> level });
+        }
+        targets.push_back({ source.width * 7 / 10, source.height * 7 / 10 });
+
+        FrameBuffer full(static_cast<size_t>(source.width) * 4 * source.height);
+        for (size_t i = 0; i < full.Size(); ++i)
+        {
+            full.Data()[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+        }
+
+        for (const FrameSize& target : targets)
+        {
+            // Read back the nearest mip level (box-filtered here, GenerateMips
+            // on the GPU), then resample it to the exact target on the CPU.
+            const int level = MipLevelForTarget(source.width, source.height, target.width, target.height);
+            const int levelWidth = source.width >> level;
+            const int levelHeight = source.height >> level;
+            FrameBuffer levelPixels(static_cast<size_t>(levelWidth) * 4 * levelHeight);
+            FrameScaler mip;
+            mip.Configure(source.width, source.height, levelWidth, levelHeight, ScaleFilter::Box);
+            mip.Scale(full.Data(), static_cast<size_t>(source.width) * 4, levelPixels.Data(), static_cast<size_t>(levelWidth) * 4);
+
+            FrameBuffer scaled(static_cast<size_t>(target.width) * 4 * target.height);
+            double filterMs[2] = { 0.0, 0.0 };
+            const bool resample = levelWidth != target.width || levelHeight != target.height;
+            for (int filter = 0; filter < 2 && resample; ++filter)
+            {
+                FrameScaler scaler;
+                scaler.Configure(levelWidth, levelHeight, target.width, target.height,
+                                 filter ? ScaleFilter::Lanczos3 : ScaleFilter::Box);
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i)
+                {
+                    scaler.Scale(levelPixels.Data(), static_cast<size_t>(levelWidth) * 4,
+                                 scaled.Data(), static_cast<size_t>(target.width) * 4);
+                }
+                filterMs[filter] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            }
+
+            const double readbackMB = levelPixels.Size() / 1048576.0;
+            const double uploadMB = static_cast<double>(target.width) * 4 * target.height / 1048576.0;
+            char sourceLabel[32];
+            char targetLabel[32];
+            std::snprintf(sourceLabel, sizeof(sourceLabel), "%dx%d", source.width, source.height);
+            std::snprintf(targetLabel, sizeof(targetLabel), "%dx%d", target.width, target.height);
+            std::fprintf(out, "%-10s %-10s %5d %12.2f %12.2f %10.1f %9.3f %9.3f\n", sourceLabel, targetLabel,
+                level, readbackMB, uploadMB, (readbackMB + uploadMB) * 60.0, filterMs[0], filterMs[1]);
+        }
+    }
+}
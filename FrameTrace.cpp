@@ -0,0 +1,130 @@
+#include "FrameTrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_traceEnabled(false);
+
+namespace
+{
+    const size_t kEventsPerThread = 1 << 16;
+
+    struct TraceEvent
+    {
+        const char* name;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+
+    // Written only by its owning thread. |count| is the number of events
+    // ever recorded, published with release ordering; event i lives at
+    // i % kEventsPerThread until event i + kEventsPerThread replaces it.
+    struct ThreadBuffer
+    {
+        uint32_t threadId;
+        std::atomic<const char*> threadName;
+        std::atomic<size_t> count;
+        TraceEvent events[kEventsPerThread];
+    };
+
+    std::mutex s_registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> s_registry;
+
+    ThreadBuffer* LocalBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer)
+        {
+            std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+            std::lock_guard<std::mutex> lock(s_registryMutex);
+            created->threadId = static_cast<uint32_t>(s_registry.size() + 1);
+            created->threadName.store(nullptr, std::memory_order_relaxed);
+            created->count.store(0, std::memory_order_relaxed);
+            buffer = created.get();
+            s_registry.push_back(std::move(created));
+        }
+        return buffer;
+    }
+
+    const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+}
+
+void TraceSetEnabled(bool enabled)
+{
+    g_traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceSetThreadName(const char* name)
+{
+    LocalBuffer()->threadName.store(name, std::memory_order_release);
+}
+
+uint64_t TraceNow()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - s_epoch).count());
+}
+
+void TraceRecord(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    ThreadBuffer* buffer = LocalBuffer();
+    const size_t index = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[index % kEventsPerThread] = TraceEvent{ name, beginNs, endNs };
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void TraceWriteChromeJson(std::FILE* out)
+{
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : s_registry)
+    {
+        const char* threadName = buffer->threadName.load(std::memory_order_acquire);
+        if (threadName)
+        {
+            std::fprintf(out, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", buffer->threadId, threadName);
+            first = false;
+        }
+
+        // Copy the last kEventsPerThread events, then drop any the owner
+        // may have started to overwrite while they were being copied.
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        size_t oldest = count > kEventsPerThread ? count - kEventsPerThread : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(count - oldest);
+        for (size_t i = oldest; i < count; ++i)
+        {
+            events.push_back(buffer->events[i % kEventsPerThread]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const size_t countAfter = buffer->count.load(std::memory_order_relaxed);
+        const size_t overwritten = countAfter >= kEventsPerThread && countAfter - kEventsPerThread + 1 > oldest
+            ? countAfter - kEventsPerThread + 1 - oldest : 0;
+        const size_t skip = overwritten < events.size() ? overwritten : events.size();
+        oldest += skip;
+
+        if (oldest != 0 && skip < events.size())
+        {
+            std::fprintf(out, "%s{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"name\":\"overwrote %llu older events\",\"ts\":%.3f}",
+                first ? "" : ",\n", buffer->threadId, static_cast<unsigned long long>(oldest),
+                events[skip].beginNs / 1000.0);
+            first = false;
+        }
+        for (size_t i = skip; i < events.size(); ++i)
+        {
+            const TraceEvent& event = events[i];
+            std::fprintf(out, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", buffer->threadId, event.name,
+                event.beginNs / 1000.0, (event.endNs - event.beginNs) / 1000.0);
+            first = false;
+        }
+    }
+
+    std::fprintf(out, "\n]}\n");
+}
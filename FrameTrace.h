@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Scoped timeline zones for the frame pipeline, exported as Chrome trace JSON
+// (load in chrome://tracing or ui.perfetto.dev). Zones are compiled in for
+// PROFILE builds and cost one relaxed atomic load while tracing is off.
+// Each thread records into its own fixed ring that overwrites its oldest
+// events, so a dump holds the most recent ones; recording never locks.
+
+#ifdef PROFILE
+#define FRAME_TRACE_ENABLED 1
+#endif
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool TraceIsEnabled()
+{
+    return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+void TraceSetEnabled(bool enabled);
+void TraceSetThreadName(const char* name);
+uint64_t TraceNow();
+
+// |name| must outlive the trace (string literals).
+void TraceRecord(const char* name, uint64_t beginNs, uint64_t endNs);
+
+// Writes the events each thread still holds, oldest first.
+void TraceWriteChromeJson(std::FILE* out);
+
+class TraceZone
+{
+public:
+    explicit TraceZone(const char* name)
+        : m_name(TraceIsEnabled() ? name : nullptr)
+        , m_begin(m_name ? TraceNow() : 0)
+    {
+    }
+
+    ~TraceZone()
+    {
+        if (m_name)
+        {
+            TraceRecord(m_name, m_begin, TraceNow());
+        }
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef FRAME_TRACE_ENABLED
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#endif
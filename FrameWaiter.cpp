@@ -0,0 +1,181 @@
+#include "FrameWaiter.h"
+
+#include "FrameLatency.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace
+{
+    const char* WakeName(int wake)
+    {
+        switch (static_cast<FrameWaiter::Wake>(wake))
+        {
+        case FrameWaiter::Wake::Message: return "message";
+        case FrameWaiter::Wake::Event:   return "event";
+        case FrameWaiter::Wake::Timer:   return "timer";
+        default:                         return "timeout";
+        }
+    }
+
+    // User plus kernel time of the calling thread.
+    uint64_t ThreadCpuNs()
+    {
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        {
+            return 0;
+        }
+        const uint64_t ticks = ((static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) +
+                               ((static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+        return ticks * 100;
+    }
+}
+
+FrameWaiter::FrameWaiter()
+    : m_timer(nullptr)
+    , m_highResolution(false)
+    , m_intervalNs(0)
+    , m_nextDueNs(0)
+    , m_beginNs(FrameClockNs())
+    , m_blockedNs(0)
+    , m_beginCpuNs(ThreadCpuNs())
+{
+}
+
+FrameWaiter::~FrameWaiter()
+{
+    if (m_timer)
+    {
+        CloseHandle(m_timer);
+    }
+}
+
+bool FrameWaiter::Initialize()
+{
+    // High-resolution timers (Windows 10 1803) fire within the requested
+    // 100 ns unit instead of at the next scheduler tick.
+    m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    m_highResolution = m_timer != nullptr;
+    if (!m_timer)
+    {
+        m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+    m_beginNs = FrameClockNs();
+    m_beginCpuNs = ThreadCpuNs();
+    return m_timer != nullptr;
+}
+
+void FrameWaiter::SetFrameInterval(uint64_t intervalNs)
+{
+    m_intervalNs = intervalNs;
+    m_nextDueNs = FrameClockNs();
+}
+
+bool FrameWaiter::FrameDue()
+{
+    if (m_intervalNs == 0)
+    {
+        return true;
+    }
+
+    const uint64_t nowNs = FrameClockNs();
+    if (nowNs < m_nextDueNs)
+    {
+        return false;
+    }
+    // A frame that ran long pushes the schedule back instead of letting the
+    // next ones start in a burst to catch up.
+    m_nextDueNs += m_intervalNs;
+    if (m_nextDueNs <= nowNs)
+    {
+        m_nextDueNs = nowNs + m_intervalNs;
+    }
+    return true;
+}
+
+FrameWaiter::Wake FrameWaiter::Wait(const HANDLE* events, int eventCount, bool untilFrameDue, DWORD timeoutMs)
+{
+    HANDLE handles[kMaxEvents + 1];
+    int handleCount = 0;
+    for (int i = 0; i < eventCount && i < kMaxEvents; ++i)
+    {
+        handles[handleCount++] = events[i];
+    }
+
+    const uint64_t beginNs = FrameClockNs();
+    const bool paced = untilFrameDue && m_intervalNs != 0;
+    if (untilFrameDue && (!paced || beginNs >= m_nextDueNs))
+    {
+        return Wake::Timer;
+    }
+
+    int timerIndex = -1;
+    if (paced)
+    {
+        // Relative due time in 100 ns units. Without a timer the wait timeout
+        // paces instead, at millisecond (or scheduler tick) resolution.
+        const uint64_t waitNs = m_nextDueNs - beginNs;
+        LARGE_INTEGER due;
+        due.QuadPart = -static_cast<LONGLONG>((waitNs + 99) / 100);
+        if (m_timer && SetWaitableTimer(m_timer, &due, 0, nullptr, nullptr, FALSE))
+        {
+            timerIndex = handleCount;
+            handles[handleCount++] = m_timer;
+        }
+        else
+        {
+            const DWORD waitMs = static_cast<DWORD>((waitNs + 999999) / 1000000);
+            timeoutMs = waitMs < timeoutMs ? waitMs : timeoutMs;
+        }
+    }
+
+    // MWMO_INPUTAVAILABLE also wakes for messages that arrived before the
+    // call but were only peeked at, not removed.
+    const DWORD result = MsgWaitForMultipleObjectsEx(handleCount, handles, timeoutMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    const uint64_t endNs = FrameClockNs();
+
+    Wake wake = Wake::Timeout;
+    if (result == WAIT_OBJECT_0 + static_cast<DWORD>(handleCount))
+        wake = Wake::Message;
+    else if (timerIndex >= 0 && result == WAIT_OBJECT_0 + static_cast<DWORD>(timerIndex))
+        wake = Wake::Timer;
+    else if (result < WAIT_OBJECT_0 + static_cast<DWORD>(handleCount))
+        wake = Wake::Event;
+    else if (result == WAIT_TIMEOUT && paced && endNs >= m_nextDueNs)
+        wake = Wake::Timer;
+
+    if (wake == Wake::Timer)
+    {
+        m_timerLate.Record(endNs > m_nextDueNs ? endNs - m_nextDueNs : 0);
+    }
+    else if (timerIndex >= 0)
+    {
+        CancelWaitableTimer(m_timer);
+    }
+    m_blocked[static_cast<int>(wake)].Record(endNs - beginNs);
+    m_blockedNs += endNs - beginNs;
+    return wake;
+}
+
+void FrameWaiter::Report(std::FILE* out) const
+{
+    const double wallNs = static_cast<double>(FrameClockNs() - m_beginNs);
+    const double cpuNs = static_cast<double>(ThreadCpuNs() - m_beginCpuNs);
+    std::fprintf(out, "render loop: %.1f s, %.1f%% blocked, render thread CPU %.1f%%, %s pacing timer\n",
+                 wallNs / 1e9, wallNs > 0.0 ? 100.0 * m_blockedNs / wallNs : 0.0,
+                 wallNs > 0.0 ? 100.0 * cpuNs / wallNs : 0.0, m_highResolution ? "high-resolution" : "tick");
+    std::fprintf(out, "%-10s %8s %9s %9s %9s %9s\n", "wake", "count", "mean", "p50", "p99", "max(ms)");
+    for (int wake = 0; wake < static_cast<int>(Wake::Count); ++wake)
+    {
+        const FrameHistogram& blocked = m_blocked[wake];
+        std::fprintf(out, "%-10s %8llu %9.3f %9.3f %9.3f %9.3f\n", WakeName(wake),
+                     static_cast<unsigned long long>(blocked.Count()), blocked.MeanNs() / 1e6,
+                     blocked.ValueAtQuantile(0.5) / 1e6, blocked.ValueAtQuantile(0.99) / 1e6, blocked.MaxNs() / 1e6);
+    }
+    std::fprintf(out, "%-10s %8llu %9.3f %9.3f %9.3f %9.3f  (wake-up after due time)\n", "timer late",
+                 static_cast<unsigned long long>(m_timerLate.Count()), m_timerLate.MeanNs() / 1e6,
+                 m_timerLate.ValueAtQuantile(0.5) / 1e6, m_timerLate.ValueAtQuantile(0.99) / 1e6,
+                 m_timerLate.MaxNs() / 1e6);
+}
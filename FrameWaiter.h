@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <cstdio>
+
+#include "FrameHistogram.h"
+
+// Blocks the render thread in MsgWaitForMultipleObjectsEx until one of its
+// wake sources fires: a window message, an event the frame pipeline waits on
+// (the readback fence, signalled by the GPU) or the frame pacing timer. When
+// nothing can make progress (a minimized consumer, the gap before the next
+// paced frame, every frame in flight waiting on the GPU) the thread sleeps
+// instead of spinning on PeekMessage.
+class FrameWaiter
+{
+public:
+    enum class Wake
+    {
+        Message,
+        Event,
+        Timer,
+        Timeout,
+        Count,
+    };
+
+    FrameWaiter();
+    ~FrameWaiter();
+
+    FrameWaiter(const FrameWaiter&) = delete;
+    FrameWaiter& operator=(const FrameWaiter&) = delete;
+
+    // Creates the pacing timer, high-resolution where the OS has one.
+    bool Initialize();
+
+    // Frames start |intervalNs| apart; 0 runs them back to back.
+    void SetFrameInterval(uint64_t intervalNs);
+
+    // Whether a frame may start now; moves the schedule on when it may.
+    bool FrameDue();
+
+    // Waits for a message, one of |events| or, with |untilFrameDue|, the time
+    // the next frame is due, for at most |timeoutMs|.
+    Wake Wait(const HANDLE* events, int eventCount, bool untilFrameDue, DWORD timeoutMs = INFINITE);
+
+    // Wakes per source with the time blocked before each, how late the timer
+    // woke the thread and the render thread's CPU time against wall time.
+    // Call on the render thread.
+    void Report(std::FILE* out) const;
+
+private:
+    static const int kMaxEvents = 4;
+
+    HANDLE m_timer;
+    bool m_highResolution;
+    uint64_t m_intervalNs;
+    uint64_t m_nextDueNs;
+    uint64_t m_beginNs;
+    uint64_t m_blockedNs;
+    uint64_t m_beginCpuNs;
+    FrameHistogram m_blocked[static_cast<int>(Wake::Count)];
+    FrameHistogram m_timerLate;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+enum class GLProfile
+{
+    Legacy,         // wglCreateContext: whatever the driver gives (compatibility)
+    Compatibility,  // WGL_ARB_create_context, 3.3 compatibility profile
+    Core,           // WGL_ARB_create_context, 3.3 core profile
+};
+
+struct GLContextOptions
+{
+    GLProfile profile = GLProfile::Legacy;
+    // Ask for a KHR_no_error context (WGL_ARB_create_context_no_error): the
+    // driver may skip error checking, and any GL error becomes undefined
+    // behaviour. Ignored for legacy contexts and when unsupported.
+    bool noError = false;
+};
+
+const char* GLProfileName(GLProfile profile);
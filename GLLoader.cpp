@@ -0,0 +1,119 @@
+#include "GLLoader.h"
+
+#include "wglew.h"
+
+#include <cstdint>
+#include <cstring>
+
+// Core entry points the renderer, HUD and shader helpers call, up to OpenGL 3.0.
+#define GL_CORE_ENTRY_POINTS(X) \
+    X(PFNGLACTIVETEXTUREPROC,           ActiveTexture) \
+    X(PFNGLATTACHSHADERPROC,            AttachShader) \
+    X(PFNGLBEGINQUERYPROC,              BeginQuery) \
+    X(PFNGLBINDBUFFERPROC,              BindBuffer) \
+    X(PFNGLBINDVERTEXARRAYPROC,         BindVertexArray) \
+    X(PFNGLBUFFERDATAPROC,              BufferData) \
+    X(PFNGLCOMPILESHADERPROC,           CompileShader) \
+    X(PFNGLCREATEPROGRAMPROC,           CreateProgram) \
+    X(PFNGLCREATESHADERPROC,            CreateShader) \
+    X(PFNGLDELETEBUFFERSPROC,           DeleteBuffers) \
+    X(PFNGLDELETEPROGRAMPROC,           DeleteProgram) \
+    X(PFNGLDELETEQUERIESPROC,           DeleteQueries) \
+    X(PFNGLDELETESHADERPROC,            DeleteShader) \
+    X(PFNGLDELETEVERTEXARRAYSPROC,      DeleteVertexArrays) \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray) \
+    X(PFNGLENDQUERYPROC,                EndQuery) \
+    X(PFNGLGENBUFFERSPROC,              GenBuffers) \
+    X(PFNGLGENQUERIESPROC,              GenQueries) \
+    X(PFNGLGENVERTEXARRAYSPROC,         GenVertexArrays) \
+    X(PFNGLGETPROGRAMIVPROC,            GetProgramiv) \
+    X(PFNGLGETQUERYOBJECTIVPROC,        GetQueryObjectiv) \
+    X(PFNGLGETSHADERIVPROC,             GetShaderiv) \
+    X(PFNGLGETUNIFORMLOCATIONPROC,      GetUniformLocation) \
+    X(PFNGLLINKPROGRAMPROC,             LinkProgram) \
+    X(PFNGLMAPBUFFERRANGEPROC,          MapBufferRange) \
+    X(PFNGLSHADERSOURCEPROC,            ShaderSource) \
+    X(PFNGLUNIFORM1FPROC,               Uniform1f) \
+    X(PFNGLUNIFORM1IPROC,               Uniform1i) \
+    X(PFNGLUNIFORM2FPROC,               Uniform2f) \
+    X(PFNGLUNIFORM4FPROC,               Uniform4f) \
+    X(PFNGLUNMAPBUFFERPROC,             UnmapBuffer) \
+    X(PFNGLUSEPROGRAMPROC,              UseProgram) \
+    X(PFNGLVERTEXATTRIBPOINTERPROC,     VertexAttribPointer)
+
+#define GL_DX_INTEROP_ENTRY_POINTS(X) \
+    X(PFNWGLDXCLOSEDEVICENVPROC,              DXCloseDeviceNV) \
+    X(PFNWGLDXLOCKOBJECTSNVPROC,              DXLockObjectsNV) \
+    X(PFNWGLDXOPENDEVICENVPROC,               DXOpenDeviceNV) \
+    X(PFNWGLDXREGISTEROBJECTNVPROC,           DXRegisterObjectNV) \
+    X(PFNWGLDXSETRESOURCESHAREHANDLENVPROC,   DXSetResourceShareHandleNV) \
+    X(PFNWGLDXUNLOCKOBJECTSNVPROC,            DXUnlockObjectsNV) \
+    X(PFNWGLDXUNREGISTEROBJECTNVPROC,         DXUnregisterObjectNV)
+
+static PROC Resolve(const char* name)
+{
+    // Some ICDs return small sentinel values rather than null for names they
+    // do not export.
+    PROC proc = wglGetProcAddress(name);
+    const intptr_t value = reinterpret_cast<intptr_t>(proc);
+    return (value >= -1 && value <= 3) ? nullptr : proc;
+}
+
+bool HasExtension(const char* list, const char* name)
+{
+    if (!list)
+    {
+        return false;
+    }
+
+    const size_t length = std::strlen(name);
+    for (const char* match = std::strstr(list, name); match; match = std::strstr(match + length, name))
+    {
+        const bool starts = match == list || match[-1] == ' ';
+        const bool ends = match[length] == '\0' || match[length] == ' ';
+        if (starts && ends)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LoadGLEntryPoints(HDC hdc)
+{
+#define RESOLVE_GL(type, name) \
+    __glew##name = reinterpret_cast<type>(Resolve("gl" #name)); \
+    core = core && __glew##name != nullptr;
+#define RESOLVE_WGL(type, name) \
+    __wglew##name = reinterpret_cast<type>(Resolve("wgl" #name)); \
+    interop = interop && __wglew##name != nullptr;
+
+    bool core = true;
+    GL_CORE_ENTRY_POINTS(RESOLVE_GL)
+
+    bool interop = true;
+    GL_DX_INTEROP_ENTRY_POINTS(RESOLVE_WGL)
+
+#undef RESOLVE_GL
+#undef RESOLVE_WGL
+
+    // GL_EXTENSIONS is still valid here: the first context is always legacy.
+    const char* glExtensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    __glewDebugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKPROC>(Resolve("glDebugMessageCallback"));
+    __GLEW_KHR_debug = HasExtension(glExtensions, "GL_KHR_debug") && __glewDebugMessageCallback;
+    __glewGetQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VPROC>(Resolve("glGetQueryObjectui64v"));
+    __GLEW_ARB_timer_query = HasExtension(glExtensions, "GL_ARB_timer_query") && __glewGetQueryObjectui64v;
+    __GLEW_EXT_texture_sRGB_decode = HasExtension(glExtensions, "GL_EXT_texture_sRGB_decode");
+
+    __wglewGetExtensionsStringARB = reinterpret_cast<PFNWGLGETEXTENSIONSSTRINGARBPROC>(Resolve("wglGetExtensionsStringARB"));
+    __WGLEW_ARB_extensions_string = __wglewGetExtensionsStringARB != nullptr;
+    const char* wglExtensions = __wglewGetExtensionsStringARB ? __wglewGetExtensionsStringARB(hdc) : nullptr;
+
+    __wglewCreateContextAttribsARB = reinterpret_cast<PFNWGLCREATECONTEXTATTRIBSARBPROC>(Resolve("wglCreateContextAttribsARB"));
+    __WGLEW_ARB_create_context = HasExtension(wglExtensions, "WGL_ARB_create_context") && __wglewCreateContextAttribsARB;
+    __WGLEW_ARB_create_context_profile = HasExtension(wglExtensions, "WGL_ARB_create_context_profile");
+    __WGLEW_NV_DX_interop = HasExtension(wglExtensions, "WGL_NV_DX_interop") && interop;
+    __WGLEW_NV_DX_interop2 = HasExtension(wglExtensions, "WGL_NV_DX_interop2") && __WGLEW_NV_DX_interop;
+
+    return core;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Windows.h>
+#include "glew.h"
+
+// Minimal stand-in for glewInit(). glewInit resolves every entry point GLEW
+// knows (a few thousand wglGetProcAddress calls) and scans the extension
+// string once per extension; this resolves only what the program calls and
+// tests only the extensions it checks:
+//   GLEW_KHR_debug, GLEW_ARB_timer_query, WGLEW_ARB_extensions_string,
+//   WGLEW_ARB_create_context(_profile), WGLEW_NV_DX_interop(2)
+// Pointers and flags are written to GLEW's own variables, so call sites keep
+// the glew.h names. A GL call beyond OpenGL 1.1 needs a line in the tables
+// in GLLoader.cpp, otherwise its pointer stays null.
+//
+// Needs a current context on |hdc|. Returns false if a core entry point
+// (up to OpenGL 3.0) is missing; a missing extension just clears its flag.
+bool LoadGLEntryPoints(HDC hdc);
+
+// True if |name| is a whole entry of the space-separated extension |list|.
+bool HasExtension(const char* list, const char* name);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <Windows.h>
+#include "glew.h"
+
+// Compiles and links a vertex + fragment shader pair; returns 0 on failure.
+// Shader objects are deleted once linked.
+GLuint LinkProgram(const char* vertexSource, const char* fragmentSource);
@@ -0,0 +1,81 @@
+#include "GLValidation.h"
+
+#include <atomic>
+#include <cstdio>
+
+static std::atomic<uint64_t> s_errorCount{ 0 };
+static bool s_callbackInstalled = false;
+
+static const char* DebugTypeName(GLenum type)
+{
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    default:                                return "other";
+    }
+}
+
+static void APIENTRY DebugCallback(GLenum, GLenum type, GLuint id, GLenum severity, GLsizei,
+                                   const GLchar* message, GLvoid*)
+{
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+    {
+        return;
+    }
+    if (type == GL_DEBUG_TYPE_ERROR)
+    {
+        s_errorCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    char line[1024];
+    std::snprintf(line, sizeof(line), "GL %s (id %u, %s): %s\n", DebugTypeName(type), id,
+        severity == GL_DEBUG_SEVERITY_HIGH ? "high" : (severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium" : "low"),
+        message);
+    OutputDebugStringA(line);
+}
+
+void DebugValidation::Install()
+{
+    if (!GLEW_KHR_debug)
+    {
+        return;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(DebugCallback, nullptr);
+    s_callbackInstalled = true;
+}
+
+void DebugValidation::CheckGL(const char* where)
+{
+    if (s_callbackInstalled)
+    {
+        return;
+    }
+
+    for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
+    {
+        s_errorCount.fetch_add(1, std::memory_order_relaxed);
+        char line[128];
+        std::snprintf(line, sizeof(line), "GL error 0x%04X in %s\n", error, where);
+        OutputDebugStringA(line);
+    }
+}
+
+uint64_t DebugValidation::ErrorCount()
+{
+    return s_errorCount.load(std::memory_order_relaxed);
+}
+
+void DebugValidation::ReportInteropFailure(const char* call)
+{
+    s_errorCount.fetch_add(1, std::memory_order_relaxed);
+    char line[128];
+    std::snprintf(line, sizeof(line), "%s failed (GetLastError 0x%08lX)\n", call, GetLastError());
+    OutputDebugStringA(line);
+}
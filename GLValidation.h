@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include "glew.h"
+
+// Compile-time validation policy for the GL consumer. The renderer writes its
+// checks against GLValidation, which is DebugValidation in debug builds (or
+// with GL_VALIDATION defined) and NoValidation otherwise:
+//  - DebugValidation installs a synchronous KHR_debug callback, so every GL
+//    error and warning is reported at the offending call, and checks the
+//    result of every WGL_NV_DX_interop call. Reports go to the debugger
+//    output (OutputDebugString).
+//  - NoValidation's checks are empty inline functions, so release hot paths
+//    compile to the bare GL calls with no glGetError or branches added.
+
+#if defined(_DEBUG) || defined(GL_VALIDATION)
+#define GL_VALIDATION_ENABLED 1
+#endif
+
+struct NoValidation
+{
+    static constexpr bool kEnabled = false;
+    static constexpr const char* kName = "none";
+
+    static void Install() {}
+    static void CheckInterop(bool, const char*) {}
+    static void CheckGL(const char*) {}
+    static uint64_t ErrorCount() { return 0; }
+};
+
+struct DebugValidation
+{
+    static constexpr bool kEnabled = true;
+    static constexpr const char* kName = "debug";
+
+    // Call with the context current. Without KHR_debug, CheckGL falls back
+    // to draining glGetError.
+    static void Install();
+    static void CheckInterop(bool succeeded, const char* call)
+    {
+        if (!succeeded)
+        {
+            ReportInteropFailure(call);
+        }
+    }
+    static void CheckGL(const char* where);
+    static uint64_t ErrorCount();
+
+private:
+    static void ReportInteropFailure(const char* call);
+};
+
+#ifdef GL_VALIDATION_ENABLED
+using GLValidation = DebugValidation;
+#else
+using GLValidation = NoValidation;
+#endif
@@ -0,0 +1,224 @@
+#include "InteropLockMonitor.h"
+
+#include <chrono>
+#include <cstdarg>
+
+#include "FrameLatency.h"
+
+const double InteropLockMonitor::kThresholdsMs[kThresholdCount] = { 1.0, 4.0, 16.0 };
+
+namespace
+{
+    const char* CallName(InteropLockMonitor::Call call)
+    {
+        return call == InteropLockMonitor::Call::Lock ? "lock" : "unlock";
+    }
+}
+
+InteropLockMonitor::InteropLockMonitor()
+    : m_resourceCount(0)
+    , m_watchdogQuit(false)
+    , m_budgetNs(0)
+    , m_log(nullptr)
+{
+    for (Resource& resource : m_resources)
+    {
+        for (CallStats& stats : resource.calls)
+        {
+            for (std::atomic<uint64_t>& count : stats.overThreshold)
+            {
+                count.store(0, std::memory_order_relaxed);
+            }
+            stats.failures.store(0, std::memory_order_relaxed);
+            stats.stalls.store(0, std::memory_order_relaxed);
+        }
+        resource.callBeginNs.store(0, std::memory_order_relaxed);
+        resource.callKind.store(0, std::memory_order_relaxed);
+        resource.stallReported.store(false, std::memory_order_relaxed);
+        resource.lockedNs = 0;
+        resource.lastLockNs = 0;
+    }
+}
+
+InteropLockMonitor::~InteropLockMonitor()
+{
+    StopWatchdog();
+}
+
+int InteropLockMonitor::RegisterResource(const char* name)
+{
+    const int id = m_resourceCount.load(std::memory_order_relaxed);
+    if (id >= kMaxResources)
+    {
+        return -1;
+    }
+
+    m_resources[id].name = name;
+    m_resourceCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+void InteropLockMonitor::Begin(int resource, Call call)
+{
+    if (resource < 0)
+    {
+        return;
+    }
+
+    Resource& entry = m_resources[resource];
+    entry.stallReported.store(false, std::memory_order_relaxed);
+    entry.callKind.store(static_cast<int>(call), std::memory_order_relaxed);
+    entry.callBeginNs.store(FrameClockNs(), std::memory_order_release);
+}
+
+void InteropLockMonitor::End(int resource, Call call, bool succeeded)
+{
+    if (resource < 0)
+    {
+        return;
+    }
+
+    Resource& entry = m_resources[resource];
+    const uint64_t endNs = FrameClockNs();
+    const uint64_t beginNs = entry.callBeginNs.exchange(0, std::memory_order_acq_rel);
+    const uint64_t durationNs = endNs - beginNs;
+
+    CallStats& stats = entry.calls[static_cast<int>(call)];
+    stats.durations.Record(durationNs);
+    for (int i = 0; i < kThresholdCount; ++i)
+    {
+        if (durationNs > kThresholdsMs[i] * 1e6)
+        {
+            stats.overThreshold[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!succeeded)
+    {
+        stats.failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (entry.stallReported.load(std::memory_order_acquire))
+    {
+        Log("interop %s of '%s' returned after %.1f ms%s\n", CallName(call), entry.name.c_str(),
+            durationNs / 1e6, succeeded ? "" : " (failed)");
+    }
+
+    // Held time runs from the end of a successful lock to the start of the
+    // matching unlock.
+    if (call == Call::Lock)
+    {
+        entry.lastLockNs = durationNs;
+        entry.lockedNs = succeeded ? endNs : 0;
+    }
+    else if (entry.lockedNs != 0)
+    {
+        entry.held.Record(beginNs - entry.lockedNs);
+        entry.lockedNs = 0;
+    }
+}
+
+void InteropLockMonitor::StartWatchdog(double budgetMs, std::FILE* log)
+{
+    StopWatchdog();
+
+    m_log = log;
+    m_budgetNs = static_cast<uint64_t>(budgetMs * 1e6);
+    m_watchdogQuit = false;
+    m_watchdog = std::thread(&InteropLockMonitor::WatchdogLoop, this);
+}
+
+void InteropLockMonitor::StopWatchdog()
+{
+    if (!m_watchdog.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_watchdogMutex);
+        m_watchdogQuit = true;
+    }
+    m_watchdogWake.notify_all();
+    m_watchdog.join();
+}
+
+void InteropLockMonitor::WatchdogLoop()
+{
+    // Poll at a quarter of the budget so a stall is seen within 1.25 budgets.
+    const auto interval = std::chrono::nanoseconds(m_budgetNs / 4 > 1000000 ? m_budgetNs / 4 : 1000000);
+
+    std::unique_lock<std::mutex> lock(m_watchdogMutex);
+    while (!m_watchdogWake.wait_for(lock, interval, [this] { return m_watchdogQuit; }))
+    {
+        const uint64_t nowNs = FrameClockNs();
+        const int count = m_resourceCount.load(std::memory_order_acquire);
+        for (int id = 0; id < count; ++id)
+        {
+            Resource& entry = m_resources[id];
+            const uint64_t beginNs = entry.callBeginNs.load(std::memory_order_acquire);
+            if (beginNs == 0 || nowNs < beginNs || nowNs - beginNs < m_budgetNs ||
+                entry.stallReported.exchange(true, std::memory_order_acq_rel))
+            {
+                continue;
+            }
+
+            const Call call = static_cast<Call>(entry.callKind.load(std::memory_order_relaxed));
+            entry.calls[static_cast<int>(call)].stalls.fetch_add(1, std::memory_order_relaxed);
+            Log("interop %s of '%s' blocked for %.1f ms (budget %.1f ms), still waiting\n", CallName(call),
+                entry.name.c_str(), (nowNs - beginNs) / 1e6, m_budgetNs / 1e6);
+        }
+    }
+}
+
+void InteropLockMonitor::Log(const char* format, ...)
+{
+    std::lock_guard<std::mutex> lock(m_logMutex);
+    if (!m_log)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(m_log, format, args);
+    va_end(args);
+    std::fflush(m_log);
+}
+
+double InteropLockMonitor::LastLockMs(int resource) const
+{
+    return resource < 0 ? 0.0 : m_resources[resource].lastLockNs / 1e6;
+}
+
+void InteropLockMonitor::Report(std::FILE* out) const
+{
+    const int count = m_resourceCount.load(std::memory_order_acquire);
+    for (int id = 0; id < count; ++id)
+    {
+        const Resource& entry = m_resources[id];
+        std::fprintf(out, "resource '%s'\n", entry.name.c_str());
+        std::fprintf(out, "  %-7s %8s %9s %9s %9s %9s %7s %7s %7s %6s %6s\n",
+            "call", "count", "mean", "p50", "p99", "max(ms)", ">1ms", ">4ms", ">16ms", "fail", "stall");
+
+        for (int call = 0; call < 2; ++call)
+        {
+            const CallStats& stats = entry.calls[call];
+            std::fprintf(out, "  %-7s %8llu %9.3f %9.3f %9.3f %9.3f", CallName(static_cast<Call>(call)),
+                static_cast<unsigned long long>(stats.durations.Count()), stats.durations.MeanNs() / 1e6,
+                stats.durations.ValueAtQuantile(0.5) / 1e6, stats.durations.ValueAtQuantile(0.99) / 1e6,
+                stats.durations.MaxNs() / 1e6);
+            for (const std::atomic<uint64_t>& over : stats.overThreshold)
+            {
+                std::fprintf(out, " %7llu", static_cast<unsigned long long>(over.load(std::memory_order_relaxed)));
+            }
+            std::fprintf(out, " %6llu %6llu\n",
+                static_cast<unsigned long long>(stats.failures.load(std::memory_order_relaxed)),
+                static_cast<unsigned long long>(stats.stalls.load(std::memory_order_relaxed)));
+        }
+
+        std::fprintf(out, "  %-7s %8llu %9.3f %9.3f %9.3f %9.3f\n", "held",
+            static_cast<unsigned long long>(entry.held.Count()), entry.held.MeanNs() / 1e6,
+            entry.held.ValueAtQuantile(0.5) / 1e6, entry.held.ValueAtQuantile(0.99) / 1e6,
+            entry.held.MaxNs() / 1e6);
+    }
+}
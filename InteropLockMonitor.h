@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FrameHistogram.h"
+
+// Times the interop lock/unlock calls and the time each resource stays
+// locked, per registered resource. wglDXLockObjectsNV can block for as long
+// as the producer keeps the resource busy (and forever on some drivers), so
+// an optional watchdog thread logs any call that runs past its budget while
+// it is still blocked, and again when it returns.
+class InteropLockMonitor
+{
+public:
+    enum class Call
+    {
+        Lock,
+        Unlock,
+    };
+
+    InteropLockMonitor();
+    ~InteropLockMonitor();
+
+    InteropLockMonitor(const InteropLockMonitor&) = delete;
+    InteropLockMonitor& operator=(const InteropLockMonitor&) = delete;
+
+    // Returns the id passed to the other calls, or -1 when the table is full.
+    int RegisterResource(const char* name);
+
+    // Bracket each wglDXLockObjectsNV / wglDXUnlockObjectsNV call.
+    void Begin(int resource, Call call);
+    void End(int resource, Call call, bool succeeded);
+
+    // Starts the watchdog; stall and recovery lines go to |log|, which must
+    // outlive the monitor or a later StopWatchdog().
+    void StartWatchdog(double budgetMs, std::FILE* log);
+    void StopWatchdog();
+
+    // Per resource: lock, unlock and held-time percentiles, waits above each
+    // threshold, failed calls and watchdog stalls.
+    void Report(std::FILE* out) const;
+
+    // Most recent lock wait of |resource| in milliseconds.
+    double LastLockMs(int resource) const;
+
+private:
+    static const int kMaxResources = 4;
+    static const int kThresholdCount = 3;
+    static const double kThresholdsMs[kThresholdCount];
+
+    struct CallStats
+    {
+        FrameHistogram durations;
+        std::atomic<uint64_t> overThreshold[kThresholdCount];
+        std::atomic<uint64_t> failures;
+        std::atomic<uint64_t> stalls;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        CallStats calls[2];
+        FrameHistogram held;
+        std::atomic<uint64_t> callBeginNs;   // 0 while no call is in flight
+        std::atomic<int> callKind;
+        std::atomic<bool> stallReported;
+        uint64_t lockedNs;
+        uint64_t lastLockNs;
+    };
+
+    void WatchdogLoop();
+    void Log(const char* format, ...);
+
+    Resource m_resources[kMaxResources];
+    std::atomic<int> m_resourceCount;
+
+    std::thread m_watchdog;
+    std::mutex m_watchdogMutex;
+    std::condition_variable m_watchdogWake;
+    bool m_watchdogQuit;
+    uint64_t m_budgetNs;
+
+    std::mutex m_logMutex;
+    std::FILE* m_log;
+};
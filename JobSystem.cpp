@@ -0,0 +1,241 @@
+#include "JobSystem.h"
+
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // Yields before an idle worker sleeps; covers the gap between the
+    // stages of one frame without a kernel wake-up per stage.
+    const int kSpinRounds = 64;
+
+    thread_local const void* t_system = nullptr;
+    thread_local int t_slot = 0;
+
+    uint64_t NowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+JobSystem::JobSystem(int threadCount, const ThreadPlacement& placement)
+    : m_placement(placement)
+    , m_slots(new Slot[std::max(threadCount, 1)])
+    , m_queued(0)
+    , m_sleeping(0)
+    , m_quit(false)
+    , m_frameBeginNs(NowNs())
+    , m_lastBusyNs(std::max(threadCount, 1), 0)
+    , m_lastJobs(0)
+    , m_lastSteals(0)
+    , m_lastFrame{}
+    , m_utilization(new FrameHistogram[std::max(threadCount, 1)])
+{
+    for (int slot = 1; slot < threadCount; ++slot)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, slot);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit.store(true);
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::ParallelFor(int count, int grain, const std::function<void(int, int)>& body)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    const int slot = CurrentSlot();
+    std::atomic<int> remaining(count);
+    Execute(slot, Range{ &body, 0, count, std::max(grain, 1), &remaining });
+
+    Range range;
+    while (remaining.load(std::memory_order_acquire) > 0)
+    {
+        if (PopOrSteal(slot, range))
+            Execute(slot, range);
+        else
+            std::this_thread::yield();
+    }
+}
+
+int JobSystem::CurrentSlot() const
+{
+    // Workers use their own deque; any other thread joins as slot 0.
+    return t_system == this ? t_slot : 0;
+}
+
+void JobSystem::Push(int slot, const Range& range)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_slots[slot].mutex);
+        m_slots[slot].ranges.push_back(range);
+    }
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+bool JobSystem::PopOrSteal(int slot, Range& range)
+{
+    {
+        Slot& own = m_slots[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.ranges.empty())
+        {
+            range = own.ranges.back();
+            own.ranges.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    const int slots = ThreadCount();
+    for (int i = 1; i < slots; ++i)
+    {
+        Slot& victim = m_slots[(slot + i) % slots];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ranges.empty())
+        {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+            m_queued.fetch_sub(1);
+            m_slots[slot].steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::Execute(int slot, Range range)
+{
+    while (range.end - range.begin > range.grain && ThreadCount() > 1)
+    {
+        const int middle = range.begin + (range.end - range.begin) / 2;
+        Push(slot, Range{ range.body, middle, range.end, range.grain, range.remaining });
+        range.end = middle;
+    }
+
+    const uint64_t beginNs = NowNs();
+    {
+        TRACE_ZONE("Job");
+        (*range.body)(range.begin, range.end);
+    }
+    Slot& own = m_slots[slot];
+    own.busyNs.fetch_add(NowNs() - beginNs, std::memory_order_relaxed);
+    own.jobs.fetch_add(1, std::memory_order_relaxed);
+    range.remaining->fetch_sub(range.end - range.begin, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(int slot)
+{
+    t_system = this;
+    t_slot = slot;
+    TraceSetThreadName("job worker");
+    ApplyThreadPlacement(m_placement);
+
+    Range range;
+    int idle = 0;
+    while (!m_quit.load(std::memory_order_relaxed))
+    {
+        if (PopOrSteal(slot, range))
+        {
+            Execute(slot, range);
+            idle = 0;
+            continue;
+        }
+        if (++idle < kSpinRounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Push() bumps m_queued before it checks m_sleeping, and this thread
+        // counts itself sleeping before it checks m_queued, so a push can't
+        // slip between the check and the wait unnoticed.
+        m_sleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [&] { return m_quit.load() || m_queued.load() > 0; });
+        }
+        m_sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+JobFrameStats JobSystem::EndFrame()
+{
+    const uint64_t nowNs = NowNs();
+    const uint64_t elapsedNs = std::max<uint64_t>(nowNs - m_frameBeginNs, 1);
+    m_frameBeginNs = nowNs;
+
+    uint64_t busyNs = 0;
+    uint64_t jobs = 0;
+    uint64_t steals = 0;
+    for (int slot = 0; slot < ThreadCount(); ++slot)
+    {
+        const uint64_t total = m_slots[slot].busyNs.load(std::memory_order_relaxed);
+        const uint64_t frameBusy = total - m_lastBusyNs[slot];
+        m_lastBusyNs[slot] = total;
+        busyNs += frameBusy;
+        m_utilization[slot].Record(std::min<uint64_t>(frameBusy * 1000 / elapsedNs, 1000));
+        jobs += m_slots[slot].jobs.load(std::memory_order_relaxed);
+        steals += m_slots[slot].steals.load(std::memory_order_relaxed);
+    }
+
+    m_lastFrame.jobs = jobs - m_lastJobs;
+    m_lastFrame.steals = steals - m_lastSteals;
+    m_lastFrame.utilization = std::min(1.0, static_cast<double>(busyNs) / (static_cast<double>(elapsedNs) * ThreadCount()));
+    m_lastJobs = jobs;
+    m_lastSteals = steals;
+    m_jobsPerFrame.Record(m_lastFrame.jobs);
+    m_stealsPerFrame.Record(m_lastFrame.steals);
+    return m_lastFrame;
+}
+
+void JobSystem::Report(std::FILE* out) const
+{
+    std::fprintf(out, "job system: %d threads, %llu frames\n", ThreadCount(),
+                 static_cast<unsigned long long>(m_jobsPerFrame.Count()));
+    std::fprintf(out, "%-10s %8s %8s %8s %8s\n", "per frame", "mean", "p50", "p99", "max");
+    std::fprintf(out, "%-10s %8.1f %8llu %8llu %8llu\n", "jobs", m_jobsPerFrame.MeanNs(),
+                 static_cast<unsigned long long>(m_jobsPerFrame.ValueAtQuantile(0.5)),
+                 static_cast<unsigned long long>(m_jobsPerFrame.ValueAtQuantile(0.99)),
+                 static_cast<unsigned long long>(m_jobsPerFrame.MaxNs()));
+    std::fprintf(out, "%-10s %8.1f %8llu %8llu %8llu\n", "steals", m_stealsPerFrame.MeanNs(),
+                 static_cast<unsigned long long>(m_stealsPerFrame.ValueAtQuantile(0.5)),
+                 static_cast<unsigned long long>(m_stealsPerFrame.ValueAtQuantile(0.99)),
+                 static_cast<unsigned long long>(m_stealsPerFrame.MaxNs()));
+
+    std::fprintf(out, "%-10s %8s %8s %8s %8s\n", "thread", "util %", "p50 %", "p99 %", "max %");
+    for (int slot = 0; slot < ThreadCount(); ++slot)
+    {
+        const FrameHistogram& utilization = m_utilization[slot];
+        char label[24];
+        if (slot == 0)
+            std::snprintf(label, sizeof(label), "caller");
+        else
+            std::snprintf(label, sizeof(label), "worker %d", slot);
+        std::fprintf(out, "%-10s %8.1f %8.1f %8.1f %8.1f\n", label, utilization.MeanNs() / 10.0,
+                     utilization.ValueAtQuantile(0.5) / 10.0, utilization.ValueAtQuantile(0.99) / 10.0,
+                     utilization.MaxNs() / 10.0);
+    }
+}
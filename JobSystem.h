@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameHistogram.h"
+#include "ThreadPlacement.h"
+
+struct JobFrameStats
+{
+    uint64_t jobs;          // ranges executed
+    uint64_t steals;        // ranges taken from another thread's deque
+    double utilization;     // busy time / (threads x frame time), 0..1
+};
+
+// Work-stealing scheduler shared by every CPU stage (copies, YUV and sRGB
+// conversion, resampling, the software producer). Each worker and the
+// thread that calls ParallelFor (slot 0) owns a deque. A range is split in
+// halves as it runs: the owner pushes the upper half and keeps going on the
+// lower one, popping its newest (smallest) range when done, while idle
+// threads steal the oldest (largest) range from the front of another deque.
+// The caller works on its own ranges until all of them are done, so a job
+// may itself call ParallelFor. Idle workers spin briefly, then sleep until
+// work is pushed.
+class JobSystem
+{
+public:
+    // |threadCount| includes the calling thread; workers run with |placement|.
+    explicit JobSystem(int threadCount, const ThreadPlacement& placement = ThreadPlacement());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int ThreadCount() const { return static_cast<int>(m_workers.size()) + 1; }
+
+    // Fork-join: runs body(begin, end) over [0, count) in ranges of at most
+    // |grain| items (at least one; a single range without workers) and
+    // returns once all of them have run.
+    void ParallelFor(int count, int grain, const std::function<void(int, int)>& body);
+
+    // Closes the current frame's accounting and returns its numbers; call
+    // once per frame from the thread that drives the pipeline.
+    JobFrameStats EndFrame();
+    const JobFrameStats& LastFrame() const { return m_lastFrame; }
+
+    // Per-frame jobs and steals, and per-thread utilization percentiles over
+    // every frame closed so far.
+    void Report(std::FILE* out) const;
+
+private:
+    struct Range
+    {
+        const std::function<void(int, int)>* body;
+        int begin;
+        int end;
+        int grain;
+        std::atomic<int>* remaining;   // items of this ParallelFor not yet run
+    };
+
+    struct alignas(64) Slot
+    {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+        std::atomic<uint64_t> busyNs{ 0 };
+        std::atomic<uint64_t> jobs{ 0 };
+        std::atomic<uint64_t> steals{ 0 };
+    };
+
+    int CurrentSlot() const;
+    void Push(int slot, const Range& range);
+    bool PopOrSteal(int slot, Range& range);
+    void Execute(int slot, Range range);
+    void WorkerLoop(int slot);
+
+    ThreadPlacement m_placement;
+    std::unique_ptr<Slot[]> m_slots;
+    std::vector<std::thread> m_workers;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<int> m_queued;
+    std::atomic<int> m_sleeping;
+    std::atomic<bool> m_quit;
+
+    uint64_t m_frameBeginNs;
+    std::vector<uint64_t> m_lastBusyNs;
+    uint64_t m_lastJobs;
+    uint64_t m_lastSteals;
+    JobFrameStats m_lastFrame;
+    FrameHistogram m_jobsPerFrame;
+    FrameHistogram m_stealsPerFrame;
+    std::unique_ptr<FrameHistogram[]> m_utilization;   // per slot, in 1/1000
+};
@@ -1,6 +1,103 @@
 #include "OpenGLSharedRenderer.h"
 
 #include "wglew.h"
+#include "FrameTrace.h"
+#include "GLLoader.h"
+#include "GLProgram.h"
+#include "GLValidation.h"
+
+// WGL_ARB_create_context_no_error postdates the bundled wglew.h.
+#ifndef WGL_CONTEXT_OPENGL_NO_ERROR_ARB
+#define WGL_CONTEXT_OPENGL_NO_ERROR_ARB 0x31B3
+#endif
+
+// Client-side layout of a packed frame format; YUV planes keep the caller's
+// GL_RED / GL_RG bytes.
+static void PackedPixelFormat(FrameFormat format, GLenum& dataFormat, GLenum& dataType)
+{
+    switch (format)
+    {
+    case FrameFormat::Rgba8:   dataFormat = GL_RGBA; dataType = GL_UNSIGNED_BYTE; break;
+    case FrameFormat::Bgra8:   dataFormat = GL_BGRA; dataType = GL_UNSIGNED_BYTE; break;
+    case FrameFormat::Rgb10A2: dataFormat = GL_RGBA; dataType = GL_UNSIGNED_INT_2_10_10_10_REV; break;
+    case FrameFormat::Rgba16F: dataFormat = GL_RGBA; dataType = GL_HALF_FLOAT; break;
+    default: break;
+    }
+}
+
+// sRGB frames are drawn as stored: the window's pixel format is not asked to
+// be sRGB-capable, so decoding on sample and relying on GL_FRAMEBUFFER_SRGB
+// to encode on write would show them too dark. Call with the texture bound.
+static void SkipSrgbDecode()
+{
+    if (GLEW_EXT_texture_sRGB_decode)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SRGB_DECODE_EXT, GL_SKIP_DECODE_EXT);
+    }
+}
+
+// ===== GLSL shader (YUV -> RGB, BT.601 limited range) =====
+static const char* s_yuvVS =
+"#version 120\n"
+"varying vec2 uv;"
+"void main() {"
+"  uv = gl_MultiTexCoord0.xy;"
+"  gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;"
+"}";
+
+static const char* s_yuvFS =
+"#version 120\n"
+"uniform sampler2D texY;"
+"uniform sampler2D texU;"
+"uniform sampler2D texV;"
+"uniform int interleavedChroma;"
+"varying vec2 uv;"
+"void main() {"
+"  float y = 1.164383 * (texture2D(texY, uv).r - 0.062745);"
+"  vec2 c = (interleavedChroma != 0) ? texture2D(texU, uv).rg"
+"                                    : vec2(texture2D(texU, uv).r, texture2D(texV, uv).r);"
+"  c -= vec2(0.501961);"
+"  gl_FragColor = vec4(y + 1.596027 * c.y,"
+"                      y - 0.391762 * c.x - 0.812968 * c.y,"
+"                      y + 2.017232 * c.x, 1.0);"
+"}";
+// ===== Core profile: full-window quad for every frame layout =====
+// Corners come from gl_VertexID (drawn as a 4-vertex strip from an empty
+// VAO); uv (0,0) is the top-left of the window, as with the legacy glOrtho.
+// |rect| places the quad (x0, y0, x1, y1 as fractions of the window) for
+// tiled surfaces; it is the whole window otherwise. |extent| is the part of
+// the texture that holds the picture (see SetSourceExtent).
+static const char* s_blitVS =
+"#version 330 core\n"
+"uniform vec4 rect;"
+"uniform vec2 extent;"
+"out vec2 uv;"
+"void main() {"
+"  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);"
+"  uv = corner * extent;"
+"  vec2 position = mix(rect.xy, rect.zw, corner);"
+"  gl_Position = vec4(position.x * 2.0 - 1.0, 1.0 - position.y * 2.0, 0.0, 1.0);"
+"}";
+
+static const char* s_blitFS =
+"#version 330 core\n"
+"uniform sampler2D texY;"
+"uniform sampler2D texU;"
+"uniform sampler2D texV;"
+"uniform int frameLayout;"   // 0 packed RGBA, 1 NV12, 2 I420
+"in vec2 uv;"
+"out vec4 fragColor;"
+"void main() {"
+"  if (frameLayout == 0) { fragColor = texture(texY, uv); return; }"
+"  float y = 1.164383 * (texture(texY, uv).r - 0.062745);"
+"  vec2 c = (frameLayout == 1) ? texture(texU, uv).rg"
+"                              : vec2(texture(texU, uv).r, texture(texV, uv).r);"
+"  c -= vec2(0.501961);"
+"  fragColor = vec4(y + 1.596027 * c.y,"
+"                   y - 0.391762 * c.x - 0.812968 * c.y,"
+"                   y + 2.017232 * c.x, 1.0);"
+"}";
+// ==========================================================
 
 OpenGLSharedRenderer::OpenGLSharedRenderer(int width, int height)
     : m_width(width)
@@ -14,6 +111,26 @@ OpenGLSharedRenderer::OpenGLSharedRenderer(int width, int height)
     , m_sharedTexture(nullptr)
     , m_sharedHandle(nullptr)
     , m_isStereoContext(false)
+    , m_srgb(false)
+    , m_profile(GLProfile::Legacy)
+    , m_noErrorContext(false)
+    , m_entryPointLoadNs(0)
+    , m_blitProgram(0)
+    , m_blitVao(0)
+    , m_blitRectLocation(-1)
+    , m_blitExtentLocation(-1)
+    , m_sourceExtent{ 1.0f, 1.0f }
+    , m_frameFormat(FrameFormat::Rgba8)
+    , m_frameWidth(0)
+    , m_frameHeight(0)
+    , m_planeTextures{ 0, 0, 0 }
+    , m_yuvProgram(0)
+    , m_uploadBuffer(0)
+    , m_uploadMapping(nullptr)
+    , m_readMarker(false)
+    , m_lastPresent{}
+    , m_markerRow{}
+    , m_lockResource(-1)
 {
 }
 
@@ -22,7 +139,7 @@ OpenGLSharedRenderer::~OpenGLSharedRenderer()
     Cleanup();
 }
 
-bool OpenGLSharedRenderer::Initialize(HWND hwnd)
+bool OpenGLSharedRenderer::Initialize(HWND hwnd, const GLContextOptions& options)
 {
     if (!hwnd)
     {
@@ -67,7 +184,21 @@ bool OpenGLSharedRenderer::Initialize(HWND hwnd)
         return false;
     }
 
-    if (glewInit() != GLEW_OK)
+    // Entry points resolved through the legacy context stay valid for an
+    // attribute context on the same pixel format.
+    const uint64_t loadStart = FrameClockNs();
+    if (!LoadGLEntryPoints(m_hdc))
+    {
+        return false;
+    }
+    m_entryPointLoadNs = FrameClockNs() - loadStart;
+
+    if (options.profile != GLProfile::Legacy && !CreateContextWithAttribs(options))
+    {
+        return false;
+    }
+    GLValidation::Install();
+    if (m_profile == GLProfile::Core && !CreateBlitProgram())
     {
         return false;
     }
@@ -80,38 +211,114 @@ bool OpenGLSharedRenderer::Initialize(HWND hwnd)
     return true;
 }
 
-bool OpenGLSharedRenderer::SetupSharedTexture(ID3D11Device* device, ID3D11Texture2D* sharedTexture, HANDLE sharedHandle)
+bool OpenGLSharedRenderer::MakeCurrent()
 {
-    if (!device || !sharedTexture || !sharedHandle)
+    return m_context && wglMakeCurrent(m_hdc, m_context);
+}
+
+void OpenGLSharedRenderer::ReleaseCurrent()
+{
+    wglMakeCurrent(nullptr, nullptr);
+}
+
+// Replaces the legacy context with one from wglCreateContextAttribsARB.
+bool OpenGLSharedRenderer::CreateContextWithAttribs(const GLContextOptions& options)
+{
+    const bool core = options.profile == GLProfile::Core;
+    if (!WGLEW_ARB_create_context || !WGLEW_ARB_create_context_profile)
     {
         return false;
     }
 
-    if (!WGLEW_NV_DX_interop2)
+    const char* extensions = WGLEW_ARB_extensions_string ? wglGetExtensionsStringARB(m_hdc) : nullptr;
+    // Debug and no-error contexts are mutually exclusive; validation wins.
+    const bool noError = !GLValidation::kEnabled && options.noError &&
+                         HasExtension(extensions, "WGL_ARB_create_context_no_error");
+
+    int attribs[9] =
+    {
+        WGL_CONTEXT_MAJOR_VERSION_ARB, 3,
+        WGL_CONTEXT_MINOR_VERSION_ARB, 3,
+        WGL_CONTEXT_PROFILE_MASK_ARB, core ? WGL_CONTEXT_CORE_PROFILE_BIT_ARB : WGL_CONTEXT_COMPATIBILITY_PROFILE_BIT_ARB,
+    };
+    if (noError)
+    {
+        attribs[6] = WGL_CONTEXT_OPENGL_NO_ERROR_ARB;
+        attribs[7] = 1;
+    }
+    else if (GLValidation::kEnabled)
+    {
+        attribs[6] = WGL_CONTEXT_FLAGS_ARB;
+        attribs[7] = WGL_CONTEXT_DEBUG_BIT_ARB;
+    }
+    HGLRC context = wglCreateContextAttribsARB(m_hdc, nullptr, attribs);
+    if (!context)
     {
         return false;
     }
 
-    ReleaseSharedResources();
+    wglMakeCurrent(nullptr, nullptr);
+    wglDeleteContext(m_context);
+    m_context = context;
+    if (!wglMakeCurrent(m_hdc, m_context))
+    {
+        return false;
+    }
 
-    m_sharedTexture = sharedTexture;
-    m_sharedTexture->AddRef();
-    m_sharedHandle = sharedHandle;
+    m_profile = options.profile;
+    m_noErrorContext = noError;
+    return true;
+}
 
-    m_dxDeviceHandle = wglDXOpenDeviceNV(device);
-    if (!m_dxDeviceHandle)
+bool OpenGLSharedRenderer::CreateBlitProgram()
+{
+    m_blitProgram = LinkProgram(s_blitVS, s_blitFS);
+    if (!m_blitProgram)
+    {
+        return false;
+    }
+
+    glUseProgram(m_blitProgram);
+    glUniform1i(glGetUniformLocation(m_blitProgram, "texY"), 0);
+    glUniform1i(glGetUniformLocation(m_blitProgram, "texU"), 1);
+    glUniform1i(glGetUniformLocation(m_blitProgram, "texV"), 2);
+    m_blitRectLocation = glGetUniformLocation(m_blitProgram, "rect");
+    glUniform4f(m_blitRectLocation, 0.0f, 0.0f, 1.0f, 1.0f);
+    m_blitExtentLocation = glGetUniformLocation(m_blitProgram, "extent");
+    glUniform2f(m_blitExtentLocation, 1.0f, 1.0f);
+    glUseProgram(0);
+
+    // Core profiles refuse to draw without a bound vertex array, even an empty one.
+    glGenVertexArrays(1, &m_blitVao);
+    return m_blitVao != 0;
+}
+
+bool OpenGLSharedRenderer::SetupSharedTexture(ID3D11Device* device, ID3D11Texture2D* sharedTexture, HANDLE sharedHandle)
+{
+    if (!device || !sharedTexture || !sharedHandle)
+    {
+        return false;
+    }
+
+    if (!OpenInteropDevice(device))
     {
         return false;
     }
 
+    m_sharedTexture = sharedTexture;
+    m_sharedTexture->AddRef();
+    m_sharedHandle = sharedHandle;
+
     glGenTextures(1, &m_glTexture);
-    wglDXSetResourceShareHandleNV(m_sharedTexture, m_sharedHandle);
+    const BOOL shareHandleSet = wglDXSetResourceShareHandleNV(m_sharedTexture, m_sharedHandle);
+    GLValidation::CheckInterop(shareHandleSet != FALSE, "wglDXSetResourceShareHandleNV");
     m_glSharedHandle = wglDXRegisterObjectNV(
         m_dxDeviceHandle,
         m_sharedTexture,
         m_glTexture,
         GL_TEXTURE_2D,
         WGL_ACCESS_READ_ONLY_NV);
+    GLValidation::CheckInterop(m_glSharedHandle != nullptr, "wglDXRegisterObjectNV");
 
     if (!m_glSharedHandle)
     {
@@ -119,30 +326,414 @@ bool OpenGLSharedRenderer::SetupSharedTexture(ID3D11Device* device, ID3D11Textur
         return false;
     }
 
+    // A shared mip chain means the window is smaller than the source; let the
+    // sampler pick the level instead of aliasing from level 0.
+    D3D11_TEXTURE2D_DESC desc{};
+    m_sharedTexture->GetDesc(&desc);
+    m_srgb = desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    if (m_srgb)
+    {
+        if (!GLEW_EXT_texture_sRGB_decode)
+        {
+            OutputDebugStringA("OpenGLSharedRenderer: no GL_EXT_texture_sRGB_decode, sRGB frames will look too dark\n");
+        }
+        glBindTexture(GL_TEXTURE_2D, m_glTexture);
+        SkipSrgbDecode();
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    if (desc.MipLevels > 1)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_glTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    GLValidation::CheckGL("SetupSharedTexture");
+
+    if (m_lockResource < 0)
+    {
+        m_lockResource = m_lockMonitor.RegisterResource("shared texture");
+    }
     return true;
 }
 
-void OpenGLSharedRenderer::Render()
+bool OpenGLSharedRenderer::OpenInteropDevice(ID3D11Device* device)
+{
+    if (!WGLEW_NV_DX_interop2)
+    {
+        return false;
+    }
+
+    ReleaseSharedResources();
+
+    m_dxDeviceHandle = wglDXOpenDeviceNV(device);
+    GLValidation::CheckInterop(m_dxDeviceHandle != nullptr, "wglDXOpenDeviceNV");
+    return m_dxDeviceHandle != nullptr;
+}
+
+bool OpenGLSharedRenderer::SetupSharedTiles(ID3D11Device* device, const std::vector<SharedTile>& tiles,
+                                            int canvasWidth, int canvasHeight)
+{
+    if (!device || tiles.empty() || canvasWidth <= 0 || canvasHeight <= 0 || !OpenInteropDevice(device))
+    {
+        return false;
+    }
+
+    for (const SharedTile& tile : tiles)
+    {
+        if (!tile.texture || !tile.sharedHandle)
+        {
+            ReleaseSharedResources();
+            return false;
+        }
+
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        const BOOL shareHandleSet = wglDXSetResourceShareHandleNV(tile.texture, tile.sharedHandle);
+        GLValidation::CheckInterop(shareHandleSet != FALSE, "wglDXSetResourceShareHandleNV");
+        HANDLE object = wglDXRegisterObjectNV(m_dxDeviceHandle, tile.texture, texture, GL_TEXTURE_2D,
+            WGL_ACCESS_READ_ONLY_NV);
+        GLValidation::CheckInterop(object != nullptr, "wglDXRegisterObjectNV");
+
+        tile.texture->AddRef();
+        m_tileSources.push_back(tile.texture);
+        m_tileTextures.push_back(texture);
+        if (!object)
+        {
+            ReleaseSharedResources();
+            return false;
+        }
+        m_tileObjects.push_back(object);
+
+        const GLfloat rect[4] =
+        {
+            static_cast<GLfloat>(tile.x) / canvasWidth,
+            static_cast<GLfloat>(tile.y) / canvasHeight,
+            static_cast<GLfloat>(tile.x + tile.width) / canvasWidth,
+            static_cast<GLfloat>(tile.y + tile.height) / canvasHeight,
+        };
+        m_tileRects.insert(m_tileRects.end(), rect, rect + 4);
+
+        // Edge texels must not blend with the opposite edge of the tile.
+        D3D11_TEXTURE2D_DESC desc{};
+        tile.texture->GetDesc(&desc);
+        m_srgb = desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (m_srgb)
+        {
+            SkipSrgbDecode();
+        }
+        if (desc.MipLevels > 1)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    GLValidation::CheckGL("SetupSharedTiles");
+
+    if (m_lockResource < 0)
+    {
+        m_lockResource = m_lockMonitor.RegisterResource("shared tiles");
+    }
+    return true;
+}
+
+int OpenGLSharedRenderer::MaxTextureSize() const
+{
+    GLint size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+    return size;
+}
+
+bool OpenGLSharedRenderer::ReadSharedTexture(uint8_t* rgba, int width, int height)
 {
     if (!m_dxDeviceHandle || !m_glSharedHandle)
+    {
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC desc{};
+    m_sharedTexture->GetDesc(&desc);
+    if (static_cast<int>(desc.Width) != width || static_cast<int>(desc.Height) != height)
+    {
+        return false;
+    }
+
+    const BOOL locked = wglDXLockObjectsNV(m_dxDeviceHandle, 1, &m_glSharedHandle);
+    GLValidation::CheckInterop(locked != FALSE, "wglDXLockObjectsNV");
+    if (!locked)
+    {
+        return false;
+    }
+
+    // Drop stale errors so the check below belongs to the readback.
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+    glBindTexture(GL_TEXTURE_2D, m_glTexture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    const bool read = glGetError() == GL_NO_ERROR;
+
+    const BOOL unlocked = wglDXUnlockObjectsNV(m_dxDeviceHandle, 1, &m_glSharedHandle);
+    GLValidation::CheckInterop(unlocked != FALSE, "wglDXUnlockObjectsNV");
+    return read && unlocked;
+}
+
+bool OpenGLSharedRenderer::SetupFrameTextures(FrameFormat format, int width, int height, bool srgb)
+{
+    if (!m_context || width <= 0 || height <= 0 || (IsYuvFormat(format) && ((width | height) & 1)) ||
+        (srgb && format != FrameFormat::Rgba8 && format != FrameFormat::Bgra8))
+    {
+        return false;
+    }
+
+    ReleaseFrameTextures();
+
+    if (IsYuvFormat(format) && m_profile != GLProfile::Core && !CreateYuvProgram())
+    {
+        return false;
+    }
+
+    m_srgb = srgb;
+    m_frameFormat = format;
+    m_frameWidth = width;
+    m_frameHeight = height;
+
+    const int planeCount = FramePlaneCount(format);
+    glGenTextures(planeCount, m_planeTextures);
+    for (int plane = 0; plane < planeCount; ++plane)
+    {
+        // Without the decode extension plain RGBA8 holds the same bytes and
+        // samples them unchanged.
+        GLint internalFormat = srgb && GLEW_EXT_texture_sRGB_decode ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        GLenum dataFormat = GL_RGBA;
+        GLenum dataType = GL_UNSIGNED_BYTE;
+        PackedPixelFormat(format, dataFormat, dataType);
+        if (format == FrameFormat::Rgb10A2)
+            internalFormat = GL_RGB10_A2;
+        else if (format == FrameFormat::Rgba16F)
+            internalFormat = GL_RGBA16F;
+        int planeWidth = width;
+        int planeHeight = height;
+        if (IsYuvFormat(format))
+        {
+            const bool chroma = (plane > 0);
+            const bool interleaved = chroma && format == FrameFormat::Nv12;
+            internalFormat = interleaved ? GL_RG8 : GL_R8;
+            dataFormat = interleaved ? GL_RG : GL_RED;
+            planeWidth = chroma ? width / 2 : width;
+            planeHeight = chroma ? height / 2 : height;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_planeTextures[plane]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (internalFormat == GL_SRGB8_ALPHA8)
+        {
+            SkipSrgbDecode();
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, planeWidth, planeHeight, 0, dataFormat, dataType, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &m_uploadBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, FrameByteSize(format, width, height), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLValidation::CheckGL("SetupFrameTextures");
+    return true;
+}
+
+bool OpenGLSharedRenderer::UploadFrame(const VideoFrame& frame)
+{
+    if (m_planeTextures[0] == 0 || frame.format != m_frameFormat ||
+        frame.width != m_frameWidth || frame.height != m_frameHeight)
+    {
+        return false;
+    }
+
+    UploadPlanes(frame, nullptr);
+    return true;
+}
+
+// Maps the upload PBO and describes it as a tightly packed frame, so the
+// caller can copy or convert straight into driver memory.
+bool OpenGLSharedRenderer::BeginFrameUpload(VideoFrame& frame)
+{
+    if (m_uploadBuffer == 0 || m_uploadMapping)
+    {
+        return false;
+    }
+
+    const size_t size = FrameByteSize(m_frameFormat, m_frameWidth, m_frameHeight);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+    m_uploadMapping = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!m_uploadMapping)
+    {
+        return false;
+    }
+
+    frame = MakeVideoFrame(m_frameFormat, m_frameWidth, m_frameHeight, m_uploadMapping);
+    return true;
+}
+
+void OpenGLSharedRenderer::EndFrameUpload()
+{
+    TRACE_ZONE("EndFrameUpload");
+    if (!m_uploadMapping)
     {
         return;
     }
 
-    wglDXLockObjectsNV(m_dxDeviceHandle, 1, &m_glSharedHandle);
+    const VideoFrame frame = MakeVideoFrame(m_frameFormat, m_frameWidth, m_frameHeight, m_uploadMapping);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+    const bool unmapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    if (unmapped)
+    {
+        UploadPlanes(frame, m_uploadMapping);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_uploadMapping = nullptr;
+}
+
+// Uploads each plane; with |origin| set, plane pointers are turned into
+// offsets into the bound PBO.
+void OpenGLSharedRenderer::UploadPlanes(const VideoFrame& frame, const uint8_t* origin)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const int planeCount = FramePlaneCount(frame.format);
+    for (int plane = 0; plane < planeCount; ++plane)
+    {
+        const bool chroma = IsYuvFormat(frame.format) && plane > 0;
+        const int bytesPerPixel = chroma && frame.format == FrameFormat::Nv12 ? 2 : FramePixelBytes(frame.format);
+        GLenum dataFormat = bytesPerPixel == 2 ? GL_RG : GL_RED;
+        GLenum dataType = GL_UNSIGNED_BYTE;
+        PackedPixelFormat(frame.format, dataFormat, dataType);
+        const void* pixels = origin
+            ? reinterpret_cast<const void*>(static_cast<uintptr_t>(frame.planes[plane].data - origin))
+            : frame.planes[plane].data;
+
+        glBindTexture(GL_TEXTURE_2D, m_planeTextures[plane]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.planes[plane].pitch / bytesPerPixel);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+            chroma ? frame.width / 2 : frame.width,
+            chroma ? frame.height / 2 : frame.height,
+            dataFormat, dataType, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OpenGLSharedRenderer::Render()
+{
+    TRACE_ZONE("Render");
+    // A tiled surface locks and unlocks all of its tiles in one call.
+    const bool tiled = !m_tileObjects.empty();
+    HANDLE* interopObjects = tiled ? m_tileObjects.data() : &m_glSharedHandle;
+    const GLint interopCount = tiled ? static_cast<GLint>(m_tileObjects.size()) : 1;
+    const bool useInterop = m_dxDeviceHandle && (m_glSharedHandle || tiled);
+    if (!useInterop && m_planeTextures[0] == 0)
+    {
+        return;
+    }
+
+    m_lastPresent.renderBeginNs = FrameClockNs();
+
+    if (useInterop)
+    {
+        TRACE_ZONE("wglDXLockObjectsNV");
+        m_lockMonitor.Begin(m_lockResource, InteropLockMonitor::Call::Lock);
+        const BOOL locked = wglDXLockObjectsNV(m_dxDeviceHandle, interopCount, interopObjects);
+        GLValidation::CheckInterop(locked != FALSE, "wglDXLockObjectsNV");
+        m_lockMonitor.End(m_lockResource, InteropLockMonitor::Call::Lock, locked != FALSE);
+    }
+
+    // Quad covering x0..x1, y0..y1 as fractions of the window, top-left
+    // origin, showing the top-left |extent| of the bound texture.
+    auto drawQuad = [&](const GLfloat* rect, const GLfloat* extent)
+    {
+        if (m_profile == GLProfile::Core)
+        {
+            glUniform4f(m_blitRectLocation, rect[0], rect[1], rect[2], rect[3]);
+            glUniform2f(m_blitExtentLocation, extent[0], extent[1]);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+        else
+        {
+            const GLfloat x0 = rect[0] * m_width;
+            const GLfloat y0 = rect[1] * m_height;
+            const GLfloat x1 = rect[2] * m_width;
+            const GLfloat y1 = rect[3] * m_height;
+            glBegin(GL_QUADS);
+            glTexCoord2f(0, 0); glVertex2f(x0, y0);
+            glTexCoord2f(0, extent[1]); glVertex2f(x0, y1);
+            glTexCoord2f(extent[0], extent[1]); glVertex2f(x1, y1);
+            glTexCoord2f(extent[0], 0); glVertex2f(x1, y0);
+            glEnd();
+        }
+    };
+
     auto renderToBuffer = [&](GLenum buffer)
     {
+        TRACE_ZONE("Draw");
         glDrawBuffer(buffer);
         glClear(GL_COLOR_BUFFER_BIT);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, m_glTexture);
+        if (useInterop && m_profile == GLProfile::Core)
+        {
+            glUseProgram(m_blitProgram);
+            glUniform1i(glGetUniformLocation(m_blitProgram, "frameLayout"), 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, m_glTexture);
+        }
+        else if (useInterop)
+        {
+            glEnable(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, m_glTexture);
+        }
+        else
+        {
+            BindFrameTextures();
+        }
+
+        if (m_profile == GLProfile::Core)
+        {
+            glBindVertexArray(m_blitVao);
+        }
+        if (tiled)
+        {
+            static const GLfloat wholeTile[2] = { 1.0f, 1.0f };
+            for (size_t i = 0; i < m_tileTextures.size(); ++i)
+            {
+                glBindTexture(GL_TEXTURE_2D, m_tileTextures[i]);
+                drawQuad(&m_tileRects[i * 4], wholeTile);
+            }
+        }
+        else
+        {
+            static const GLfloat window[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+            drawQuad(window, m_sourceExtent);
+        }
+        if (m_profile == GLProfile::Core)
+        {
+            glBindVertexArray(0);
+        }
 
-        glBegin(GL_QUADS);
-        glTexCoord2f(0, 0); glVertex2f(0, 0);
-        glTexCoord2f(0, 1); glVertex2f(0, static_cast<GLfloat>(m_height));
-        glTexCoord2f(1, 1); glVertex2f(static_cast<GLfloat>(m_width), static_cast<GLfloat>(m_height));
-        glTexCoord2f(1, 0); glVertex2f(static_cast<GLfloat>(m_width), 0);
-        glEnd();
+        if (m_hud)
+        {
+            TRACE_ZONE("Hud");
+            m_hud->Draw(m_width, m_height);
+        }
     };
 
     if (m_isStereoContext)
@@ -155,17 +746,82 @@ void OpenGLSharedRenderer::Render()
         renderToBuffer(GL_BACK);
     }
 
-    wglDXUnlockObjectsNV(m_dxDeviceHandle, 1, &m_glSharedHandle);
+    if (m_yuvProgram || m_blitProgram)
+    {
+        glUseProgram(0);
+    }
 
+    if (m_readMarker)
+    {
+        // The marker sits in the top rows of the frame; GL rows count from the bottom.
+        TRACE_ZONE("ReadMarker");
+        glReadBuffer(m_isStereoContext ? GL_BACK_LEFT : GL_BACK);
+        glReadPixels(0, m_height - 1 - kMarkerHeight / 2, kMarkerWidth, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_markerRow);
+        m_lastPresent.markerValid = DecodeFrameMarker(m_markerRow, m_lastPresent.sequence);
+        m_lastPresent.drawnNs = FrameClockNs();
+    }
+
+    if (useInterop)
+    {
+        TRACE_ZONE("wglDXUnlockObjectsNV");
+        m_lockMonitor.Begin(m_lockResource, InteropLockMonitor::Call::Unlock);
+        const BOOL unlocked = wglDXUnlockObjectsNV(m_dxDeviceHandle, interopCount, interopObjects);
+        GLValidation::CheckInterop(unlocked != FALSE, "wglDXUnlockObjectsNV");
+        m_lockMonitor.End(m_lockResource, InteropLockMonitor::Call::Unlock, unlocked != FALSE);
+    }
+    GLValidation::CheckGL("Render");
+
+    m_lastPresent.swapBeginNs = FrameClockNs();
     if (m_hdc)
     {
+        TRACE_ZONE("SwapBuffers");
         SwapBuffers(m_hdc);
     }
+    m_lastPresent.presentedNs = FrameClockNs();
+}
+
+void OpenGLSharedRenderer::EnableHud(bool enabled)
+{
+    if (!enabled)
+    {
+        m_hud.reset();
+        return;
+    }
+
+    if (!m_hud && m_context)
+    {
+        m_hud = std::make_unique<PerfHud>();
+        if (!m_hud->Initialize(m_profile == GLProfile::Core))
+        {
+            m_hud.reset();
+        }
+    }
+}
+
+void OpenGLSharedRenderer::SetHudStats(const HudStats& stats)
+{
+    if (m_hud)
+    {
+        m_hud->Update(stats);
+    }
 }
 
 void OpenGLSharedRenderer::Cleanup()
 {
+    m_hud.reset();
     ReleaseSharedResources();
+    ReleaseFrameTextures();
+
+    if (m_blitProgram != 0)
+    {
+        glDeleteProgram(m_blitProgram);
+        m_blitProgram = 0;
+    }
+    if (m_blitVao != 0)
+    {
+        glDeleteVertexArrays(1, &m_blitVao);
+        m_blitVao = 0;
+    }
 
     if (m_context)
     {
@@ -186,10 +842,48 @@ void OpenGLSharedRenderer::Cleanup()
 void OpenGLSharedRenderer::ConfigureViewport()
 {
     glViewport(0, 0, m_width, m_height);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, m_width, m_height, 0, -1, 1);
     glDisable(GL_DEPTH_TEST);
+    if (m_profile != GLProfile::Core)
+    {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(0, m_width, m_height, 0, -1, 1);
+    }
+}
+
+// Times a fixed mix of cheap state calls of the kind the consumer issues
+// every frame, so contexts can be compared on per-call validation cost.
+double OpenGLSharedRenderer::MeasureCallOverheadNs(int iterations)
+{
+    if (!m_context || iterations <= 0)
+    {
+        return 0.0;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glFinish();
+
+    const int callsPerIteration = 8;
+    const uint64_t start = FrameClockNs();
+    for (int i = 0; i < iterations; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (i & 1) ? GL_LINEAR : GL_NEAREST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_BLEND);
+        glViewport(0, 0, m_width, m_height);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glFinish();
+    const uint64_t elapsedNs = FrameClockNs() - start;
+
+    glDeleteTextures(1, &texture);
+    return static_cast<double>(elapsedNs) / (static_cast<double>(iterations) * callsPerIteration);
 }
 
 void OpenGLSharedRenderer::ReleaseSharedResources()
@@ -204,12 +898,19 @@ void OpenGLSharedRenderer::ReleaseSharedResources()
     {
         if (m_glSharedHandle && m_dxDeviceHandle)
         {
-            wglDXUnregisterObjectNV(m_dxDeviceHandle, m_glSharedHandle);
+            const BOOL unregistered = wglDXUnregisterObjectNV(m_dxDeviceHandle, m_glSharedHandle);
+            GLValidation::CheckInterop(unregistered != FALSE, "wglDXUnregisterObjectNV");
+        }
+        for (HANDLE object : m_tileObjects)
+        {
+            const BOOL unregistered = wglDXUnregisterObjectNV(m_dxDeviceHandle, object);
+            GLValidation::CheckInterop(unregistered != FALSE, "wglDXUnregisterObjectNV");
         }
 
         if (m_dxDeviceHandle)
         {
-            wglDXCloseDeviceNV(m_dxDeviceHandle);
+            const BOOL closed = wglDXCloseDeviceNV(m_dxDeviceHandle);
+            GLValidation::CheckInterop(closed != FALSE, "wglDXCloseDeviceNV");
         }
     }
 
@@ -219,7 +920,98 @@ void OpenGLSharedRenderer::ReleaseSharedResources()
         m_sharedTexture = nullptr;
     }
 
+    if (!m_tileTextures.empty())
+    {
+        glDeleteTextures(static_cast<GLsizei>(m_tileTextures.size()), m_tileTextures.data());
+    }
+    for (ID3D11Texture2D* source : m_tileSources)
+    {
+        source->Release();
+    }
+
     m_glSharedHandle = nullptr;
     m_dxDeviceHandle = nullptr;
     m_sharedHandle = nullptr;
+    m_tileSources.clear();
+    m_tileTextures.clear();
+    m_tileObjects.clear();
+    m_tileRects.clear();
+}
+
+void OpenGLSharedRenderer::ReleaseFrameTextures()
+{
+    if (m_planeTextures[0] != 0)
+    {
+        glDeleteTextures(FramePlaneCount(m_frameFormat), m_planeTextures);
+    }
+
+    if (m_yuvProgram != 0)
+    {
+        glDeleteProgram(m_yuvProgram);
+        m_yuvProgram = 0;
+    }
+
+    if (m_uploadBuffer != 0)
+    {
+        if (m_uploadMapping)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            m_uploadMapping = nullptr;
+        }
+        glDeleteBuffers(1, &m_uploadBuffer);
+        m_uploadBuffer = 0;
+    }
+
+    m_planeTextures[0] = m_planeTextures[1] = m_planeTextures[2] = 0;
+    m_frameWidth = 0;
+    m_frameHeight = 0;
+}
+
+bool OpenGLSharedRenderer::CreateYuvProgram()
+{
+    m_yuvProgram = LinkProgram(s_yuvVS, s_yuvFS);
+    if (!m_yuvProgram)
+    {
+        return false;
+    }
+
+    glUseProgram(m_yuvProgram);
+    glUniform1i(glGetUniformLocation(m_yuvProgram, "texY"), 0);
+    glUniform1i(glGetUniformLocation(m_yuvProgram, "texU"), 1);
+    glUniform1i(glGetUniformLocation(m_yuvProgram, "texV"), 2);
+    glUseProgram(0);
+    return true;
+}
+
+void OpenGLSharedRenderer::BindFrameTextures()
+{
+    if (m_profile == GLProfile::Core)
+    {
+        const int layout = !IsYuvFormat(m_frameFormat) ? 0 : (m_frameFormat == FrameFormat::Nv12 ? 1 : 2);
+        glUseProgram(m_blitProgram);
+        glUniform1i(glGetUniformLocation(m_blitProgram, "frameLayout"), layout);
+        for (int plane = FramePlaneCount(m_frameFormat) - 1; plane >= 0; --plane)
+        {
+            glActiveTexture(GL_TEXTURE0 + plane);
+            glBindTexture(GL_TEXTURE_2D, m_planeTextures[plane]);
+        }
+        return;
+    }
+
+    if (!IsYuvFormat(m_frameFormat))
+    {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, m_planeTextures[0]);
+        return;
+    }
+
+    glUseProgram(m_yuvProgram);
+    glUniform1i(glGetUniformLocation(m_yuvProgram, "interleavedChroma"), m_frameFormat == FrameFormat::Nv12 ? 1 : 0);
+    for (int plane = FramePlaneCount(m_frameFormat) - 1; plane >= 0; --plane)
+    {
+        glActiveTexture(GL_TEXTURE0 + plane);
+        glBindTexture(GL_TEXTURE_2D, m_planeTextures[plane]);
+    }
 }
@@ -3,6 +3,34 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include "glew.h"
+#include "VideoFrame.h"
+#include "FrameLatency.h"
+#include "PerfHud.h"
+#include "InteropLockMonitor.h"
+#include "GLContextOptions.h"
+#include <memory>
+#include <vector>
+
+// One texture of a tiled shared surface and where it sits on the canvas.
+struct SharedTile
+{
+    ID3D11Texture2D* texture;
+    HANDLE sharedHandle;
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct PresentTiming
+{
+    bool markerValid;
+    uint32_t sequence;
+    uint64_t renderBeginNs;
+    uint64_t drawnNs;
+    uint64_t swapBeginNs;
+    uint64_t presentedNs;
+};
 
 class OpenGLSharedRenderer
 {
@@ -10,14 +38,76 @@ public:
     OpenGLSharedRenderer(int width, int height);
     ~OpenGLSharedRenderer();
 
-    bool Initialize(HWND hwnd);
+    // Legacy contexts come from wglCreateContext; the other profiles are
+    // requested through WGL_ARB_create_context, and Initialize fails if the
+    // driver cannot provide them. A core context draws with shaders only.
+    bool Initialize(HWND hwnd, const GLContextOptions& options = GLContextOptions());
+    // Initialize leaves the context current on the calling thread. Startup
+    // may initialize on a worker, release the context there and make it
+    // current on the render thread; a context is current on one thread only.
+    bool MakeCurrent();
+    void ReleaseCurrent();
     bool SetupSharedTexture(ID3D11Device* device, ID3D11Texture2D* sharedTexture, HANDLE sharedHandle);
+    // Canvas larger than one texture: every tile is registered with the same
+    // interop device, all are locked with one wglDXLockObjectsNV call per
+    // frame and each is drawn as its own quad of the canvas.
+    bool SetupSharedTiles(ID3D11Device* device, const std::vector<SharedTile>& tiles, int canvasWidth, int canvasHeight);
+    int SharedTileCount() const { return static_cast<int>(m_tileObjects.size()); }
+    // GL_MAX_TEXTURE_SIZE of the current context.
+    int MaxTextureSize() const;
+    // Reads level 0 of the shared texture through the interop lock as RGBA8
+    // (width * height * 4 bytes); used to verify that sharing really works.
+    bool ReadSharedTexture(uint8_t* rgba, int width, int height);
+    // |srgb| selects GL_SRGB8_ALPHA8 storage for the 8-bit packed formats.
+    bool SetupFrameTextures(FrameFormat format, int width, int height, bool srgb = false);
+    bool UploadFrame(const VideoFrame& frame);
+    bool BeginFrameUpload(VideoFrame& frame);
+    void EndFrameUpload();
     void Render();
+
+    // Fraction of the frame's width and height, from its top-left corner,
+    // that holds the picture; Render() stretches that part over the window.
+    // Dynamic resolution renders into a smaller corner of the same texture
+    // and sets this with every frame.
+    void SetSourceExtent(float width, float height)
+    {
+        m_sourceExtent[0] = width;
+        m_sourceExtent[1] = height;
+    }
+
+    // Reads the producer's frame marker back after drawing (a GPU sync point,
+    // so only enable it while measuring latency).
+    void EnableMarkerReadback(bool enabled) { m_readMarker = enabled; }
+    const PresentTiming& LastPresent() const { return m_lastPresent; }
+
+    // Overlay drawn on top of each eye; stats show up on the next Render().
+    void EnableHud(bool enabled);
+    bool HudEnabled() const { return m_hud != nullptr; }
+    void SetHudStats(const HudStats& stats);
+
+    // Lock/unlock timing for the interop path.
+    InteropLockMonitor& LockMonitor() { return m_lockMonitor; }
+    double LastLockMs() const { return m_lockMonitor.LastLockMs(m_lockResource); }
+
+    GLProfile Profile() const { return m_profile; }
+    bool NoErrorContext() const { return m_noErrorContext; }
+    // Time LoadGLEntryPoints took during Initialize.
+    uint64_t EntryPointLoadNs() const { return m_entryPointLoadNs; }
+
+    // Average CPU cost of one GL state call on this context, in ns.
+    double MeasureCallOverheadNs(int iterations);
     void Cleanup();
 
 private:
+    bool CreateContextWithAttribs(const GLContextOptions& options);
+    bool CreateBlitProgram();
     void ConfigureViewport();
+    bool OpenInteropDevice(ID3D11Device* device);
     void ReleaseSharedResources();
+    void ReleaseFrameTextures();
+    bool CreateYuvProgram();
+    void BindFrameTextures();
+    void UploadPlanes(const VideoFrame& frame, const uint8_t* origin);
 
     int m_width;
     int m_height;
@@ -30,4 +120,37 @@ private:
     ID3D11Texture2D* m_sharedTexture;
     HANDLE m_sharedHandle;
     bool m_isStereoContext;
+    bool m_srgb;    // texture holds sRGB-encoded values (either path)
+    GLProfile m_profile;
+    bool m_noErrorContext;
+    uint64_t m_entryPointLoadNs;
+    GLuint m_blitProgram;   // core profile only, replaces the fixed-function quad
+    GLuint m_blitVao;
+    GLint m_blitRectLocation;
+    GLint m_blitExtentLocation;
+    GLfloat m_sourceExtent[2];
+
+    // Tiled shared surface; rects are x0, y0, x1, y1 as fractions of the canvas.
+    std::vector<ID3D11Texture2D*> m_tileSources;
+    std::vector<GLuint> m_tileTextures;
+    std::vector<HANDLE> m_tileObjects;
+    std::vector<GLfloat> m_tileRects;
+
+    // CPU transfer path: one texture per plane, YUV converted in a shader.
+    FrameFormat m_frameFormat;
+    int m_frameWidth;
+    int m_frameHeight;
+    GLuint m_planeTextures[3];
+    GLuint m_yuvProgram;
+    GLuint m_uploadBuffer;
+    uint8_t* m_uploadMapping;
+
+    bool m_readMarker;
+    PresentTiming m_lastPresent;
+    uint8_t m_markerRow[kMarkerWidth * 4];
+
+    std::unique_ptr<PerfHud> m_hud;
+
+    InteropLockMonitor m_lockMonitor;
+    int m_lockResource;
 };
@@ -0,0 +1,515 @@
+#include "PerfHud.h"
+
+#include "GLProgram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace
+{
+    const int kGlyphWidth = 5;
+    const int kGlyphHeight = 7;
+    const int kCellWidth = 6;
+    const int kCellHeight = 8;
+    const int kAtlasColumns = 16;
+    const int kAtlasRows = 5;
+    const int kAtlasWidth = kAtlasColumns * kCellWidth;
+    const int kAtlasHeight = kAtlasRows * kCellHeight;
+    const int kFirstChar = 32;
+    const int kGlyphCount = 64;
+    const int kSolidGlyph = kGlyphCount;
+    const float kScale = 2.0f;
+
+    // ASCII 32..95, one byte per row, bit 4 is the leftmost column. Lower-case
+    // text is drawn with the upper-case glyphs; missing symbols show '?'.
+    const uint8_t kFont[kGlyphCount][kGlyphHeight] =
+    {
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+        { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // '!'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '"'
+        { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // '#'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '$'
+        { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '&'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // "'"
+        { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+        { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '*'
+        { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // '+'
+        { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ','
+        { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // '-'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // '.'
+        { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+        { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // '0'
+        { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // '1'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // '2'
+        { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // '3'
+        { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // '4'
+        { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // '5'
+        { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // '6'
+        { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+        { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // '8'
+        { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // '9'
+        { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ';'
+        { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+        { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // '='
+        { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '@'
+        { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'A'
+        { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // 'B'
+        { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // 'C'
+        { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // 'D'
+        { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // 'E'
+        { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // 'F'
+        { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // 'G'
+        { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'H'
+        { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 'I'
+        { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // 'J'
+        { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+        { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // 'L'
+        { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+        { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+        { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'O'
+        { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // 'P'
+        { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // 'Q'
+        { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // 'R'
+        { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // 'S'
+        { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+        { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'U'
+        { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // 'V'
+        { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // 'W'
+        { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // 'X'
+        { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // 'Y'
+        { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // 'Z'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '['
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '\\'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // ']'
+        { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '^'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // '_'
+    };
+
+    const GLubyte kWhite[4] = { 255, 255, 255, 255 };
+    const GLubyte kGrey[4] = { 170, 170, 170, 255 };
+    const GLubyte kPanel[4] = { 0, 0, 0, 160 };
+    const GLubyte kGood[4] = { 80, 220, 80, 255 };
+    const GLubyte kLate[4] = { 240, 70, 50, 255 };
+    const GLubyte kBudget[4] = { 255, 255, 255, 96 };
+
+    const float kBudgetMs = 1000.0f / 60.0f;
+
+    const char* kCoreVS =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 position;"
+    "layout(location = 1) in vec2 texCoord;"
+    "layout(location = 2) in vec4 color;"
+    "uniform vec2 viewport;"
+    "uniform float offsetY;"
+    "out vec2 uv;"
+    "out vec4 tint;"
+    "void main() {"
+    "  uv = texCoord;"
+    "  tint = color;"
+    "  vec2 pixel = vec2(position.x, position.y + offsetY);"
+    "  gl_Position = vec4(pixel.x / viewport.x * 2.0 - 1.0, 1.0 - pixel.y / viewport.y * 2.0, 0.0, 1.0);"
+    "}";
+
+    const char* kCoreFS =
+    "#version 330 core\n"
+    "uniform sampler2D atlas;"
+    "in vec2 uv;"
+    "in vec4 tint;"
+    "out vec4 fragColor;"
+    "void main() {"
+    "  fragColor = texture(atlas, uv) * tint;"
+    "}";
+}
+
+PerfHud::PerfHud()
+    : m_atlas(0)
+    , m_core(false)
+    , m_program(0)
+    , m_vao(0)
+    , m_vertexBuffer(0)
+    , m_indexBuffer(0)
+    , m_indexedQuads(0)
+    , m_timerQueries{ 0, 0 }
+    , m_timerPending{ false, false }
+    , m_timerIndex(0)
+    , m_frameTimes{}
+    , m_graphHead(0)
+    , m_panelBottom(0.0f)
+    , m_cpuCostMs(0.0)
+    , m_lastCpuCostMs(0.0)
+    , m_gpuCostMs(0.0)
+    , m_firstDrawThisFrame(false)
+{
+}
+
+PerfHud::~PerfHud()
+{
+    Release();
+}
+
+bool PerfHud::Initialize(bool coreProfile)
+{
+    // Expand the font into an RGBA atlas: white texels, coverage in alpha.
+    std::vector<GLubyte> pixels(kAtlasWidth * kAtlasHeight * 4, 0);
+    auto setTexel = [&](int x, int y)
+    {
+        GLubyte* texel = &pixels[(y * kAtlasWidth + x) * 4];
+        texel[0] = texel[1] = texel[2] = texel[3] = 255;
+    };
+
+    for (int glyph = 0; glyph < kGlyphCount; ++glyph)
+    {
+        const int originX = (glyph % kAtlasColumns) * kCellWidth;
+        const int originY = (glyph / kAtlasColumns) * kCellHeight;
+        for (int row = 0; row < kGlyphHeight; ++row)
+        {
+            for (int column = 0; column < kGlyphWidth; ++column)
+            {
+                if (kFont[glyph][row] & (0x10 >> column))
+                {
+                    setTexel(originX + column, originY + row);
+                }
+            }
+        }
+    }
+
+    const int solidX = (kSolidGlyph % kAtlasColumns) * kCellWidth;
+    const int solidY = (kSolidGlyph / kAtlasColumns) * kCellHeight;
+    for (int y = 0; y < kCellHeight; ++y)
+    {
+        for (int x = 0; x < kCellWidth; ++x)
+        {
+            setTexel(solidX + x, solidY + y);
+        }
+    }
+
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, kAtlasWidth, kAtlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (GLEW_ARB_timer_query)
+    {
+        glGenQueries(2, m_timerQueries);
+    }
+
+    m_vertices.reserve(4096);
+    m_core = coreProfile;
+    if (m_core && !CreateCoreResources())
+    {
+        return false;
+    }
+    return m_atlas != 0;
+}
+
+// Core profiles have no client arrays or GL_QUADS: vertices are streamed into
+// a VBO and each quad is drawn as two indexed triangles.
+bool PerfHud::CreateCoreResources()
+{
+    m_program = LinkProgram(kCoreVS, kCoreFS);
+    if (!m_program)
+    {
+        return false;
+    }
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "atlas"), 0);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, x)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, u)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, color)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return m_vao != 0 && m_vertexBuffer != 0 && m_indexBuffer != 0;
+}
+
+void PerfHud::Release()
+{
+    if (m_program != 0)
+    {
+        glDeleteProgram(m_program);
+        m_program = 0;
+    }
+    if (m_vao != 0)
+    {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+    if (m_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_vertexBuffer);
+        glDeleteBuffers(1, &m_indexBuffer);
+        m_vertexBuffer = m_indexBuffer = 0;
+        m_indexedQuads = 0;
+    }
+
+    if (m_atlas != 0)
+    {
+        glDeleteTextures(1, &m_atlas);
+        m_atlas = 0;
+    }
+
+    if (m_timerQueries[0] != 0)
+    {
+        glDeleteQueries(2, m_timerQueries);
+        m_timerQueries[0] = m_timerQueries[1] = 0;
+    }
+}
+
+void PerfHud::AddQuad(float x0, float y0, float x1, float y1, int glyph, const GLubyte color[4])
+{
+    float u0 = static_cast<float>((glyph % kAtlasColumns) * kCellWidth) / kAtlasWidth;
+    float v0 = static_cast<float>((glyph / kAtlasColumns) * kCellHeight) / kAtlasHeight;
+    float u1 = u0 + static_cast<float>(glyph == kSolidGlyph ? kCellWidth : kGlyphWidth) / kAtlasWidth;
+    float v1 = v0 + static_cast<float>(glyph == kSolidGlyph ? kCellHeight : kGlyphHeight) / kAtlasHeight;
+    if (glyph == kSolidGlyph)
+    {
+        // Sample the middle of the solid cell so filtering never reaches a border.
+        u0 = u1 = (u0 + u1) * 0.5f;
+        v0 = v1 = (v0 + v1) * 0.5f;
+    }
+
+    const Vertex quad[4] =
+    {
+        { x0, y0, u0, v0, { color[0], color[1], color[2], color[3] } },
+        { x0, y1, u0, v1, { color[0], color[1], color[2], color[3] } },
+        { x1, y1, u1, v1, { color[0], color[1], color[2], color[3] } },
+        { x1, y0, u1, v0, { color[0], color[1], color[2], color[3] } },
+    };
+    m_vertices.insert(m_vertices.end(), quad, quad + 4);
+}
+
+void PerfHud::AddText(float x, float y, const char* text, const GLubyte color[4])
+{
+    for (; *text; ++text, x += kCellWidth * kScale)
+    {
+        int c = static_cast<unsigned char>(*text);
+        if (c >= 'a' && c <= 'z')
+        {
+            c -= 'a' - 'A';
+        }
+        if (c == ' ')
+        {
+            continue;
+        }
+
+        const int glyph = (c >= kFirstChar && c < kFirstChar + kGlyphCount) ? c - kFirstChar : '?' - kFirstChar;
+        AddQuad(x, y, x + kGlyphWidth * kScale, y + kGlyphHeight * kScale, glyph, color);
+    }
+}
+
+void PerfHud::Update(const HudStats& stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_lastCpuCostMs = m_cpuCostMs;
+    m_frameTimes[m_graphHead] = stats.frameMs;
+    m_graphHead = (m_graphHead + 1) % kGraphFrames;
+    m_vertices.clear();
+
+    // Laid out from the panel's top-left corner; Draw() anchors it to the
+    // bottom of the window so the latency marker rows stay readable.
+    const float left = 8.0f;
+    const float top = 8.0f;
+    const float lineHeight = kCellHeight * kScale + 2.0f;
+    const float graphHeight = 64.0f;
+    const int lineCount = 6 + (stats.jobThreads > 0 ? 1 : 0) + (stats.renderWidth > 0 ? 1 : 0);
+    const float panelWidth = 44 * kCellWidth * kScale;
+    const float panelHeight = lineCount * lineHeight + graphHeight + 16.0f;
+    AddQuad(left - 4.0f, top - 4.0f, left + panelWidth, top + panelHeight, kSolidGlyph, kPanel);
+    m_panelBottom = top + panelHeight + 4.0f;
+
+    char line[96];
+    float y = top;
+    std::snprintf(line, sizeof(line), "%.1f FPS  %.2f MS  DROPPED %llu", stats.fps, stats.frameMs,
+        static_cast<unsigned long long>(stats.droppedFrames));
+    AddText(left, y, line, kWhite);
+    y += lineHeight;
+
+    std::snprintf(line, sizeof(line), "PRODUCER %.2f  TRANSFER %.2f", stats.producerMs, stats.transferMs);
+    AddText(left, y, line, kGrey);
+    y += lineHeight;
+
+    std::snprintf(line, sizeof(line), "CONSUMER %.2f  PRESENT  %.2f", stats.consumerMs, stats.presentMs);
+    AddText(left, y, line, kGrey);
+    y += lineHeight;
+
+    std::snprintf(line, sizeof(line), "%s %s  %.2f MB/FRAME  LOCK %.2f", stats.transferMode, stats.frameFormat,
+        stats.bytesPerFrame / 1048576.0, stats.lockMs);
+    AddText(left, y, line, kGrey);
+    y += lineHeight;
+
+    if (stats.jobThreads > 0)
+    {
+        std::snprintf(line, sizeof(line), "JOBS %d THREADS  %.0f%% BUSY  STEALS %llu", stats.jobThreads,
+            stats.jobUtilization * 100.0f, static_cast<unsigned long long>(stats.jobSteals));
+        AddText(left, y, line, kGrey);
+        y += lineHeight;
+    }
+
+    if (stats.renderWidth > 0)
+    {
+        std::snprintf(line, sizeof(line), "RES %dX%d  %.0f%%", stats.renderWidth, stats.renderHeight,
+            stats.renderScale * 100.0f);
+        AddText(left, y, line, kGrey);
+        y += lineHeight;
+    }
+
+    std::snprintf(line, sizeof(line), "HUD CPU %.3f MS  GPU %.3f MS", m_lastCpuCostMs, m_gpuCostMs);
+    AddText(left, y, line, kGrey);
+    y += lineHeight + 8.0f;
+
+    // Frame-time graph, oldest on the left; full height is two 60 Hz budgets.
+    const float barWidth = panelWidth / kGraphFrames;
+    const float bottom = y + graphHeight;
+    for (int i = 0; i < kGraphFrames; ++i)
+    {
+        const float ms = m_frameTimes[(m_graphHead + i) % kGraphFrames];
+        const float height = (ms < 2.0f * kBudgetMs ? ms / (2.0f * kBudgetMs) : 1.0f) * graphHeight;
+        const float x = left + i * barWidth;
+        AddQuad(x, bottom - height, x + barWidth, bottom, kSolidGlyph, ms > kBudgetMs ? kLate : kGood);
+    }
+    AddQuad(left, bottom - graphHeight * 0.5f, left + panelWidth - 4.0f, bottom - graphHeight * 0.5f + 1.0f,
+        kSolidGlyph, kBudget);
+
+    m_cpuCostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_firstDrawThisFrame = true;
+}
+
+void PerfHud::Draw(int viewportWidth, int viewportHeight)
+{
+    if (m_atlas == 0 || m_vertices.empty())
+    {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Only the first draw buffer of a frame is timed on the GPU. Two queries
+    // alternate and a result is only read once it is available, so the
+    // readback never waits on the GPU; while the next query is still in
+    // flight this frame goes untimed and the last cost stays on screen.
+    bool timed = m_firstDrawThisFrame && m_timerQueries[0] != 0;
+    if (timed && m_timerPending[m_timerIndex])
+    {
+        const GLuint query = m_timerQueries[m_timerIndex];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            m_gpuCostMs = elapsed / 1e6;
+            m_timerPending[m_timerIndex] = false;
+        }
+        else
+        {
+            timed = false;
+        }
+    }
+    if (timed)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_timerIndex]);
+    }
+
+    if (m_core)
+    {
+        DrawCore(viewportWidth, viewportHeight);
+    }
+    else
+    {
+        glUseProgram(0);
+        glActiveTexture(GL_TEXTURE0);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, m_atlas);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glTranslatef(0.0f, viewportHeight - m_panelBottom, 0.0f);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertices[0].x);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertices[0].u);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), m_vertices[0].color);
+        glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(m_vertices.size()));
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glPopMatrix();
+
+        glDisable(GL_BLEND);
+        glColor4ub(255, 255, 255, 255);
+    }
+
+    if (timed)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_timerPending[m_timerIndex] = true;
+        m_timerIndex ^= 1;
+    }
+    m_firstDrawThisFrame = false;
+
+    m_cpuCostMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PerfHud::DrawCore(int viewportWidth, int viewportHeight)
+{
+    const size_t quads = m_vertices.size() / 4;
+    glBindVertexArray(m_vao);
+    if (quads > m_indexedQuads)
+    {
+        // Grows with the batch; the element buffer binding lives in the VAO.
+        std::vector<GLuint> indices(quads * 6);
+        for (size_t quad = 0; quad < quads; ++quad)
+        {
+            const GLuint first = static_cast<GLuint>(quad * 4);
+            const GLuint pattern[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+            std::copy(pattern, pattern + 6, indices.begin() + quad * 6);
+        }
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        m_indexedQuads = quads;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(m_program);
+    glUniform2f(glGetUniformLocation(m_program, "viewport"),
+        static_cast<GLfloat>(viewportWidth), static_cast<GLfloat>(viewportHeight));
+    glUniform1f(glGetUniformLocation(m_program, "offsetY"), viewportHeight - m_panelBottom);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quads * 6), GL_UNSIGNED_INT, nullptr);
+
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
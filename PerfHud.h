@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <vector>
+#include "glew.h"
+
+struct HudStats
+{
+    float fps;
+    float producerMs;
+    float transferMs;
+    float consumerMs;
+    float presentMs;
+    float frameMs;
+    const char* transferMode;
+    const char* frameFormat;
+    uint64_t bytesPerFrame;
+    uint64_t droppedFrames;
+    float lockMs;
+    int jobThreads;         // 0: no CPU stages
+    float jobUtilization;   // 0..1
+    uint64_t jobSteals;
+    int renderWidth;        // 0: no dynamic resolution
+    int renderHeight;
+    float renderScale;      // 0..1, per axis
+};
+
+// Text and frame-time graph overlay for the GL consumer. Glyphs come from a
+// 5x7 font baked into one small atlas texture at startup; the panel, graph
+// bars and text are all textured quads from that atlas (the panel and bars
+// sample a solid texel), so the whole overlay is a single draw call: client
+// arrays on legacy contexts, a streamed VBO and a small shader on core ones.
+// The HUD times its own CPU work and, with ARB_timer_query, its GPU work, and
+// prints both on the next frame.
+class PerfHud
+{
+public:
+    PerfHud();
+    ~PerfHud();
+
+    bool Initialize(bool coreProfile = false);
+    void Release();
+
+    // Rebuilds the vertex batch; call once per frame before Draw().
+    void Update(const HudStats& stats);
+
+    // Draws the batch over the current draw buffer, anchored to the bottom
+    // left. Legacy contexts expect the renderer's pixel-space projection
+    // (y down); core contexts map pixels to clip space in the shader.
+    void Draw(int viewportWidth, int viewportHeight);
+
+private:
+    struct Vertex
+    {
+        GLfloat x, y;
+        GLfloat u, v;
+        GLubyte color[4];
+    };
+
+    void AddQuad(float x0, float y0, float x1, float y1, int glyph, const GLubyte color[4]);
+    void AddText(float x, float y, const char* text, const GLubyte color[4]);
+    bool CreateCoreResources();
+    void DrawCore(int viewportWidth, int viewportHeight);
+
+    static const int kGraphFrames = 120;
+
+    GLuint m_atlas;
+    bool m_core;
+    GLuint m_program;
+    GLuint m_vao;
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    size_t m_indexedQuads;
+    GLuint m_timerQueries[2];
+    bool m_timerPending[2];
+    int m_timerIndex;
+    std::vector<Vertex> m_vertices;
+    float m_frameTimes[kGraphFrames];
+    int m_graphHead;
+    float m_panelBottom;
+    double m_cpuCostMs;
+    double m_lastCpuCostMs;
+    double m_gpuCostMs;
+    bool m_firstDrawThisFrame;
+};
@@ -1,12 +1,35 @@
 #include <Windows.h>
 #include <d3d11.h>
+#include <d3d11_4.h>
 #include <dxgi1_2.h>
 #include <DirectXMath.h>
 #include <assert.h>
 #include <memory>
 #include <stdexcept>
 #include "OpenGLSharedRenderer.h"
+#include "AppConfig.h"
+#include "YuvConvert.h"
+#include "FrameCopy.h"
+#include "FrameTrace.h"
+#include "FrameLatency.h"
+#include "FrameHistogram.h"
+#include "BenchmarkMatrix.h"
+#include "SoftRasterizer.h"
+#include "FrameAllocator.h"
+#include "SrgbConvert.h"
+#include "GLLoader.h"
+#include "GLValidation.h"
+#include "StartupTimeline.h"
+#include "TransferProbe.h"
+#include "TiledSurface.h"
+#include "ThreadPlacement.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "FrameWaiter.h"
+#include "DynamicResolution.h"
+#include "FrameQueue.h"
 #include <chrono>
+#include <future>
 #include <d3dcompiler.h>
 #include <winrt/base.h>
 
@@ -17,9 +40,8 @@ using namespace DirectX;
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib,"d3dcompiler.lib")
 
-#define SCREEN_WIDTH  1024
-#define SCREEN_HEIGHT 1024
-#define KEYDOWN(vk) (GetAsyncKeyState(vk) & 0x8000)
+#define SCREEN_WIDTH  kDefaultCanvasSize
+#define SCREEN_HEIGHT kDefaultCanvasSize
 
 HWND g_hWndDX = nullptr;
 HWND g_hWndGL = nullptr;
@@ -34,11 +56,112 @@ HANDLE g_hSharedHandle = nullptr;
 
 std::unique_ptr<OpenGLSharedRenderer> g_OpenGLRenderer;
 
+AppConfig g_Config;
+// CPU path readback: one staging texture per frame slot (several only with
+// -frames-in-flight), each with an event query that signals when the copy
+// into it has finished, so Map() no longer waits for the GPU.
+std::vector<com_ptr<ID3D11Texture2D>> g_StagingTextures;
+std::vector<com_ptr<ID3D11Query>> g_ReadbackFences;
+
+// On D3D11.4 devices the readbacks signal one ID3D11Fence instead, whose
+// SetEventOnCompletion lets the render loop sleep until a copy has landed.
+com_ptr<ID3D11DeviceContext4> g_pContext4;
+com_ptr<ID3D11Fence> g_ReadbackFence;
+HANDLE g_ReadbackEvent = nullptr;
+uint64_t g_ReadbackFenceValue = 0;
+std::vector<uint64_t> g_SlotFenceValues;   // per slot, value of its last readback
+
+// Sleeps between frames; see FrameWaiter.h.
+FrameWaiter g_Waiter;
+
+// -dynamic-res: the producer renders into the top-left corner of the canvas
+// at the size the controller picks, and each frame carries that size to the
+// consumer. The D3D11 producer is timed on the GPU with timestamp queries
+// that are read back a few frames later; the software producer by CPU time.
+struct RenderSize
+{
+    int width;
+    int height;
+};
+
+struct ProducerTimer
+{
+    com_ptr<ID3D11Query> disjoint;
+    com_ptr<ID3D11Query> begin;
+    com_ptr<ID3D11Query> end;
+    bool pending;
+};
+
+std::unique_ptr<DynamicResolution> g_Resolution;
+ProducerTimer g_ProducerTimers[4];
+int g_ProducerTimerNext = 0;
+int g_ProducerTimerOldest = 0;
+RenderSize g_SoftFrameSize{};   // what the software frame was last cleared for
+std::unique_ptr<JobSystem> g_Jobs;     // runs every CPU stage
+std::unique_ptr<FrameCopyEngine> g_CopyEngine;
+
+std::unique_ptr<LatencyTracker> g_Latency;
+uint32_t g_FrameSequence = 0;
+uint8_t g_MarkerPixels[kMarkerWidth * kMarkerHeight * 4];
+uint16_t g_MarkerHalfs[kMarkerWidth * kMarkerHeight * 4];   // g_MarkerPixels for rgba16f
+
+FrameStats g_FrameStats;
+uint64_t g_DroppedFrames = 0;
+FILE* g_LockLog = nullptr;
+double g_SmoothedFrameMs = 0.0;
+StartupTimeline g_Startup;
+
+// -frames-in-flight above 1: frames run as coroutines on one executor. Only
+// the staging readback has a resource per frame; every other path has one
+// slot, so its frames still follow one another.
+struct FramePipelineState
+{
+    explicit FramePipelineState(int depth)
+        : depth(depth)
+        , slots(static_cast<int>(g_StagingTextures.size()) >= depth ? depth : 1)
+        , queue(g_Config.queuePolicy, static_cast<uint64_t>(g_Config.queueMaxAgeMs) * 1000000)
+    {
+    }
+
+    int depth;
+    PipelineExecutor executor;
+    FrameSlots slots;
+    FrameSequence produceOrder;
+    FrameSequence presentOrder;
+    FrameQueue queue;
+    uint64_t spawned = 0;
+    bool producerStalled = false;   // every frame in flight is past producing
+};
+std::unique_ptr<FramePipelineState> g_Pipeline;
+
 struct SimpleVertex
 {
     XMFLOAT3 Pos;
     XMFLOAT4 Color;
 };
+static_assert(sizeof(SimpleVertex) == sizeof(SoftVertex), "software producer reads SimpleVertex directly");
+
+const SimpleVertex g_TriangleVertices[] =
+{
+    { XMFLOAT3(0.0f,  0.5f, 0.5f), XMFLOAT4(1,0,0,1)},
+    { XMFLOAT3(0.5f, -0.5f, 0.5f), XMFLOAT4(0,1,0,1)},
+    { XMFLOAT3(-0.5f,-0.5f, 0.5f), XMFLOAT4(0,0,1,1)},
+};
+
+// Software producer: renders the same scene on the CPU into g_SoftFrame.
+std::unique_ptr<SoftRasterizer> g_SoftRaster;
+FrameBuffer g_SoftFrame;
+std::vector<SoftMatrix> g_InstanceMatrices;
+
+// Consumer size (-target-size). When it is smaller than the source the shared
+// texture carries a mip chain; the CPU path reads back the nearest level and
+// resamples it to the exact size.
+int g_TargetWidth = SCREEN_WIDTH;
+int g_TargetHeight = SCREEN_HEIGHT;
+int g_ReadbackLevel = 0;
+com_ptr<ID3D11ShaderResourceView> g_pSharedSRV;
+std::unique_ptr<FrameScaler> g_Scaler;
+FrameBuffer g_ScaledFrame;
 
 com_ptr<ID3D11Buffer> g_pVertexBuffer;
 com_ptr<ID3D11VertexShader> g_pVertexShader;
@@ -47,6 +170,37 @@ com_ptr<ID3D11InputLayout> g_pVertexLayout;
 com_ptr<ID3D11RenderTargetView> g_pSharedRTV;
 com_ptr<ID3D11Buffer> g_pConstantBuffer;
 
+// Source canvas (-canvas, SCREEN_WIDTH x SCREEN_HEIGHT by default). When it is
+// larger than one texture the interop path shares a grid of tiles instead of
+// g_pSharedTex, and re-renders a tile only when an instance moved over it.
+int g_CanvasWidth = SCREEN_WIDTH;
+int g_CanvasHeight = SCREEN_HEIGHT;
+
+struct ProducerTile
+{
+    com_ptr<ID3D11Texture2D> texture;
+    com_ptr<ID3D11RenderTargetView> rtv;
+    com_ptr<ID3D11ShaderResourceView> srv;  // for GenerateMips when downscaled
+    HANDLE sharedHandle;
+};
+std::vector<ProducerTile> g_ProducerTiles;
+std::unique_ptr<TiledSurface> g_Tiles;
+
+// One frame's tile updates on the GPU: a timestamp pair around each dirty
+// tile inside one disjoint query, read back a few frames later without
+// flushing. Timestamp queries are created as frames need more of them.
+struct TileTimer
+{
+    com_ptr<ID3D11Query> disjoint;
+    std::vector<com_ptr<ID3D11Query>> timestamps;   // begin, end per timed tile
+    std::vector<int> tiles;
+    bool pending;
+};
+TileTimer g_TileTimers[4];
+int g_TileTimerNext = 0;
+int g_TileTimerOldest = 0;
+std::vector<CanvasRect> g_InstanceBounds;  // per instance, last frame
+
 // ===== D3D11 shader (HLSL embedded) =====
 const char* g_VS =
 "cbuffer MatrixBuffer : register(b0) { matrix mWorldViewProj; };"
@@ -64,58 +218,486 @@ const char* g_PS =
 "float4 main(PS_INPUT input) : SV_Target { return input.Col; }";
 // ========================================
 
-void InitDX(HWND hWnd);
-void InitGL(HWND hWnd);
-void RenderDX();
-void RenderGL();
+// Producer shader bytecode, compiled on startup tasks while the device is
+// being created.
+struct ProducerShaders
+{
+    std::future<com_ptr<ID3DBlob>> vs;
+    std::future<com_ptr<ID3DBlob>> ps;
+};
+
+int RunMatrixBenchmark();
+int RunContextBenchmark(HINSTANCE hInstance);
+void ResolveAutoTransfer(HINSTANCE hInstance);
+std::launch StartupLaunchPolicy();
+com_ptr<ID3DBlob> CompileProducerShader(const char* source, const char* target, const char* phase);
+void InitDX(HWND hWnd, ProducerShaders& shaders);
+void CreateSharedSurface(int tileLimit);
+int LargestSharedDimension();
+std::unique_ptr<OpenGLSharedRenderer> InitGL(HWND hWnd);
+void AttachGL(std::future<std::unique_ptr<OpenGLSharedRenderer>>& glTask);
+void DumpStartupTimeline();
+RenderSize CurrentRenderSize();
+void CreateProducerTimers();
+void BeginProducerTimer();
+void EndProducerTimer();
+void UpdateResolution(uint64_t producerCpuNs);
+void RenderDX(const RenderSize& size);
+void DrawInstance(const SoftMatrix& instance);
+void RenderTiles(const float clearColor[4]);
+TileTimer* BeginTileTimer();
+void TimeTile(TileTimer* timer, int tile, bool end);
+void EndTileTimer(TileTimer* timer);
+void ReadTileTimers();
+void RenderSoftware(const RenderSize& size);
+void ReadbackFrame(int slot, const RenderSize& size);
+bool ReadbackComplete(int slot);
+HANDLE ArmReadbackEvent();
+void TransferFrame(int slot);
+void RenderGL(const RenderSize& size);
+void RunSerialFrame();
+FrameTask PipelinedFrame(FramePipelineState& pipeline, uint64_t frame);
+bool FrameWanted();
+void UpdateProducerStall(FramePipelineState& pipeline);
+int RunPipelinedFrames(bool paced);
+void RunRenderLoop();
+int RunPipelineBenchmark();
+void DumpTrace();
+void CompleteFrame(uint64_t frameBeginNs, uint64_t producedNs, uint64_t transferBeginNs, uint64_t transferredNs);
+void RecordFrameStats(uint64_t frameBeginNs, uint64_t producedNs, uint64_t transferBeginNs, uint64_t transferredNs);
+void DumpFrameStats();
 void Destroy();
 LRESULT CALLBACK WindowProc(HWND, UINT, WPARAM, LPARAM);
 
 // -----------------------------------------
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
+    g_Startup.Start();
+    if (!ParseCommandLine(lpCmdLine, g_Config))
+    {
+        MessageBoxA(nullptr, CommandLineUsage(), "SharedResource", MB_OK | MB_ICONERROR);
+        return 1;
+    }
+
+    // Place the render thread before anything allocates frame buffers, so
+    // "-numa local" resolves to the node it runs on.
+    const ThreadPlacement& renderPlacement = g_Config.threads[static_cast<int>(ThreadRole::Render)];
+    if (!renderPlacement.cpus.empty() || renderPlacement.priority != ThreadPriority::Normal)
+    {
+        ApplyThreadPlacement(renderPlacement);
+    }
+    if (g_Config.numaNode == kNumaNodeLocal)
+    {
+        GetFrameAllocator().SetNumaNode(renderPlacement.cpus.empty() ? CurrentNumaNode()
+                                                                     : NumaNodeOfCpu(renderPlacement.cpus.front()));
+    }
+    else
+    {
+        GetFrameAllocator().SetNumaNode(g_Config.numaNode);
+    }
+
+    if (g_Config.benchmark == "placement")
+    {
+        FILE* out = nullptr;
+        if (fopen_s(&out, "placement_benchmark.txt", "w") != 0 || !out)
+        {
+            return 1;
+        }
+        RunPlacementBenchmark(out);
+        fclose(out);
+        return 0;
+    }
+
+    if (g_Config.benchmark == "copy")
+    {
+        FILE* out = nullptr;
+        if (fopen_s(&out, "copy_benchmark.txt", "w") != 0 || !out)
+        {
+            return 1;
+        }
+        RunCopyBenchmark(out);
+        fclose(out);
+        return 0;
+    }
+
+    if (g_Config.benchmark == "matrix")
+    {
+        return RunMatrixBenchmark();
+    }
+
+    if (g_Config.benchmark == "raster")
+    {
+        FILE* out = nullptr;
+        if (fopen_s(&out, "raster_benchmark.txt", "w") != 0 || !out)
+        {
+            return 1;
+        }
+        RunRasterBenchmark(out);
+        fclose(out);
+        return 0;
+    }
+
+    if (g_Config.benchmark == "scale")
+    {
+        FILE* out = nullptr;
+        if (fopen_s(&out, "scale_benchmark.txt", "w") != 0 || !out)
+        {
+            return 1;
+        }
+        RunScaleBenchmark(out);
+        fclose(out);
+        return 0;
+    }
+
+    if (g_Config.benchmark == "srgb")
+    {
+        FILE* out = nullptr;
+        if (fopen_s(&out, "srgb_benchmark.txt", "w") != 0 || !out)
+        {
+            return 1;
+        }
+        RunSrgbBenchmark(out);
+        fclose(out);
+        return 0;
+    }
+
+    if (g_Config.canvasWidth > 0)
+    {
+        g_CanvasWidth = g_Config.canvasWidth;
+        g_CanvasHeight = g_Config.canvasHeight;
+    }
+
+    // The consumer window defaults to the canvas, but no larger than the
+    // default source so a huge canvas still fits on screen.
+    ResolveTargetSize(g_Config, g_TargetWidth, g_TargetHeight);
+
+    if (!g_Config.tracePath.empty())
+    {
+        TraceSetThreadName("main");
+        TraceSetEnabled(true);
+    }
+
     WNDCLASSEX wc{ sizeof(WNDCLASSEX), CS_HREDRAW | CS_VREDRAW, WindowProc,
                    0,0,hInstance, nullptr, LoadCursor(NULL, IDC_ARROW), nullptr, nullptr,
                    L"WindowClass", nullptr };
     RegisterClassEx(&wc);
 
-    g_hWndDX = CreateWindow(L"WindowClass", L"D3D11 Shared Texture",
-        WS_OVERLAPPEDWINDOW, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT,
-        nullptr, nullptr, hInstance, nullptr);
-    g_hWndGL = CreateWindow(L"WindowClass", L"OpenGL Shared Texture",
-        WS_OVERLAPPEDWINDOW, SCREEN_WIDTH + 20, 0, SCREEN_WIDTH, SCREEN_HEIGHT,
-        nullptr, nullptr, hInstance, nullptr);
+    if (g_Config.benchmark == "context")
+    {
+        return RunContextBenchmark(hInstance);
+    }
 
-    ShowWindow(g_hWndDX, nCmdShow);
-    ShowWindow(g_hWndGL, nCmdShow);
+    if (g_Config.transferAuto)
+    {
+        ResolveAutoTransfer(hInstance);
+    }
 
-    InitDX(g_hWndDX);
-    InitGL(g_hWndGL);
+    // Startup runs as three strands that only meet where data is shared:
+    // shader compilation (needed once the device exists), the GL context
+    // (needed to register the shared texture) and the D3D11 device and
+    // resources on this thread, which also owns the windows.
+    ProducerShaders shaders;
+    shaders.vs = std::async(StartupLaunchPolicy(), CompileProducerShader, g_VS, "vs_4_0", "compile vertex shader");
+    shaders.ps = std::async(StartupLaunchPolicy(), CompileProducerShader, g_PS, "ps_4_0", "compile pixel shader");
 
-    MSG msg{};
-    while (msg.message != WM_QUIT)
     {
-        if (KEYDOWN(VK_ESCAPE))
-            PostQuitMessage(0);
+        StartupPhase phase(g_Startup, "create windows");
+        g_hWndDX = CreateWindow(L"WindowClass", L"D3D11 Shared Texture",
+            WS_OVERLAPPEDWINDOW, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT,
+            nullptr, nullptr, hInstance, nullptr);
+        g_hWndGL = CreateWindow(L"WindowClass", L"OpenGL Shared Texture",
+            WS_OVERLAPPEDWINDOW, SCREEN_WIDTH + 20, 0, g_TargetWidth, g_TargetHeight,
+            nullptr, nullptr, hInstance, nullptr);
+    }
+    std::future<std::unique_ptr<OpenGLSharedRenderer>> glTask = std::async(StartupLaunchPolicy(), InitGL, g_hWndGL);
 
-        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+    {
+        StartupPhase phase(g_Startup, "show windows");
+        ShowWindow(g_hWndDX, nCmdShow);
+        ShowWindow(g_hWndGL, nCmdShow);
+    }
+
+    if (!g_Config.latencyPath.empty())
+    {
+        g_Latency = std::make_unique<LatencyTracker>();
+    }
+
+    InitDX(g_hWndDX, shaders);
+    AttachGL(glTask);
+    if (g_Config.resolutionBudgetMs > 0.0 && !g_Tiles)
+    {
+        g_Resolution = std::make_unique<DynamicResolution>();
+        g_Resolution->Configure(g_CanvasWidth, g_CanvasHeight, g_Config.resolutionBudgetMs,
+            g_Config.minResolutionPercent / 100.0);
+        if (!g_SoftRaster)
         {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+            CreateProducerTimers();
         }
+    }
+    // The marker is 256 pixels wide at source resolution and does not survive
+    // scaling, including the stretch of a dynamic resolution frame.
+    const bool fullSize = g_TargetWidth == g_CanvasWidth && g_TargetHeight == g_CanvasHeight;
+    g_OpenGLRenderer->EnableMarkerReadback(g_Latency != nullptr && fullSize && !g_Tiles && !g_Resolution);
+    g_OpenGLRenderer->EnableHud(g_Config.hud);
+    if (g_Config.transfer == TransferMode::Interop && !g_Config.lockLogPath.empty() &&
+        fopen_s(&g_LockLog, g_Config.lockLogPath.c_str(), "w") == 0 && g_LockLog)
+    {
+        g_OpenGLRenderer->LockMonitor().StartWatchdog(g_Config.lockBudgetMs, g_LockLog);
+    }
+
+    if (g_Config.benchmark == "pipeline")
+    {
+        const int result = RunPipelineBenchmark();
+        Destroy();
+        return result;
+    }
 
-		//Sleep(1); // ~60 FPS
+    if (g_Config.framesInFlight > 1)
+    {
+        g_Pipeline = std::make_unique<FramePipelineState>(g_Config.framesInFlight);
+    }
 
-        RenderDX();
-        RenderGL();
+    g_Waiter.Initialize();
+    if (g_Config.maxFps > 0)
+    {
+        g_Waiter.SetFrameInterval(1000000000ull / g_Config.maxFps);
     }
+    RunRenderLoop();
 
     Destroy();
     return 0;
 }
 
+// Writes bench_matrix.csv/.json; with -baseline, also bench_compare.txt and
+// exit code 2 when any cell regressed.
+int RunMatrixBenchmark()
+{
+    BenchMatrixOptions options;
+    options.frames = g_Config.benchFrames;
+    const std::vector<BenchResult> results = RunBenchmarkMatrix(options);
+
+    FILE* out = nullptr;
+    if (fopen_s(&out, "bench_matrix.csv", "w") == 0 && out)
+    {
+        WriteBenchResultsCsv(out, results);
+        fclose(out);
+    }
+    if (fopen_s(&out, "bench_matrix.json", "w") == 0 && out)
+    {
+        WriteBenchResultsJson(out, results);
+        fclose(out);
+    }
+
+    if (g_Config.baselinePath.empty())
+    {
+        return 0;
+    }
+
+    FILE* in = nullptr;
+    if (fopen_s(&in, g_Config.baselinePath.c_str(), "r") != 0 || !in)
+    {
+        return 1;
+    }
+    const std::vector<BenchResult> baseline = ReadBenchResultsCsv(in);
+    fclose(in);
+
+    int regressions = 0;
+    if (fopen_s(&out, "bench_compare.txt", "w") == 0 && out)
+    {
+        regressions = CompareBenchResults(out, baseline, results);
+        fclose(out);
+    }
+    return regressions > 0 ? 2 : 0;
+}
+
+// Shared texture format for -format / -srgb. YUV is converted from RGBA8.
+DXGI_FORMAT SharedTextureFormat()
+{
+    switch (g_Config.frameFormat)
+    {
+    case FrameFormat::Bgra8:   return g_Config.srgb ? DXGI_FORMAT_B8G8R8A8_UNORM_SRGB : DXGI_FORMAT_B8G8R8A8_UNORM;
+    case FrameFormat::Rgb10A2: return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case FrameFormat::Rgba16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    default:                   return g_Config.srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+const char* SharedFormatName()
+{
+    if (!g_Config.srgb)
+        return FrameFormatName(g_Config.frameFormat);
+    return g_Config.frameFormat == FrameFormat::Bgra8 ? "bgra8-srgb" : "rgba8-srgb";
+}
+
+// Creates each kind of GL context on its own hidden window (a window takes
+// one pixel format for life) and writes the per-call state cost and the CPU
+// time of a consumer frame on each to context_benchmark.txt.
+int RunContextBenchmark(HINSTANCE hInstance)
+{
+    FILE* out = nullptr;
+    if (fopen_s(&out, "context_benchmark.txt", "w") != 0 || !out)
+    {
+        return 1;
+    }
+
+    const GLContextOptions contexts[] =
+    {
+        { GLProfile::Legacy, false },
+        { GLProfile::Compatibility, false },
+        { GLProfile::Compatibility, true },
+        { GLProfile::Core, false },
+        { GLProfile::Core, true },
+    };
+    const int size = 512;
+    const int frames = 300;
+
+    // Cost of the compiled-in validation policy per interop check, against
+    // the same loop without the check. The result is read from memory so
+    // neither loop folds away; with NoValidation the two should match.
+    volatile BOOL result = TRUE;
+    const int checks = 10000000;
+    uint64_t start = FrameClockNs();
+    for (int i = 0; i < checks; ++i)
+    {
+        GLValidation::CheckInterop(result != FALSE, "benchmark");
+    }
+    const double checkedNs = static_cast<double>(FrameClockNs() - start) / checks;
+    start = FrameClockNs();
+    for (int i = 0; i < checks; ++i)
+    {
+        (void)(result != FALSE);
+    }
+    const double uncheckedNs = static_cast<double>(FrameClockNs() - start) / checks;
+    fprintf(out, "validation policy %s: %.3f ns per interop check, %.3f ns unchecked\n\n",
+        GLValidation::kName, checkedNs, uncheckedNs);
+
+    double loaderColdUs = 0.0;
+    double loaderUs = 0.0;
+    double glewUs = 0.0;
+
+    fprintf(out, "%-8s %-9s %12s %16s\n", "profile", "no-error", "ns/call", "consumer us/frame");
+    for (const GLContextOptions& options : contexts)
+    {
+        HWND hWnd = CreateWindow(L"WindowClass", L"GL context benchmark", WS_OVERLAPPEDWINDOW,
+            0, 0, size, size, nullptr, nullptr, hInstance, nullptr);
+        OpenGLSharedRenderer renderer(size, size);
+        if (!hWnd || !renderer.Initialize(hWnd, options) ||
+            !renderer.SetupFrameTextures(FrameFormat::Rgba8, size, size))
+        {
+            fprintf(out, "%-8s %-9s %12s\n", GLProfileName(options.profile), options.noError ? "requested" : "no",
+                "unsupported");
+        }
+        else
+        {
+            FrameBuffer pixels(FrameByteSize(FrameFormat::Rgba8, size, size));
+            renderer.UploadFrame(MakeVideoFrame(FrameFormat::Rgba8, size, size, pixels.Data()));
+            const double callNs = renderer.MeasureCallOverheadNs(200000);
+
+            if (options.profile == GLProfile::Legacy)
+            {
+                // Both loaders fill the same GLEW variables, so either can be
+                // rerun on the live context.
+                const int loads = 20;
+                HDC hdc = wglGetCurrentDC();
+                uint64_t loadStart = FrameClockNs();
+                for (int i = 0; i < loads; ++i)
+                {
+                    LoadGLEntryPoints(hdc);
+                }
+                loaderUs = (FrameClockNs() - loadStart) / 1e3 / loads;
+                loadStart = FrameClockNs();
+                for (int i = 0; i < loads; ++i)
+                {
+                    glewInit();
+                }
+                glewUs = (FrameClockNs() - loadStart) / 1e3 / loads;
+                loaderColdUs = renderer.EntryPointLoadNs() / 1e3;
+            }
+
+            uint64_t consumerNs = 0;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                renderer.Render();
+                const PresentTiming& timing = renderer.LastPresent();
+                consumerNs += timing.swapBeginNs - timing.renderBeginNs;
+            }
+
+            const char* noError = !options.noError ? "no" : (renderer.NoErrorContext() ? "yes" : "fallback");
+            fprintf(out, "%-8s %-9s %12.1f %16.1f\n", GLProfileName(options.profile), noError, callNs,
+                consumerNs / 1e3 / frames);
+        }
+        renderer.Cleanup();
+        if (hWnd)
+        {
+            DestroyWindow(hWnd);
+        }
+    }
+
+    fprintf(out, "\nentry points: LoadGLEntryPoints %.1f us (first call %.1f us), glewInit %.1f us, "
+        "%.1f us saved per context\n", loaderUs, loaderColdUs, glewUs, glewUs - loaderUs);
+    fprintf(out, "GL errors reported: %llu\n", static_cast<unsigned long long>(GLValidation::ErrorCount()));
+    fclose(out);
+    return 0;
+}
+
 // -----------------------------------------
-void InitDX(HWND hWnd)
+// -transfer auto: keeps interop when the probe (or its cached verdict) saw
+// the test pattern arrive, otherwise falls back to the CPU path if this
+// configuration has one. Runs before the startup tasks, which set up
+// whichever path is chosen.
+void ResolveAutoTransfer(HINSTANCE hInstance)
+{
+    StartupPhase phase(g_Startup, "transfer probe");
+    TransferProbeSetup setup{ hInstance, L"WindowClass", SharedTextureFormat(), g_Config.frameFormat,
+                              SharedFormatName(), g_Config.glContext, g_Config.probeCachePath };
+    const TransferProbeResult result = ProbeInteropTransfer(setup);
+    if (!result.interopWorks && CpuTransferSupported(g_Config))
+    {
+        g_Config.transfer = TransferMode::Cpu;
+    }
+
+    char line[512];
+    snprintf(line, sizeof(line), "SharedResource: transfer %s (%sinterop %s: %s)\n",
+        TransferModeName(g_Config.transfer), result.cached ? "cached, " : "",
+        result.interopWorks ? "verified" : "rejected", result.detail.c_str());
+    OutputDebugStringA(line);
+}
+
+// With -parallel-init off the tasks are deferred and run where they are
+// joined, which is the original serial order.
+std::launch StartupLaunchPolicy()
+{
+    return g_Config.parallelInit ? std::launch::async : std::launch::deferred;
+}
+
+// Waits for a startup task while still answering messages sent to this
+// thread's windows: a task working on a window owned by this thread may wait
+// on it, and a plain get() would deadlock.
+template <typename T>
+T JoinStartupTask(std::future<T>& task, const char* phase)
+{
+    const uint64_t beginNs = FrameClockNs();
+    MSG msg;
+    while (task.wait_for(std::chrono::milliseconds(1)) == std::future_status::timeout)
+    {
+        PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
+    }
+    if (g_Config.parallelInit)
+    {
+        g_Startup.Record(phase, beginNs, FrameClockNs());
+    }
+    return task.get();
+}
+
+com_ptr<ID3DBlob> CompileProducerShader(const char* source, const char* target, const char* phase)
+{
+    StartupPhase timing(g_Startup, phase);
+    com_ptr<ID3DBlob> blob;
+    D3DCompile(source, strlen(source), nullptr, nullptr, nullptr, "main", target, 0, 0, blob.put(), nullptr);
+    return blob;
+}
+
+void InitDX(HWND hWnd, ProducerShaders& shaders)
 {
     DXGI_SWAP_CHAIN_DESC sd{};
     sd.BufferCount = 1;
@@ -127,39 +709,105 @@ void InitDX(HWND hWnd)
     sd.SampleDesc.Count = 1;
     sd.Windowed = TRUE;
 
-    D3D11CreateDeviceAndSwapChain(
-        nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0,
-        D3D11_SDK_VERSION, &sd, &g_pSwapChain, &g_pd3dDevice, nullptr, &g_pImmediateContext);
+    {
+        StartupPhase phase(g_Startup, "D3D11 device + swap chain");
+        D3D11CreateDeviceAndSwapChain(
+            nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0,
+            D3D11_SDK_VERSION, &sd, &g_pSwapChain, &g_pd3dDevice, nullptr, &g_pImmediateContext);
+    }
+    const uint64_t resourcesBeginNs = FrameClockNs();
 
     // Create render target view
     com_ptr<ID3D11Texture2D> pBackBuffer;
     g_pSwapChain->GetBuffer(0, IID_PPV_ARGS(pBackBuffer.put()));
     g_pd3dDevice->CreateRenderTargetView(pBackBuffer.get(), nullptr, &g_pRenderTargetView);
 
-    // Create shared texture
-    D3D11_TEXTURE2D_DESC desc{};
-    desc.Width = SCREEN_WIDTH;
-    desc.Height = SCREEN_HEIGHT;
-    desc.MipLevels = 1;
-    desc.ArraySize = 1;
-    desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    desc.SampleDesc.Count = 1;
-    desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-    desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
-    g_pd3dDevice->CreateTexture2D(&desc, nullptr, &g_pSharedTex);
+    CreateSharedSurface(g_Config.tileSize > 0 ? g_Config.tileSize : kMaxTextureSize);
 
-    // Get shared handle
-    com_ptr<IDXGIResource> dxgiRes;
-    g_pSharedTex->QueryInterface(IID_PPV_ARGS(dxgiRes.put()));
-    dxgiRes->GetSharedHandle(&g_hSharedHandle);
+    if (g_Config.transfer == TransferMode::Cpu)
+    {
+        const unsigned cores = std::thread::hardware_concurrency();
+        const int threads = g_Config.jobThreads > 0 ? g_Config.jobThreads : (cores ? static_cast<int>(cores) : 1);
+        g_Jobs = std::make_unique<JobSystem>(threads, g_Config.threads[static_cast<int>(ThreadRole::Worker)]);
+    }
 
-    // Create RTV for shared texture
-    g_pd3dDevice->CreateRenderTargetView(g_pSharedTex, nullptr, g_pSharedRTV.put());
+    // CPU transfer path reads the shared texture back through a staging copy
+    // (the software producer renders straight into CPU memory instead)
+    if (g_Config.transfer == TransferMode::Cpu)
+    {
+        if (g_Config.producer == ProducerBackend::D3D11)
+        {
+            g_ReadbackLevel = MipLevelForTarget(g_CanvasWidth, g_CanvasHeight, g_TargetWidth, g_TargetHeight);
+            D3D11_TEXTURE2D_DESC stagingDesc{};
+            stagingDesc.Width = g_CanvasWidth >> g_ReadbackLevel;
+            stagingDesc.Height = g_CanvasHeight >> g_ReadbackLevel;
+            stagingDesc.MipLevels = 1;
+            stagingDesc.ArraySize = 1;
+            stagingDesc.Format = SharedTextureFormat();
+            stagingDesc.SampleDesc.Count = 1;
+            stagingDesc.Usage = D3D11_USAGE_STAGING;
+            stagingDesc.BindFlags = 0;
+            stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            stagingDesc.MiscFlags = 0;
+            D3D11_QUERY_DESC fenceDesc{ D3D11_QUERY_EVENT, 0 };
+
+            // -bench pipeline runs every depth on the same resources.
+            const int slots = g_Config.benchmark == "pipeline" ? kMaxFramesInFlight : g_Config.framesInFlight;
+            g_StagingTextures.resize(slots);
+            g_ReadbackFences.resize(slots);
+            for (int slot = 0; slot < slots; ++slot)
+            {
+                g_pd3dDevice->CreateTexture2D(&stagingDesc, nullptr, g_StagingTextures[slot].put());
+                g_pd3dDevice->CreateQuery(&fenceDesc, g_ReadbackFences[slot].put());
+            }
+
+            com_ptr<ID3D11Device5> device5;
+            if (SUCCEEDED(g_pd3dDevice->QueryInterface(IID_PPV_ARGS(device5.put()))) &&
+                SUCCEEDED(g_pImmediateContext->QueryInterface(IID_PPV_ARGS(g_pContext4.put()))) &&
+                SUCCEEDED(device5->CreateFence(0, D3D11_FENCE_FLAG_NONE, IID_PPV_ARGS(g_ReadbackFence.put()))))
+            {
+                g_ReadbackEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+                g_SlotFenceValues.assign(slots, 0);
+            }
+            else
+            {
+                g_pContext4 = nullptr;
+                g_ReadbackFence = nullptr;
+            }
+        }
+        g_CopyEngine = std::make_unique<FrameCopyEngine>(*g_Jobs);
+
+        const int sourceWidth = g_CanvasWidth >> g_ReadbackLevel;
+        const int sourceHeight = g_CanvasHeight >> g_ReadbackLevel;
+        if (sourceWidth != g_TargetWidth || sourceHeight != g_TargetHeight)
+        {
+            // CpuTransferSupported() keeps other formats off this path.
+            const FrameFormat format = g_Config.frameFormat;
+            if (format != FrameFormat::Rgba8 && format != FrameFormat::Bgra8 && !IsYuvFormat(format))
+            {
+                throw std::runtime_error("CPU resampling needs an 8-bit frame format");
+            }
+            g_Scaler = std::make_unique<FrameScaler>();
+            g_Scaler->Configure(sourceWidth, sourceHeight, g_TargetWidth, g_TargetHeight, g_Config.scaleFilter);
+            if (IsYuvFormat(g_Config.frameFormat) || g_Config.srgbConvert != SrgbConversion::None)
+            {
+                g_ScaledFrame = FrameBuffer(static_cast<size_t>(g_TargetWidth) * 4 * g_TargetHeight);
+            }
+        }
+    }
+
+    if (g_Config.producer == ProducerBackend::Software)
+    {
+        g_SoftRaster = std::make_unique<SoftRasterizer>(*g_Jobs);
+        g_SoftFrame = FrameBuffer(static_cast<size_t>(g_CanvasWidth) * 4 * g_CanvasHeight);
+    }
 
-    // Compile shaders
-    com_ptr<ID3DBlob> vsBlob, psBlob;
-    D3DCompile(g_VS, strlen(g_VS), nullptr, nullptr, nullptr, "main", "vs_4_0", 0, 0, vsBlob.put(), nullptr);
-    D3DCompile(g_PS, strlen(g_PS), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, psBlob.put(), nullptr);
+    g_Startup.Record("D3D11 resources", resourcesBeginNs, FrameClockNs());
+
+    // Shaders come from the startup tasks
+    com_ptr<ID3DBlob> vsBlob = JoinStartupTask(shaders.vs, "wait for shaders");
+    com_ptr<ID3DBlob> psBlob = JoinStartupTask(shaders.ps, "wait for shaders");
+    StartupPhase pipelinePhase(g_Startup, "D3D11 pipeline state");
 
     g_pd3dDevice->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, g_pVertexShader.put());
     g_pd3dDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, g_pPixelShader.put());
@@ -174,24 +822,17 @@ void InitDX(HWND hWnd)
         vsBlob->GetBufferSize(), g_pVertexLayout.put());
 
     // Create vertex buffer
-    SimpleVertex vertices[] =
-    {
-        { XMFLOAT3(0.0f,  0.5f, 0.5f), XMFLOAT4(1,0,0,1)},
-        { XMFLOAT3(0.5f, -0.5f, 0.5f), XMFLOAT4(0,1,0,1)},
-        { XMFLOAT3(-0.5f,-0.5f, 0.5f), XMFLOAT4(0,0,1,1)},
-    };
-
     D3D11_BUFFER_DESC bd{};
     bd.Usage = D3D11_USAGE_DEFAULT;
     bd.ByteWidth = sizeof(SimpleVertex) * 3;
     bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    D3D11_SUBRESOURCE_DATA initData{ vertices };
+    D3D11_SUBRESOURCE_DATA initData{ g_TriangleVertices };
     g_pd3dDevice->CreateBuffer(&bd, &initData, g_pVertexBuffer.put());
 
     // Create viewport
     D3D11_VIEWPORT vp{};
-    vp.Width = (FLOAT)SCREEN_WIDTH;
-    vp.Height = (FLOAT)SCREEN_HEIGHT;
+    vp.Width = (FLOAT)g_CanvasWidth;
+    vp.Height = (FLOAT)g_CanvasHeight;
     vp.MinDepth = 0.0f;
     vp.MaxDepth = 1.0f;
     g_pImmediateContext->RSSetViewports(1, &vp);
@@ -206,34 +847,277 @@ void InitDX(HWND hWnd)
     g_pd3dDevice->CreateBuffer(&cbDesc, &cbInit, g_pConstantBuffer.put());
 }
 
-void InitGL(HWND hWnd)
+// Creates what the producer renders into: g_pSharedTex with its handle, RTV
+// and (when downscaled) mip SRV, or, for an interop canvas larger than
+// |tileLimit|, one shared texture per tile. Replaces any previous surface, so
+// AttachGL can re-tile for a GL limit below the D3D11 one.
+void CreateSharedSurface(int tileLimit)
 {
-    g_OpenGLRenderer = std::make_unique<OpenGLSharedRenderer>(SCREEN_WIDTH, SCREEN_HEIGHT);
-    if (!g_OpenGLRenderer->Initialize(hWnd))
+    if (g_pSharedTex)
     {
-        throw std::runtime_error("Failed to initialize OpenGL renderer");
+        g_pSharedTex->Release();
+        g_pSharedTex = nullptr;
     }
+    g_pSharedRTV = nullptr;
+    g_pSharedSRV = nullptr;
+    g_hSharedHandle = nullptr;
+    g_ProducerTiles.clear();
+    g_Tiles.reset();
+    g_InstanceBounds.clear();
 
-    if (!g_OpenGLRenderer->SetupSharedTexture(g_pd3dDevice, g_pSharedTex, g_hSharedHandle))
+    D3D11_TEXTURE2D_DESC desc{};
+    desc.Width = g_CanvasWidth;
+    desc.Height = g_CanvasHeight;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = SharedTextureFormat();
+    desc.SampleDesc.Count = 1;
+    desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+    const bool downscaled = g_TargetWidth < g_CanvasWidth || g_TargetHeight < g_CanvasHeight;
+    if (downscaled)
     {
-        throw std::runtime_error("Failed to share DirectX texture with OpenGL");
+        desc.MipLevels = 0;
+        desc.MiscFlags |= D3D11_RESOURCE_MISC_GENERATE_MIPS;
+    }
+
+    if (g_Config.transfer == TransferMode::Interop && (g_CanvasWidth > tileLimit || g_CanvasHeight > tileLimit))
+    {
+        g_Tiles = std::make_unique<TiledSurface>();
+        g_Tiles->Configure(g_CanvasWidth, g_CanvasHeight, tileLimit);
+        g_ProducerTiles.resize(g_Tiles->TileCount());
+        for (int i = 0; i < g_Tiles->TileCount(); ++i)
+        {
+            const CanvasRect& rect = g_Tiles->Tile(i);
+            ProducerTile& tile = g_ProducerTiles[i];
+            desc.Width = rect.right - rect.left;
+            desc.Height = rect.bottom - rect.top;
+            g_pd3dDevice->CreateTexture2D(&desc, nullptr, tile.texture.put());
+            g_pd3dDevice->CreateRenderTargetView(tile.texture.get(), nullptr, tile.rtv.put());
+            if (downscaled)
+            {
+                g_pd3dDevice->CreateShaderResourceView(tile.texture.get(), nullptr, tile.srv.put());
+            }
+            com_ptr<IDXGIResource> dxgiRes;
+            tile.texture->QueryInterface(IID_PPV_ARGS(dxgiRes.put()));
+            dxgiRes->GetSharedHandle(&tile.sharedHandle);
+        }
+        return;
+    }
+
+    g_pd3dDevice->CreateTexture2D(&desc, nullptr, &g_pSharedTex);
+    if (downscaled)
+    {
+        g_pd3dDevice->CreateShaderResourceView(g_pSharedTex, nullptr, g_pSharedSRV.put());
     }
+
+    // Get shared handle
+    com_ptr<IDXGIResource> dxgiRes;
+    g_pSharedTex->QueryInterface(IID_PPV_ARGS(dxgiRes.put()));
+    dxgiRes->GetSharedHandle(&g_hSharedHandle);
+
+    // Create RTV for shared texture
+    g_pd3dDevice->CreateRenderTargetView(g_pSharedTex, nullptr, g_pSharedRTV.put());
 }
 
-void RenderDX()
+// Widest or tallest texture the producer currently shares.
+int LargestSharedDimension()
 {
-    static float angle = 0.0f;
-    angle += 0.18f;
-    XMMATRIX mWorldViewProj = XMMatrixTranspose(XMMatrixRotationZ(angle));
+    if (!g_Tiles)
+    {
+        return g_CanvasWidth > g_CanvasHeight ? g_CanvasWidth : g_CanvasHeight;
+    }
+    int largest = 0;
+    for (int i = 0; i < g_Tiles->TileCount(); ++i)
+    {
+        const CanvasRect& rect = g_Tiles->Tile(i);
+        const int width = rect.right - rect.left;
+        const int height = rect.bottom - rect.top;
+        largest = width > largest ? width : largest;
+        largest = height > largest ? height : largest;
+    }
+    return largest;
+}
 
-    g_pImmediateContext->UpdateSubresource(g_pConstantBuffer.get(), 0, nullptr, &mWorldViewProj, 0, 0);
-    ID3D11Buffer* constantBuffer = g_pConstantBuffer.get();
-    g_pImmediateContext->VSSetConstantBuffers(0, 1, &constantBuffer);
+// The half of GL startup that needs nothing from D3D11: context, entry
+// points and, on the CPU path, the frame textures. Runs as a startup task and
+// returns with the context released so the render thread can take it.
+std::unique_ptr<OpenGLSharedRenderer> InitGL(HWND hWnd)
+{
+    auto renderer = std::make_unique<OpenGLSharedRenderer>(g_TargetWidth, g_TargetHeight);
+    {
+        StartupPhase phase(g_Startup, "GL context + entry points");
+        if (!renderer->Initialize(hWnd, g_Config.glContext))
+        {
+            throw std::runtime_error("Failed to initialize OpenGL renderer");
+        }
+    }
 
-    float clearColor[4] = { 0.1f, 0.1f, 0.3f, 1.0f };
-    ID3D11RenderTargetView* sharedRTV = g_pSharedRTV.get();
-    g_pImmediateContext->OMSetRenderTargets(1, &sharedRTV, nullptr);
-    g_pImmediateContext->ClearRenderTargetView(sharedRTV, clearColor);
+    if (g_Config.transfer == TransferMode::Cpu)
+    {
+        StartupPhase phase(g_Startup, "GL frame textures");
+        if (!renderer->SetupFrameTextures(g_Config.frameFormat, g_TargetWidth, g_TargetHeight, g_Config.srgb))
+        {
+            throw std::runtime_error("Failed to create OpenGL frame textures");
+        }
+    }
+
+    renderer->ReleaseCurrent();
+    return renderer;
+}
+
+// Joins the GL task on the render thread; the interop registration needs
+// both the GL context and the D3D11 shared texture.
+void AttachGL(std::future<std::unique_ptr<OpenGLSharedRenderer>>& glTask)
+{
+    g_OpenGLRenderer = JoinStartupTask(glTask, "wait for GL");
+    if (!g_OpenGLRenderer->MakeCurrent())
+    {
+        throw std::runtime_error("Failed to make the OpenGL context current");
+    }
+
+    if (g_Config.transfer == TransferMode::Cpu)
+    {
+        return;
+    }
+
+    // GL may cap textures below the D3D11 limit the surface was cut for;
+    // nothing has been rendered yet, so re-tile for the smaller limit.
+    const int glLimit = g_OpenGLRenderer->MaxTextureSize();
+    if (glLimit > 0 && LargestSharedDimension() > glLimit)
+    {
+        StartupPhase phase(g_Startup, "re-tile for GL");
+        CreateSharedSurface(glLimit);
+    }
+
+    StartupPhase phase(g_Startup, "register shared texture");
+    if (g_Tiles)
+    {
+        std::vector<SharedTile> tiles;
+        for (int i = 0; i < g_Tiles->TileCount(); ++i)
+        {
+            const CanvasRect& rect = g_Tiles->Tile(i);
+            tiles.push_back({ g_ProducerTiles[i].texture.get(), g_ProducerTiles[i].sharedHandle,
+                              rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top });
+        }
+        if (!g_OpenGLRenderer->SetupSharedTiles(g_pd3dDevice, tiles, g_CanvasWidth, g_CanvasHeight))
+        {
+            throw std::runtime_error("Failed to share DirectX tiles with OpenGL");
+        }
+        return;
+    }
+    if (!g_OpenGLRenderer->SetupSharedTexture(g_pd3dDevice, g_pSharedTex, g_hSharedHandle))
+    {
+        throw std::runtime_error("Failed to share DirectX texture with OpenGL");
+    }
+}
+
+RenderSize CurrentRenderSize()
+{
+    if (!g_Resolution)
+    {
+        return RenderSize{ g_CanvasWidth, g_CanvasHeight };
+    }
+    return RenderSize{ g_Resolution->Width(), g_Resolution->Height() };
+}
+
+void CreateProducerTimers()
+{
+    D3D11_QUERY_DESC disjointDesc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+    D3D11_QUERY_DESC timestampDesc{ D3D11_QUERY_TIMESTAMP, 0 };
+    for (ProducerTimer& timer : g_ProducerTimers)
+    {
+        g_pd3dDevice->CreateQuery(&disjointDesc, timer.disjoint.put());
+        g_pd3dDevice->CreateQuery(&timestampDesc, timer.begin.put());
+        g_pd3dDevice->CreateQuery(&timestampDesc, timer.end.put());
+        timer.pending = false;
+    }
+}
+
+// Brackets the producer's GPU work. A frame whose timer is still in flight
+// from four frames ago goes untimed rather than waiting for it.
+void BeginProducerTimer()
+{
+    ProducerTimer& timer = g_ProducerTimers[g_ProducerTimerNext];
+    if (!g_Resolution || g_SoftRaster || timer.pending)
+    {
+        return;
+    }
+    g_pImmediateContext->Begin(timer.disjoint.get());
+    g_pImmediateContext->End(timer.begin.get());
+}
+
+void EndProducerTimer()
+{
+    ProducerTimer& timer = g_ProducerTimers[g_ProducerTimerNext];
+    if (!g_Resolution || g_SoftRaster || timer.pending)
+    {
+        return;
+    }
+    g_pImmediateContext->End(timer.end.get());
+    g_pImmediateContext->End(timer.disjoint.get());
+    timer.pending = true;
+    g_ProducerTimerNext = (g_ProducerTimerNext + 1) % 4;
+}
+
+// Feeds the controller every producer time that has become available: GPU
+// timers in the order they were issued, or the software producer's CPU time.
+void UpdateResolution(uint64_t producerCpuNs)
+{
+    if (!g_Resolution)
+    {
+        return;
+    }
+    if (g_SoftRaster)
+    {
+        g_Resolution->Update(producerCpuNs / 1e6);
+        return;
+    }
+
+    while (g_ProducerTimers[g_ProducerTimerOldest].pending)
+    {
+        ProducerTimer& timer = g_ProducerTimers[g_ProducerTimerOldest];
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+        UINT64 beginTicks = 0;
+        UINT64 endTicks = 0;
+        if (g_pImmediateContext->GetData(timer.disjoint.get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+            g_pImmediateContext->GetData(timer.begin.get(), &beginTicks, sizeof(beginTicks), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+            g_pImmediateContext->GetData(timer.end.get(), &endTicks, sizeof(endTicks), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+        {
+            return;
+        }
+        timer.pending = false;
+        g_ProducerTimerOldest = (g_ProducerTimerOldest + 1) % 4;
+        if (!disjoint.Disjoint && disjoint.Frequency > 0 && endTicks >= beginTicks)
+        {
+            g_Resolution->Update((endTicks - beginTicks) * 1000.0 / disjoint.Frequency);
+        }
+    }
+}
+
+// Draws the triangle with one instance's transform; the IA stage, shaders and
+// render target are already bound.
+void DrawInstance(const SoftMatrix& instance)
+{
+    XMMATRIX mWorldViewProj = XMMatrixTranspose(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&instance)));
+    g_pImmediateContext->UpdateSubresource(g_pConstantBuffer.get(), 0, nullptr, &mWorldViewProj, 0, 0);
+    g_pImmediateContext->Draw(3, 0);
+}
+
+void RenderDX(const RenderSize& size)
+{
+    TRACE_ZONE("RenderDX");
+    if (g_Latency)
+    {
+        g_Latency->OnProduced(++g_FrameSequence, FrameClockNs());
+    }
+
+    static float angle = 0.0f;
+    angle += 0.18f;
+    MakeInstanceGrid(angle, g_Config.instances, g_InstanceMatrices);
+
+    ID3D11Buffer* constantBuffer = g_pConstantBuffer.get();
+    g_pImmediateContext->VSSetConstantBuffers(0, 1, &constantBuffer);
 
     UINT stride = sizeof(SimpleVertex);
     UINT offset = 0;
@@ -243,28 +1127,836 @@ void RenderDX()
     g_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     g_pImmediateContext->VSSetShader(g_pVertexShader.get(), nullptr, 0);
     g_pImmediateContext->PSSetShader(g_pPixelShader.get(), nullptr, 0);
-    g_pImmediateContext->Draw(3, 0);
+
+    float clearColor[4] = { 0.1f, 0.1f, 0.3f, 1.0f };
+    if (g_Tiles)
+    {
+        RenderTiles(clearColor);
+        g_pImmediateContext->Flush();
+        return;
+    }
+
+    BeginProducerTimer();
+    ID3D11RenderTargetView* sharedRTV = g_pSharedRTV.get();
+    g_pImmediateContext->OMSetRenderTargets(1, &sharedRTV, nullptr);
+    g_pImmediateContext->ClearRenderTargetView(sharedRTV, clearColor);
+
+    // The scene fills the top-left |size| of the canvas; the whole texture
+    // is still cleared, so filtering at the edge of it reads background.
+    D3D11_VIEWPORT vp{};
+    vp.Width = (FLOAT)size.width;
+    vp.Height = (FLOAT)size.height;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    g_pImmediateContext->RSSetViewports(1, &vp);
+
+    // One draw per instance keeps the shader unchanged; with -instances 1
+    // this is the original single rotating triangle.
+    for (const SoftMatrix& instance : g_InstanceMatrices)
+    {
+        DrawInstance(instance);
+    }
+
+    if (g_Latency)
+    {
+        // Marker channels are all 0x00 or 0xFF, which reads the same as BGRA8
+        // and as R10G10B10A2; only half floats need converting (1.0 = 0x3C00).
+        EncodeFrameMarker(g_FrameSequence, g_MarkerPixels, kMarkerWidth * 4);
+        D3D11_BOX box{ 0, 0, 0, kMarkerWidth, kMarkerHeight, 1 };
+        if (g_Config.frameFormat == FrameFormat::Rgba16F)
+        {
+            for (size_t i = 0; i < sizeof(g_MarkerPixels); ++i)
+            {
+                g_MarkerHalfs[i] = g_MarkerPixels[i] ? 0x3C00 : 0;
+            }
+            g_pImmediateContext->UpdateSubresource(g_pSharedTex, 0, &box, g_MarkerHalfs, kMarkerWidth * 8, 0);
+        }
+        else
+        {
+            g_pImmediateContext->UpdateSubresource(g_pSharedTex, 0, &box, g_MarkerPixels, kMarkerWidth * 4, 0);
+        }
+    }
+
+    if (g_pSharedSRV)
+    {
+        g_pImmediateContext->GenerateMips(g_pSharedSRV.get());
+    }
+    EndProducerTimer();
+
     g_pImmediateContext->Flush();
 
     //g_pSwapChain->Present(1, 0);
 
 }
 
-void RenderGL()
+// Tiled canvas: each instance dirties the tiles under where it was last frame
+// and where it is now; only dirty tiles are cleared and redrawn, each with the
+// canvas viewport shifted so the tile sees its own part of the scene. The
+// latency marker is not drawn (it would need a readback across tiles).
+// Starts timing this frame's tile updates, or returns nullptr when the ring
+// entry is still waiting for the GPU; that frame then goes untimed.
+TileTimer* BeginTileTimer()
+{
+    TileTimer& timer = g_TileTimers[g_TileTimerNext];
+    if (timer.pending)
+    {
+        return nullptr;
+    }
+    if (!timer.disjoint)
+    {
+        D3D11_QUERY_DESC disjointDesc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+        if (FAILED(g_pd3dDevice->CreateQuery(&disjointDesc, timer.disjoint.put())))
+        {
+            return nullptr;
+        }
+    }
+    timer.tiles.clear();
+    g_pImmediateContext->Begin(timer.disjoint.get());
+    return &timer;
+}
+
+// Issues the timestamp before (|end| false) or after one tile's work.
+void TimeTile(TileTimer* timer, int tile, bool end)
+{
+    if (!timer)
+    {
+        return;
+    }
+    if (!end)
+    {
+        const size_t needed = (timer->tiles.size() + 1) * 2;
+        D3D11_QUERY_DESC timestampDesc{ D3D11_QUERY_TIMESTAMP, 0 };
+        while (timer->timestamps.size() < needed)
+        {
+            com_ptr<ID3D11Query> query;
+            if (FAILED(g_pd3dDevice->CreateQuery(&timestampDesc, query.put())))
+            {
+                return;
+            }
+            timer->timestamps.push_back(std::move(query));
+        }
+        timer->tiles.push_back(tile);
+    }
+    else if (timer->tiles.empty() || timer->tiles.back() != tile)
+    {
+        return;
+    }
+    g_pImmediateContext->End(timer->timestamps[(timer->tiles.size() - 1) * 2 + (end ? 1 : 0)].get());
+}
+
+void EndTileTimer(TileTimer* timer)
+{
+    if (!timer)
+    {
+        return;
+    }
+    g_pImmediateContext->End(timer->disjoint.get());
+    timer->pending = true;
+    g_TileTimerNext = (g_TileTimerNext + 1) % 4;
+}
+
+// Records the GPU time of every tile update whose frame has completed, in
+// the order the frames were issued.
+void ReadTileTimers()
+{
+    while (g_TileTimers[g_TileTimerOldest].pending)
+    {
+        TileTimer& timer = g_TileTimers[g_TileTimerOldest];
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+        if (g_pImmediateContext->GetData(timer.disjoint.get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+        {
+            return;
+        }
+        timer.pending = false;
+        g_TileTimerOldest = (g_TileTimerOldest + 1) % 4;
+        if (disjoint.Disjoint || disjoint.Frequency == 0)
+        {
+            continue;
+        }
+
+        // The disjoint query ends after every timestamp, so these are ready.
+        for (size_t i = 0; i < timer.tiles.size(); ++i)
+        {
+            UINT64 beginTicks = 0;
+            UINT64 endTicks = 0;
+            if (g_pImmediateContext->GetData(timer.timestamps[i * 2].get(), &beginTicks, sizeof(beginTicks), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                g_pImmediateContext->GetData(timer.timestamps[i * 2 + 1].get(), &endTicks, sizeof(endTicks), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                endTicks >= beginTicks)
+            {
+                g_Tiles->RecordGpuUpdate(timer.tiles[i], static_cast<uint64_t>((endTicks - beginTicks) * 1e9 / disjoint.Frequency));
+            }
+        }
+    }
+}
+
+void RenderTiles(const float clearColor[4])
+{
+    ReadTileTimers();
+    const size_t instances = g_InstanceMatrices.size();
+    std::vector<CanvasRect> bounds(instances);
+    for (size_t i = 0; i < instances; ++i)
+    {
+        bounds[i] = ProjectedBounds(reinterpret_cast<const SoftVertex*>(g_TriangleVertices), 3,
+                                    g_InstanceMatrices[i], g_CanvasWidth, g_CanvasHeight);
+        g_Tiles->Invalidate(bounds[i]);
+        if (i < g_InstanceBounds.size())
+        {
+            g_Tiles->Invalidate(g_InstanceBounds[i]);
+        }
+    }
+    g_InstanceBounds.swap(bounds);
+
+    TileTimer* timer = BeginTileTimer();
+    for (int t = 0; t < g_Tiles->TileCount(); ++t)
+    {
+        if (!g_Tiles->IsDirty(t))
+        {
+            continue;
+        }
+        const uint64_t beginNs = FrameClockNs();
+        TimeTile(timer, t, false);
+        const CanvasRect& rect = g_Tiles->Tile(t);
+        ProducerTile& tile = g_ProducerTiles[t];
+        ID3D11RenderTargetView* rtv = tile.rtv.get();
+        g_pImmediateContext->OMSetRenderTargets(1, &rtv, nullptr);
+        g_pImmediateContext->ClearRenderTargetView(rtv, clearColor);
+
+        D3D11_VIEWPORT vp{};
+        vp.TopLeftX = (FLOAT)-rect.left;
+        vp.TopLeftY = (FLOAT)-rect.top;
+        vp.Width = (FLOAT)g_CanvasWidth;
+        vp.Height = (FLOAT)g_CanvasHeight;
+        vp.MinDepth = 0.0f;
+        vp.MaxDepth = 1.0f;
+        g_pImmediateContext->RSSetViewports(1, &vp);
+
+        for (size_t i = 0; i < instances; ++i)
+        {
+            if (g_InstanceBounds[i].Overlaps(rect))
+            {
+                DrawInstance(g_InstanceMatrices[i]);
+            }
+        }
+        if (tile.srv)
+        {
+            g_pImmediateContext->GenerateMips(tile.srv.get());
+        }
+        TimeTile(timer, t, true);
+        g_Tiles->RecordUpdate(t, FrameClockNs() - beginNs);
+    }
+    EndTileTimer(timer);
+    g_Tiles->EndFrame();
+}
+
+void RenderSoftware(const RenderSize& size)
+{
+    TRACE_ZONE("RenderSoftware");
+    if (g_Latency)
+    {
+        g_Latency->OnProduced(++g_FrameSequence, FrameClockNs());
+    }
+
+    static float angle = 0.0f;
+    angle += 0.18f;
+    MakeInstanceGrid(angle, g_Config.instances, g_InstanceMatrices);
+
+    const float clearColor[4] = { 0.1f, 0.1f, 0.3f, 1.0f };
+    const size_t pitch = static_cast<size_t>(g_CanvasWidth) * 4;
+    if (size.width != g_SoftFrameSize.width || size.height != g_SoftFrameSize.height)
+    {
+        // A smaller frame would leave the old one's edge around it.
+        g_SoftRaster->Draw(reinterpret_cast<const SoftVertex*>(g_TriangleVertices), 3, nullptr, 0, clearColor,
+            g_SoftFrame.Data(), pitch, g_CanvasWidth, g_CanvasHeight);
+        g_SoftFrameSize = size;
+    }
+    g_SoftRaster->Draw(reinterpret_cast<const SoftVertex*>(g_TriangleVertices), 3,
+        g_InstanceMatrices.data(), static_cast<int>(g_InstanceMatrices.size()), clearColor,
+        g_SoftFrame.Data(), pitch, size.width, size.height);
+
+    if (g_Latency)
+    {
+        EncodeFrameMarker(g_FrameSequence, g_SoftFrame.Data(), static_cast<int>(pitch));
+    }
+}
+
+// Queues the copy of the frame just produced into |slot|'s staging texture
+// and the fence behind it, and submits both so the GPU works on them while
+// the frame waits.
+void ReadbackFrame(int slot, const RenderSize& size)
+{
+    if (g_StagingTextures.empty())
+    {
+        return;
+    }
+
+    TRACE_ZONE("ReadbackFrame");
+    // Only the rendered sub-rectangle, plus a few texels of background for
+    // the consumer's filter to blend against at its edge.
+    const int kMargin = 4;
+    const UINT levelWidth = static_cast<UINT>(g_CanvasWidth >> g_ReadbackLevel);
+    const UINT levelHeight = static_cast<UINT>(g_CanvasHeight >> g_ReadbackLevel);
+    const UINT copyWidth = static_cast<UINT>(((size.width + (1 << g_ReadbackLevel) - 1) >> g_ReadbackLevel) + kMargin);
+    const UINT copyHeight = static_cast<UINT>(((size.height + (1 << g_ReadbackLevel) - 1) >> g_ReadbackLevel) + kMargin);
+    D3D11_BOX box{};
+    box.right = copyWidth < levelWidth ? copyWidth : levelWidth;
+    box.bottom = copyHeight < levelHeight ? copyHeight : levelHeight;
+    box.back = 1;
+    g_pImmediateContext->CopySubresourceRegion(g_StagingTextures[slot].get(), 0, 0, 0, 0, g_pSharedTex, g_ReadbackLevel, &box);
+    if (g_ReadbackFence)
+    {
+        g_SlotFenceValues[slot] = ++g_ReadbackFenceValue;
+        g_pContext4->Signal(g_ReadbackFence.get(), g_ReadbackFenceValue);
+    }
+    else
+    {
+        g_pImmediateContext->End(g_ReadbackFences[slot].get());
+    }
+    g_pImmediateContext->Flush();
+}
+
+bool ReadbackComplete(int slot)
+{
+    if (g_StagingTextures.empty())
+    {
+        return true;
+    }
+    if (g_ReadbackFence)
+    {
+        return g_ReadbackFence->GetCompletedValue() >= g_SlotFenceValues[slot];
+    }
+    return g_pImmediateContext->GetData(g_ReadbackFences[slot].get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+}
+
+// Arms g_ReadbackEvent for the oldest readback the GPU has not finished.
+// Returns nullptr when none is pending or there is no fence to wait on.
+HANDLE ArmReadbackEvent()
+{
+    if (!g_ReadbackFence)
+    {
+        return nullptr;
+    }
+
+    const uint64_t completed = g_ReadbackFence->GetCompletedValue();
+    uint64_t oldest = 0;
+    for (uint64_t value : g_SlotFenceValues)
+    {
+        if (value > completed && (oldest == 0 || value < oldest))
+        {
+            oldest = value;
+        }
+    }
+    if (oldest == 0 || FAILED(g_ReadbackFence->SetEventOnCompletion(oldest, g_ReadbackEvent)))
+    {
+        return nullptr;
+    }
+    return g_ReadbackEvent;
+}
+
+void TransferFrame(int slot)
+{
+    if (g_Config.transfer != TransferMode::Cpu || !g_OpenGLRenderer)
+    {
+        return;
+    }
+
+    TRACE_ZONE("TransferFrame");
+
+    // Source is either the mapped D3D staging copy or the software frame.
+    const uint8_t* pixels = g_SoftFrame.Data();
+    size_t pitch = static_cast<size_t>(g_CanvasWidth) * 4;
+    D3D11_MAPPED_SUBRESOURCE mapped{};
+    ID3D11Texture2D* staging = g_StagingTextures.empty() ? nullptr : g_StagingTextures[slot].get();
+    if (staging)
+    {
+        if (FAILED(g_pImmediateContext->Map(staging, 0, D3D11_MAP_READ, 0, &mapped)))
+        {
+            return;
+        }
+        pixels = static_cast<const uint8_t*>(mapped.pData);
+        pitch = mapped.RowPitch;
+    }
+
+    VideoFrame frame{};
+    if (pixels && g_OpenGLRenderer->BeginFrameUpload(frame))
+    {
+        const bool yuv = IsYuvFormat(g_Config.frameFormat);
+        const bool convert = g_Config.srgbConvert != SrgbConversion::None;
+        if (g_Scaler)
+        {
+            // RGBA resamples straight into the upload buffer; YUV and sRGB
+            // conversion read it again, so they go via g_ScaledFrame.
+            const bool staged = yuv || convert;
+            const size_t scaledPitch = staged ? static_cast<size_t>(g_TargetWidth) * 4 : frame.planes[0].pitch;
+            uint8_t* scaled = staged ? g_ScaledFrame.Data() : frame.planes[0].data;
+            g_Scaler->Scale(pixels, pitch, scaled, scaledPitch, g_Jobs.get());
+            pixels = scaled;
+            pitch = scaledPitch;
+        }
+
+        if (convert)
+        {
+            // Reads the source once and writes the upload buffer once.
+            TRACE_ZONE("ConvertSrgb");
+            ConvertSrgb(g_Config.srgbConvert, g_Config.frameFormat, pixels, pitch,
+                frame.planes[0].data, frame.planes[0].pitch, g_TargetWidth, g_TargetHeight, g_Jobs.get());
+        }
+        else if (yuv)
+        {
+            ConvertRgbaToYuv(pixels, static_cast<int>(pitch), frame, g_Jobs.get());
+        }
+        else if (!g_Scaler)
+        {
+            g_CopyEngine->Copy(frame.planes[0].data, frame.planes[0].pitch, pixels, pitch,
+                static_cast<size_t>(g_TargetWidth) * FramePixelBytes(g_Config.frameFormat), g_TargetHeight);
+        }
+        g_OpenGLRenderer->EndFrameUpload();
+    }
+
+    if (staging)
+    {
+        g_pImmediateContext->Unmap(staging, 0);
+    }
+}
+
+void RenderGL(const RenderSize& size)
 {
     if (g_OpenGLRenderer)
     {
+        g_OpenGLRenderer->SetSourceExtent(static_cast<float>(size.width) / g_CanvasWidth,
+                                          static_cast<float>(size.height) / g_CanvasHeight);
         g_OpenGLRenderer->Render();
+
+        if (g_Latency)
+        {
+            const PresentTiming& timing = g_OpenGLRenderer->LastPresent();
+            if (timing.markerValid)
+                g_Latency->OnDisplayed(timing.sequence, timing.drawnNs, timing.presentedNs);
+            else
+                g_Latency->OnMarkerLost();
+        }
+    }
+}
+
+// The original loop: each stage waits for the one before it, and Map()
+// waits for the readback copy.
+void RunSerialFrame()
+{
+    const RenderSize size = CurrentRenderSize();
+    const uint64_t frameBeginNs = FrameClockNs();
+    if (g_SoftRaster)
+        RenderSoftware(size);
+    else
+        RenderDX(size);
+    const uint64_t producedNs = FrameClockNs();
+    ReadbackFrame(0, size);
+    TransferFrame(0);
+    const uint64_t transferredNs = FrameClockNs();
+    RenderGL(size);
+    CompleteFrame(frameBeginNs, producedNs, producedNs, transferredNs);
+}
+
+// One frame of the coroutine pipeline. Instead of stalling in Map() it
+// suspends on its readback fence, which lets the executor produce the next
+// frame while this one's copy is still on the GPU. Production and the
+// transfer/draw half each run in frame order: both touch state there is only
+// one of (the animation and shared texture, the upload buffer and window).
+// The frame queue decides at its turn to present whether it is still wanted.
+FrameTask PipelinedFrame(FramePipelineState& pipeline, uint64_t frame)
+{
+    PipelineExecutor& executor = pipeline.executor;
+    co_await pipeline.produceOrder.Turn(executor, frame);
+
+    // Only the frame whose turn it is to produce waits here, so the wait is
+    // time the producer is held back by frames not yet delivered.
+    pipeline.queue.BeginProducerBlocked(FrameClockNs());
+    const int slot = co_await pipeline.slots.Acquire(executor);
+    pipeline.queue.EndProducerBlocked(FrameClockNs());
+
+    // The size travels with the frame: the controller may change it before
+    // this one is drawn.
+    const RenderSize size = CurrentRenderSize();
+    const uint64_t frameBeginNs = FrameClockNs();
+    if (g_SoftRaster)
+        RenderSoftware(size);
+    else
+        RenderDX(size);
+    const uint64_t producedNs = FrameClockNs();
+    ReadbackFrame(slot, size);
+    pipeline.queue.Push(frame, slot, producedNs);
+    pipeline.produceOrder.Advance();
+
+    co_await executor.When([slot] { return ReadbackComplete(slot); });
+    co_await pipeline.presentOrder.Turn(executor, frame);
+
+    if (!pipeline.queue.Take(frame, FrameClockNs(), ReadbackComplete))
+    {
+        // Dropped unseen: the slot goes straight back to the producer.
+        pipeline.slots.Release(slot);
+        pipeline.presentOrder.Advance();
+        UpdateResolution(producedNs - frameBeginNs);
+        co_return;
+    }
+
+    const uint64_t transferBeginNs = FrameClockNs();
+    TransferFrame(slot);
+    const uint64_t transferredNs = FrameClockNs();
+    RenderGL(size);
+    pipeline.slots.Release(slot);
+    pipeline.presentOrder.Advance();
+    CompleteFrame(frameBeginNs, producedNs, transferBeginNs, transferredNs);
+}
+
+// A new frame starts while the consumer window is visible and, with
+// -max-fps, once it is due.
+bool FrameWanted()
+{
+    return !IsIconic(g_hWndGL) && g_Waiter.FrameDue();
+}
+
+// Keeps up to -frames-in-flight frames started (with |paced|, only as
+// FrameWanted() allows) and resumes those that can move on. Returns how many
+// frames started or resumed.
+int RunPipelinedFrames(bool paced)
+{
+    FramePipelineState& pipeline = *g_Pipeline;
+    UpdateProducerStall(pipeline);
+    int progress = 0;
+    while (pipeline.executor.InFlight() < pipeline.depth && (!paced || FrameWanted()))
+    {
+        pipeline.executor.Spawn(PipelinedFrame(pipeline, pipeline.spawned++));
+        ++progress;
+    }
+    progress += pipeline.executor.Poll();
+    UpdateProducerStall(pipeline);
+    return progress;
+}
+
+// The producer is also held back while the pipeline is full and no frame in
+// it is left to produce. A frame that is in it but not yet produced counts
+// its own wait for a slot instead, so the two never overlap.
+void UpdateProducerStall(FramePipelineState& pipeline)
+{
+    const bool stalled = pipeline.executor.InFlight() >= pipeline.depth &&
+                         pipeline.produceOrder.Next() == pipeline.spawned;
+    if (stalled == pipeline.producerStalled)
+    {
+        return;
+    }
+    pipeline.producerStalled = stalled;
+    if (stalled)
+        pipeline.queue.BeginProducerBlocked(FrameClockNs());
+    else
+        pipeline.queue.EndProducerBlocked(FrameClockNs());
+}
+
+// Runs frames while there is work and otherwise sleeps in g_Waiter until
+// something can change that: a message (input, the consumer window being
+// restored), a readback fence or the next paced frame.
+void RunRenderLoop()
+{
+    MSG msg{};
+    for (;;)
+    {
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            if (msg.message == WM_QUIT)
+            {
+                return;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        if (!g_Pipeline)
+        {
+            if (FrameWanted())
+                RunSerialFrame();
+            else
+                g_Waiter.Wait(nullptr, 0, !IsIconic(g_hWndGL));
+            continue;
+        }
+
+        if (RunPipelinedFrames(true) > 0)
+        {
+            continue;
+        }
+
+        // Nothing moved: the frames in flight wait on the GPU and no new one
+        // is due. Without a fence event the GPU can only be polled.
+        HANDLE fenceEvent = ArmReadbackEvent();
+        const bool gpuPending = !g_Pipeline->executor.Idle();
+        const bool frameSlotFree = g_Pipeline->executor.InFlight() < g_Pipeline->depth;
+        g_Waiter.Wait(&fenceEvent, fenceEvent ? 1 : 0, frameSlotFree && !IsIconic(g_hWndGL),
+            gpuPending && !fenceEvent ? 0 : INFINITE);
+    }
+}
+
+// Runs -bench-frames frames through the serial loop and then through the
+// pipeline at each depth, on the configuration given on the command line,
+// and writes frame rate, mean producer and transfer time and producer-to-
+// present latency to pipeline_benchmark.txt.
+int RunPipelineBenchmark()
+{
+    FILE* out = nullptr;
+    if (fopen_s(&out, "pipeline_benchmark.txt", "w") != 0 || !out)
+    {
+        return 1;
+    }
+
+    fprintf(out, "transfer=%s format=%s producer=%s instances=%d frames=%d queue=%s\n",
+        TransferModeName(g_Config.transfer), SharedFormatName(), g_SoftRaster ? "software" : "d3d11",
+        g_Config.instances, g_Config.benchFrames, QueuePolicyName(g_Config.queuePolicy));
+    fprintf(out, "%-9s %6s %6s %9s %12s %12s %12s %12s %8s %10s\n", "loop", "depth", "slots", "fps", "producer ms",
+        "transfer ms", "latency p50", "latency p99", "dropped", "blocked ms");
+
+    const uint64_t warmupFrames = 10;
+    MSG msg{};
+    for (int depth = 1; depth <= kMaxFramesInFlight && msg.message != WM_QUIT; ++depth)
+    {
+        g_Pipeline = depth > 1 ? std::make_unique<FramePipelineState>(depth) : nullptr;
+        g_FrameStats.Reset();
+        bool measuring = false;
+        uint64_t startNs = 0;
+        uint64_t frames = 0;
+        uint64_t droppedBefore = 0;
+        uint64_t blockedBefore = 0;
+        while (msg.message != WM_QUIT)
+        {
+            while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+
+            frames = g_FrameStats.Stage(FrameStage::Frame).Count();
+            if (!measuring && frames >= warmupFrames)
+            {
+                g_FrameStats.Reset();
+                startNs = FrameClockNs();
+                measuring = true;
+                frames = 0;
+                droppedBefore = g_Pipeline ? g_Pipeline->queue.Dropped() : 0;
+                blockedBefore = g_Pipeline ? g_Pipeline->queue.ProducerBlockedNs() : 0;
+            }
+            else if (measuring && frames >= static_cast<uint64_t>(g_Config.benchFrames))
+            {
+                break;
+            }
+
+            if (g_Pipeline)
+                RunPipelinedFrames(false);
+            else
+                RunSerialFrame();
+        }
+        const double seconds = (FrameClockNs() - startNs) / 1e9;
+
+        // Let the frames still in flight finish before the next depth.
+        while (g_Pipeline && !g_Pipeline->executor.Idle())
+        {
+            g_Pipeline->executor.Poll();
+        }
+
+        const FrameHistogram& latency = g_FrameStats.Stage(FrameStage::Frame);
+        fprintf(out, "%-9s %6d %6d %9.1f %12.3f %12.3f %12.3f %12.3f %8llu %10.1f\n", depth > 1 ? "pipeline" : "serial",
+            depth, g_Pipeline ? g_Pipeline->slots.Count() : 1, seconds > 0.0 ? frames / seconds : 0.0,
+            g_FrameStats.Stage(FrameStage::Producer).MeanNs() / 1e6,
+            g_FrameStats.Stage(FrameStage::Transfer).MeanNs() / 1e6,
+            latency.ValueAtQuantile(0.5) / 1e6, latency.ValueAtQuantile(0.99) / 1e6,
+            g_Pipeline ? static_cast<unsigned long long>(g_Pipeline->queue.Dropped() - droppedBefore) : 0ULL,
+            g_Pipeline ? (g_Pipeline->queue.ProducerBlockedNs() - blockedBefore) / 1e6 : 0.0);
+    }
+    g_Pipeline.reset();
+    fclose(out);
+    return 0;
+}
+
+void CompleteFrame(uint64_t frameBeginNs, uint64_t producedNs, uint64_t transferBeginNs, uint64_t transferredNs)
+{
+    UpdateResolution(producedNs - frameBeginNs);
+    RecordFrameStats(frameBeginNs, producedNs, transferBeginNs, transferredNs);
+    if (!g_Startup.Finished())
+    {
+        g_Startup.MarkFirstFrame();
+        DumpStartupTimeline();
+    }
+}
+
+void RecordFrameStats(uint64_t frameBeginNs, uint64_t producedNs, uint64_t transferBeginNs, uint64_t transferredNs)
+{
+    if (!g_OpenGLRenderer)
+    {
+        return;
+    }
+
+    const PresentTiming& timing = g_OpenGLRenderer->LastPresent();
+    const bool cpuTransfer = g_Config.transfer == TransferMode::Cpu;
+    g_FrameStats.Record(FrameStage::Producer, producedNs - frameBeginNs);
+    if (cpuTransfer)
+    {
+        g_FrameStats.Record(FrameStage::Transfer, transferredNs - transferBeginNs);
+    }
+    g_FrameStats.Record(FrameStage::Consumer, timing.swapBeginNs - timing.renderBeginNs);
+    g_FrameStats.Record(FrameStage::Present, timing.presentedNs - timing.swapBeginNs);
+    g_FrameStats.Record(FrameStage::Frame, timing.presentedNs - frameBeginNs);
+
+    // A frame that took more than two 60 Hz intervals missed at least one vsync.
+    const double frameMs = (timing.presentedNs - frameBeginNs) / 1e6;
+    g_DroppedFrames += frameMs > 2.0 * 1000.0 / 60.0 ? 1 : 0;
+    g_SmoothedFrameMs = g_SmoothedFrameMs > 0.0 ? g_SmoothedFrameMs * 0.95 + frameMs * 0.05 : frameMs;
+    const JobFrameStats jobs = g_Jobs ? g_Jobs->EndFrame() : JobFrameStats{};
+
+    if (g_OpenGLRenderer->HudEnabled())
+    {
+        HudStats hud{};
+        hud.fps = g_SmoothedFrameMs > 0.0 ? static_cast<float>(1000.0 / g_SmoothedFrameMs) : 0.0f;
+        hud.producerMs = static_cast<float>((producedNs - frameBeginNs) / 1e6);
+        hud.transferMs = cpuTransfer ? static_cast<float>((transferredNs - transferBeginNs) / 1e6) : 0.0f;
+        hud.consumerMs = static_cast<float>((timing.swapBeginNs - timing.renderBeginNs) / 1e6);
+        hud.presentMs = static_cast<float>((timing.presentedNs - timing.swapBeginNs) / 1e6);
+        hud.frameMs = static_cast<float>(frameMs);
+        hud.transferMode = TransferModeName(g_Config.transfer);
+        hud.frameFormat = SharedFormatName();
+        hud.bytesPerFrame = cpuTransfer ? FrameByteSize(g_Config.frameFormat, g_TargetWidth, g_TargetHeight) : 0;
+        hud.droppedFrames = g_DroppedFrames;
+        hud.lockMs = cpuTransfer ? 0.0f : static_cast<float>(g_OpenGLRenderer->LastLockMs());
+        hud.jobThreads = g_Jobs ? g_Jobs->ThreadCount() : 0;
+        hud.jobUtilization = static_cast<float>(jobs.utilization);
+        hud.jobSteals = jobs.steals;
+        hud.renderWidth = g_Resolution ? g_Resolution->Width() : 0;
+        hud.renderHeight = g_Resolution ? g_Resolution->Height() : 0;
+        hud.renderScale = g_Resolution ? static_cast<float>(g_Resolution->Scale()) : 0.0f;
+        g_OpenGLRenderer->SetHudStats(hud);
+    }
+}
+
+// Bound to F7 and run again at exit.
+void DumpFrameStats()
+{
+    const std::string& path = g_Config.statsPath;
+    FILE* out = nullptr;
+    if (path.empty() || fopen_s(&out, path.c_str(), "w") != 0 || !out)
+    {
+        return;
+    }
+
+    const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json)
+        g_FrameStats.ReportJson(out);
+    else
+        g_FrameStats.Report(out);
+    if (!json && g_Jobs)
+        g_Jobs->Report(out);
+    if (!json)
+        g_Waiter.Report(out);
+    if (!json && g_Resolution)
+        g_Resolution->Report(out);
+    if (!json && g_Pipeline)
+        g_Pipeline->queue.Report(out);
+    fclose(out);
+}
+
+// Logs the time to first frame and writes -startup-log once it is presented.
+void DumpStartupTimeline()
+{
+    const char* mode = g_Config.parallelInit ? "parallel" : "serial";
+    char line[128];
+    snprintf(line, sizeof(line), "SharedResource: first frame %.2f ms after start (%s startup)\n",
+        g_Startup.FirstFrameNs() / 1e6, mode);
+    OutputDebugStringA(line);
+
+    FILE* out = nullptr;
+    if (!g_Config.startupLogPath.empty() && fopen_s(&out, g_Config.startupLogPath.c_str(), "w") == 0 && out)
+    {
+        g_Startup.Write(out, mode);
+        fclose(out);
+    }
+}
+
+// Writes everything recorded so far; bound to F8 and run again at exit.
+void DumpTrace()
+{
+    if (g_Config.tracePath.empty())
+    {
+        return;
+    }
+
+    FILE* out = nullptr;
+    if (fopen_s(&out, g_Config.tracePath.c_str(), "w") == 0 && out)
+    {
+        TraceWriteChromeJson(out);
+        fclose(out);
     }
 }
 
 void Destroy()
 {
+    DumpTrace();
+    DumpFrameStats();
+
+    FILE* out = nullptr;
+    if (g_Latency && fopen_s(&out, g_Config.latencyPath.c_str(), "w") == 0 && out)
+    {
+        char mode[64];
+        snprintf(mode, sizeof(mode), "transfer=%s format=%s",
+            TransferModeName(g_Config.transfer), SharedFormatName());
+        g_Latency->Report(out, mode);
+        fclose(out);
+    }
+
+    out = nullptr;
+    if (g_Tiles && !g_Config.tileStatsPath.empty() &&
+        fopen_s(&out, g_Config.tileStatsPath.c_str(), "w") == 0 && out)
+    {
+        g_Tiles->Report(out, FramePixelBytes(g_Config.frameFormat), g_TargetWidth < g_CanvasWidth || g_TargetHeight < g_CanvasHeight);
+        fclose(out);
+    }
+
+    if (g_OpenGLRenderer && g_LockLog)
+    {
+        // Stop the watchdog before the log it writes to is closed.
+        g_OpenGLRenderer->LockMonitor().StopWatchdog();
+        g_OpenGLRenderer->LockMonitor().Report(g_LockLog);
+        fclose(g_LockLog);
+        g_LockLog = nullptr;
+    }
+
+    // Frames still suspended in the pipeline are dropped with it.
+    g_Pipeline.reset();
+
     if (g_OpenGLRenderer)
     {
         g_OpenGLRenderer->Cleanup();
         g_OpenGLRenderer.reset();
     }
+
+    g_CopyEngine.reset();
+    g_SoftRaster.reset();
+    g_Jobs.reset();
+    g_SoftFrame = FrameBuffer();
+    g_Scaler.reset();
+    g_ScaledFrame = FrameBuffer();
+    g_pSharedSRV = nullptr;
+    g_ProducerTiles.clear();
+    g_Tiles.reset();
+    for (TileTimer& timer : g_TileTimers)
+    {
+        timer = TileTimer{};
+    }
+    g_Resolution.reset();
+    for (ProducerTimer& timer : g_ProducerTimers)
+    {
+        timer = ProducerTimer{};
+    }
+
+    g_StagingTextures.clear();
+    g_ReadbackFences.clear();
+    g_ReadbackFence = nullptr;
+    g_pContext4 = nullptr;
+    if (g_ReadbackEvent)
+    {
+        CloseHandle(g_ReadbackEvent);
+        g_ReadbackEvent = nullptr;
+    }
 }
 
 LRESULT CALLBACK WindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -274,6 +1966,26 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         PostQuitMessage(0);
         return 0;
     }
+    if (msg == WM_KEYDOWN && wParam == VK_ESCAPE)
+    {
+        PostQuitMessage(0);
+        return 0;
+    }
+    if (msg == WM_KEYDOWN && wParam == VK_F6 && g_OpenGLRenderer)
+    {
+        g_OpenGLRenderer->EnableHud(!g_OpenGLRenderer->HudEnabled());
+        return 0;
+    }
+    if (msg == WM_KEYDOWN && wParam == VK_F7)
+    {
+        DumpFrameStats();
+        return 0;
+    }
+    if (msg == WM_KEYDOWN && wParam == VK_F8)
+    {
+        DumpTrace();
+        return 0;
+    }
     return DefWindowProc(hWnd, msg, wParam, lParam);
 }
 
@@ -0,0 +1,529 @@
+#include "SoftRasterizer.h"
+
+#include "FrameAllocator.h"
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; GCC and Clang need the
+// target enabled per function so the rest of the file stays SSE2.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define RASTER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define RASTER_AVX2_TARGET
+#endif
+
+// Edge functions e = A*x + B*y + C are positive inside; edge i is the one
+// opposite vertex i, so e_i / area is vertex i's barycentric weight. The five
+// attribute planes hold 1/w and the colour channels (0..255) divided by w.
+struct RasterTriangle
+{
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    bool topLeft[3];
+    float planeA[5];
+    float planeB[5];
+    float planeC[5];
+    int minX;
+    int minY;
+    int maxX;   // exclusive
+    int maxY;   // exclusive
+};
+
+namespace
+{
+    const int kTileShift = 6;
+    const int kTileSize = 1 << kTileShift;
+    const float kSubpixelSteps = 16.0f;
+
+    inline uint32_t PackColor(const float color[4])
+    {
+        uint32_t pixel = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            const float value = std::min(std::max(color[c], 0.0f), 1.0f) * 255.0f + 0.5f;
+            pixel |= static_cast<uint32_t>(value) << (c * 8);
+        }
+        return pixel;
+    }
+
+    inline int ClampToPixels(float value, int limit)
+    {
+        return static_cast<int>(std::min(std::max(value, 0.0f), static_cast<float>(limit)));
+    }
+
+    bool SetupTriangle(const SoftVertex* v, const SoftMatrix& matrix, int width, int height, RasterTriangle& tri)
+    {
+        const float (&m)[4][4] = matrix.m;
+        float x[3];
+        float y[3];
+        float invW[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const float* p = v[i].position;
+            const float clipX = p[0] * m[0][0] + p[1] * m[1][0] + p[2] * m[2][0] + m[3][0];
+            const float clipY = p[0] * m[0][1] + p[1] * m[1][1] + p[2] * m[2][1] + m[3][1];
+            const float clipW = p[0] * m[0][3] + p[1] * m[1][3] + p[2] * m[2][3] + m[3][3];
+            if (!(clipW > 1e-6f))
+            {
+                return false;
+            }
+
+            // D3D viewport mapping, snapped to a 1/16 pixel grid.
+            invW[i] = 1.0f / clipW;
+            x[i] = std::floor((clipX * invW[i] * 0.5f + 0.5f) * width * kSubpixelSteps + 0.5f) / kSubpixelSteps;
+            y[i] = std::floor((0.5f - clipY * invW[i] * 0.5f) * height * kSubpixelSteps + 0.5f) / kSubpixelSteps;
+        }
+
+        // Clockwise on screen is front-facing; drop back faces and slivers.
+        const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (!(area > 0.0f))
+        {
+            return false;
+        }
+
+        tri.minX = ClampToPixels(std::floor(std::min({ x[0], x[1], x[2] })), width);
+        tri.minY = ClampToPixels(std::floor(std::min({ y[0], y[1], y[2] })), height);
+        tri.maxX = ClampToPixels(std::ceil(std::max({ x[0], x[1], x[2] })), width);
+        tri.maxY = ClampToPixels(std::ceil(std::max({ y[0], y[1], y[2] })), height);
+        if (tri.minX >= tri.maxX || tri.minY >= tri.maxY)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const int j = (i + 1) % 3;
+            const int k = (i + 2) % 3;
+            tri.edgeA[i] = y[j] - y[k];
+            tri.edgeB[i] = x[k] - x[j];
+            tri.edgeC[i] = -(tri.edgeA[i] * x[j] + tri.edgeB[i] * y[j]);
+            tri.topLeft[i] = tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] > 0.0f);
+        }
+
+        const float invArea = 1.0f / area;
+        for (int plane = 0; plane < 5; ++plane)
+        {
+            float f[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                f[i] = plane == 0 ? invW[i] : v[i].color[plane - 1] * 255.0f * invW[i];
+            }
+            tri.planeA[plane] = (tri.edgeA[0] * f[0] + tri.edgeA[1] * f[1] + tri.edgeA[2] * f[2]) * invArea;
+            tri.planeB[plane] = (tri.edgeB[0] * f[0] + tri.edgeB[1] * f[1] + tri.edgeB[2] * f[2]) * invArea;
+            tri.planeC[plane] = (tri.edgeC[0] * f[0] + tri.edgeC[1] * f[1] + tri.edgeC[2] * f[2]) * invArea;
+        }
+        return true;
+    }
+
+    // Fills the part of |tri| inside [x0, x1) x [y0, y1), four pixels per step.
+    void RasterRectSse2(const RasterTriangle& tri, uint8_t* target, size_t pitch, int x0, int y0, int x1, int y1)
+    {
+        const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 maxChannel = _mm_set1_ps(255.0f);
+        const __m128 limit = _mm_set1_ps(static_cast<float>(x1));
+
+        __m128 edgeA[3];
+        __m128 topLeft[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edgeA[i] = _mm_set1_ps(tri.edgeA[i]);
+            topLeft[i] = tri.topLeft[i] ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : zero;
+        }
+        __m128 planeA[5];
+        for (int plane = 0; plane < 5; ++plane)
+        {
+            planeA[plane] = _mm_set1_ps(tri.planeA[plane]);
+        }
+
+        for (int y = y0; y < y1; ++y)
+        {
+            const float py = y + 0.5f;
+            __m128 rowEdge[3];
+            __m128 rowPlane[5];
+            for (int i = 0; i < 3; ++i)
+            {
+                rowEdge[i] = _mm_set1_ps(tri.edgeB[i] * py + tri.edgeC[i]);
+            }
+            for (int plane = 0; plane < 5; ++plane)
+            {
+                rowPlane[plane] = _mm_set1_ps(tri.planeB[plane] * py + tri.planeC[plane]);
+            }
+
+            uint32_t* row = reinterpret_cast<uint32_t*>(target + y * pitch);
+            for (int x = x0; x < x1; x += 4)
+            {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+                __m128 inside = _mm_cmplt_ps(px, limit);
+                for (int i = 0; i < 3; ++i)
+                {
+                    const __m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], px), rowEdge[i]);
+                    inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e, zero),
+                                                          _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft[i])));
+                }
+
+                const int mask = _mm_movemask_ps(inside);
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                const __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(planeA[0], px), rowPlane[0]));
+                __m128i pixel = _mm_setzero_si128();
+                for (int c = 0; c < 4; ++c)
+                {
+                    __m128 value = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(planeA[c + 1], px), rowPlane[c + 1]), w);
+                    value = _mm_min_ps(_mm_max_ps(value, zero), maxChannel);
+                    pixel = _mm_or_si128(pixel, _mm_slli_epi32(_mm_cvtps_epi32(value), c * 8));
+                }
+
+                if (mask == 0xF)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), pixel);
+                }
+                else
+                {
+                    alignas(16) uint32_t values[4];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(values), pixel);
+                    for (int lane = 0; lane < 4; ++lane)
+                    {
+                        if (mask & (1 << lane))
+                        {
+                            row[x + lane] = values[lane];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Same as RasterRectSse2 with eight pixels per step and masked stores.
+    RASTER_AVX2_TARGET
+    void RasterRectAvx2(const RasterTriangle& tri, uint8_t* target, size_t pitch, int x0, int y0, int x1, int y1)
+    {
+        const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 maxChannel = _mm256_set1_ps(255.0f);
+        const __m256 limit = _mm256_set1_ps(static_cast<float>(x1));
+
+        __m256 edgeA[3];
+        __m256 topLeft[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edgeA[i] = _mm256_set1_ps(tri.edgeA[i]);
+            topLeft[i] = tri.topLeft[i] ? _mm256_castsi256_ps(_mm256_set1_epi32(-1)) : zero;
+        }
+        __m256 planeA[5];
+        for (int plane = 0; plane < 5; ++plane)
+        {
+            planeA[plane] = _mm256_set1_ps(tri.planeA[plane]);
+        }
+
+        for (int y = y0; y < y1; ++y)
+        {
+            const float py = y + 0.5f;
+            __m256 rowEdge[3];
+            __m256 rowPlane[5];
+            for (int i = 0; i < 3; ++i)
+            {
+                rowEdge[i] = _mm256_set1_ps(tri.edgeB[i] * py + tri.edgeC[i]);
+            }
+            for (int plane = 0; plane < 5; ++plane)
+            {
+                rowPlane[plane] = _mm256_set1_ps(tri.planeB[plane] * py + tri.planeC[plane]);
+            }
+
+            uint32_t* row = reinterpret_cast<uint32_t*>(target + y * pitch);
+            for (int x = x0; x < x1; x += 8)
+            {
+                const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+                __m256 inside = _mm256_cmp_ps(px, limit, _CMP_LT_OQ);
+                for (int i = 0; i < 3; ++i)
+                {
+                    const __m256 e = _mm256_add_ps(_mm256_mul_ps(edgeA[i], px), rowEdge[i]);
+                    inside = _mm256_and_ps(inside, _mm256_or_ps(_mm256_cmp_ps(e, zero, _CMP_GT_OQ),
+                        _mm256_and_ps(_mm256_cmp_ps(e, zero, _CMP_EQ_OQ), topLeft[i])));
+                }
+
+                const int mask = _mm256_movemask_ps(inside);
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                const __m256 w = _mm256_div_ps(one, _mm256_add_ps(_mm256_mul_ps(planeA[0], px), rowPlane[0]));
+                __m256i pixel = _mm256_setzero_si256();
+                for (int c = 0; c < 4; ++c)
+                {
+                    __m256 value = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(planeA[c + 1], px), rowPlane[c + 1]), w);
+                    value = _mm256_min_ps(_mm256_max_ps(value, zero), maxChannel);
+                    pixel = _mm256_or_si256(pixel, _mm256_slli_epi32(_mm256_cvtps_epi32(value), c * 8));
+                }
+
+                if (mask == 0xFF)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), pixel);
+                }
+                else
+                {
+                    _mm256_maskstore_epi32(reinterpret_cast<int*>(row + x), _mm256_castps_si256(inside), pixel);
+                }
+            }
+        }
+    }
+}
+
+SoftRasterizer::SoftRasterizer(JobSystem& jobs)
+    : m_jobs(jobs)
+    , m_isa(Avx2Supported() ? RasterIsa::Avx2 : RasterIsa::Sse2)
+    , m_vertices(nullptr)
+    , m_vertexCount(0)
+    , m_instances(nullptr)
+    , m_instanceCount(0)
+    , m_clearPixel(0)
+    , m_target(nullptr)
+    , m_pitch(0)
+    , m_width(0)
+    , m_height(0)
+    , m_tilesX(0)
+    , m_tilesY(0)
+    , m_chunks(0)
+{
+}
+
+// Out of line: RasterTriangle is only complete in this file.
+SoftRasterizer::~SoftRasterizer() = default;
+
+bool SoftRasterizer::Avx2Supported()
+{
+    static const bool supported = []
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2).
+        __cpuid(info, 1);
+        if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }();
+    return supported;
+}
+
+void SoftRasterizer::SetIsa(RasterIsa isa)
+{
+    m_isa = isa == RasterIsa::Avx2 && !Avx2Supported() ? RasterIsa::Sse2 : isa;
+}
+
+void SoftRasterizer::Draw(const SoftVertex* vertices, int vertexCount, const SoftMatrix* instances, int instanceCount,
+                          const float clearColor[4], uint8_t* rgba, size_t pitch, int width, int height)
+{
+    TRACE_ZONE("SoftRasterizer::Draw");
+    if (!rgba || width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    m_vertices = vertices;
+    m_vertexCount = vertices && instances ? vertexCount - vertexCount % 3 : 0;
+    m_instances = instances;
+    m_instanceCount = m_vertexCount ? std::max(instanceCount, 0) : 0;
+    m_clearPixel = PackColor(clearColor);
+    m_target = rgba;
+    m_pitch = pitch;
+    m_width = width;
+    m_height = height;
+    m_tilesX = (width + kTileSize - 1) >> kTileShift;
+    m_tilesY = (height + kTileSize - 1) >> kTileShift;
+
+    // A few chunks per thread keeps set-up balanced when instances differ in
+    // size; bins stay per chunk so tiles can replay them in submission order.
+    const int triangles = m_vertexCount / 3 * m_instanceCount;
+    m_chunks = std::max(1, std::min(ThreadCount() * 4, triangles / 64));
+    m_triangles.resize(triangles);
+    m_bins.resize(m_chunks);
+
+    Dispatch(m_chunks, [this](int chunk) { SetupChunk(chunk); });
+    Dispatch(m_tilesX * m_tilesY, [this](int tile) { RasterTile(tile); });
+}
+
+void SoftRasterizer::SetupChunk(int chunk)
+{
+    TRACE_ZONE("SetupChunk");
+    std::vector<std::vector<uint32_t>>& bins = m_bins[chunk];
+    bins.resize(m_tilesX * m_tilesY);
+    for (std::vector<uint32_t>& bin : bins)
+    {
+        bin.clear();
+    }
+
+    const int perInstance = m_vertexCount / 3;
+    const int total = perInstance * m_instanceCount;
+    const int first = static_cast<int>(static_cast<int64_t>(total) * chunk / m_chunks);
+    const int last = static_cast<int>(static_cast<int64_t>(total) * (chunk + 1) / m_chunks);
+    for (int index = first; index < last; ++index)
+    {
+        RasterTriangle& tri = m_triangles[index];
+        const SoftVertex* corners = m_vertices + (index % perInstance) * 3;
+        if (!SetupTriangle(corners, m_instances[index / perInstance], m_width, m_height, tri))
+        {
+            continue;
+        }
+
+        for (int ty = tri.minY >> kTileShift; ty <= (tri.maxY - 1) >> kTileShift; ++ty)
+        {
+            for (int tx = tri.minX >> kTileShift; tx <= (tri.maxX - 1) >> kTileShift; ++tx)
+            {
+                bins[ty * m_tilesX + tx].push_back(static_cast<uint32_t>(index));
+            }
+        }
+    }
+}
+
+void SoftRasterizer::RasterTile(int tile)
+{
+    const int x0 = (tile % m_tilesX) << kTileShift;
+    const int y0 = (tile / m_tilesX) << kTileShift;
+    const int x1 = std::min(x0 + kTileSize, m_width);
+    const int y1 = std::min(y0 + kTileSize, m_height);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(m_target + y * m_pitch);
+        std::fill(row + x0, row + x1, m_clearPixel);
+    }
+
+    for (int chunk = 0; chunk < m_chunks; ++chunk)
+    {
+        for (uint32_t index : m_bins[chunk][tile])
+        {
+            const RasterTriangle& tri = m_triangles[index];
+            const int left = std::max(x0, tri.minX);
+            const int top = std::max(y0, tri.minY);
+            const int right = std::min(x1, tri.maxX);
+            const int bottom = std::min(y1, tri.maxY);
+            if (m_isa == RasterIsa::Avx2)
+                RasterRectAvx2(tri, m_target, m_pitch, left, top, right, bottom);
+            else
+                RasterRectSse2(tri, m_target, m_pitch, left, top, right, bottom);
+        }
+    }
+}
+
+void SoftRasterizer::Dispatch(int taskCount, const std::function<void(int)>& task)
+{
+    // Ranges of about an eighth of a thread's share: enough for stealing to
+    // even out uneven tiles without a deque operation per tile.
+    const int grain = std::max(1, taskCount / (ThreadCount() * 8));
+    m_jobs.ParallelFor(taskCount, grain, [&](int first, int last)
+    {
+        for (int index = first; index < last; ++index)
+        {
+            task(index);
+        }
+    });
+}
+
+void MakeInstanceGrid(float angle, int count, std::vector<SoftMatrix>& matrices)
+{
+    const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count)))));
+    const float scale = 1.0f / side;
+    const float c = std::cos(angle) * scale;
+    const float s = std::sin(angle) * scale;
+
+    // RotationZ * Scale * Translate(cell centre) in row-vector form.
+    matrices.resize(std::max(count, 0));
+    for (int i = 0; i < count; ++i)
+    {
+        SoftMatrix& matrix = matrices[i];
+        matrix = SoftMatrix{ { { c, s, 0, 0 }, { -s, c, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+        matrix.m[3][0] = -1.0f + (2 * (i % side) + 1) * scale;
+        matrix.m[3][1] = 1.0f - (2 * (i / side) + 1) * scale;
+    }
+}
+
+void RunRasterBenchmark(std::FILE* out)
+{
+    struct FrameSize { int width; int height; };
+    const FrameSize sizes[] = { { 1920, 1080 }, { 3840, 2160 } };
+    const int instanceCounts[] = { 1, 256, 4096, 65536 };
+    const SoftVertex triangle[] =
+    {
+        { {  0.0f,  0.5f, 0.5f }, { 1, 0, 0, 1 } },
+        { {  0.5f, -0.5f, 0.5f }, { 0, 1, 0, 1 } },
+        { { -0.5f, -0.5f, 0.5f }, { 0, 0, 1, 1 } },
+    };
+    const float clearColor[4] = { 0.1f, 0.1f, 0.3f, 1.0f };
+    const int iterations = 10;
+    const int maxThreads = std::max(1, std::min(16, static_cast<int>(std::thread::hardware_concurrency())));
+
+    std::vector<RasterIsa> isas = { RasterIsa::Sse2 };
+    if (SoftRasterizer::Avx2Supported())
+    {
+        isas.push_back(RasterIsa::Avx2);
+    }
+
+    std::fprintf(out, "%-10s %9s %-5s %7s %10s %10s\n", "size", "instances", "isa", "threads", "ms/frame", "Mtri/s");
+    for (const FrameSize& size : sizes)
+    {
+        const size_t pitch = static_cast<size_t>(size.width) * 4;
+        FrameBuffer frame(pitch * size.height);
+        char label[32];
+        std::snprintf(label, sizeof(label), "%dx%d", size.width, size.height);
+
+        for (int instances : instanceCounts)
+        {
+            std::vector<SoftMatrix> matrices;
+            for (RasterIsa isa : isas)
+            {
+                for (int threads = 1; threads <= maxThreads; threads *= 2)
+                {
+                    JobSystem jobs(threads);
+                    SoftRasterizer rasterizer(jobs);
+                    rasterizer.SetIsa(isa);
+
+                    double elapsedMs = 0.0;
+                    for (int i = 0; i <= iterations; ++i)
+                    {
+                        MakeInstanceGrid(0.18f * i, instances, matrices);
+                        const auto start = std::chrono::steady_clock::now();
+                        rasterizer.Draw(triangle, 3, matrices.data(), instances, clearColor,
+                                        frame.Data(), pitch, size.width, size.height);
+                        if (i > 0)
+                        {
+                            elapsedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                        }
+                    }
+
+                    const double msPerFrame = elapsedMs / iterations;
+                    std::fprintf(out, "%-10s %9d %-5s %7d %10.3f %10.2f\n", label, instances,
+                        isa == RasterIsa::Avx2 ? "avx2" : "sse2", threads, msPerFrame,
+                        instances / (msPerFrame * 1e3));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Same layout as SimpleVertex in SharedResource.cpp.
+struct SoftVertex
+{
+    float position[3];
+    float color[4];
+};
+
+// Row-vector convention (v * M), like XMMATRIX before it is transposed for HLSL.
+struct SoftMatrix
+{
+    float m[4][4];
+};
+
+// Set-up triangle (edge functions, attribute planes, bounds); defined in the .cpp.
+struct RasterTriangle;
+
+enum class RasterIsa
+{
+    Sse2,
+    Avx2,
+};
+
+// CPU stand-in for RenderDX: transforms SimpleVertex triangles by a
+// world-view-projection matrix per instance and fills them with Gouraud
+// (perspective-correct) colour into an RGBA8 frame. Triangles are set up and
+// binned into 64x64 tiles in parallel, then worker threads take whole tiles
+// and evaluate edge functions 8 (AVX2) or 4 (SSE2) pixels at a time, so no
+// two threads ever touch the same pixels. Matches the D3D11 defaults the
+// producer uses: back faces (counter-clockwise) culled, top-left fill rule,
+// no depth buffer, later triangles drawn over earlier ones. Triangles with a
+// vertex behind the eye (w <= 0) are dropped rather than clipped. Set-up
+// chunks and tiles run as jobs on the shared JobSystem.
+class SoftRasterizer
+{
+public:
+    explicit SoftRasterizer(JobSystem& jobs);
+    ~SoftRasterizer();
+
+    SoftRasterizer(const SoftRasterizer&) = delete;
+    SoftRasterizer& operator=(const SoftRasterizer&) = delete;
+
+    // AVX2 is used by default when the CPU and OS support it.
+    static bool Avx2Supported();
+    void SetIsa(RasterIsa isa);
+    RasterIsa Isa() const { return m_isa; }
+    int ThreadCount() const { return m_jobs.ThreadCount(); }
+
+    // Clears the frame and draws |vertexCount| / 3 triangles once per instance.
+    void Draw(const SoftVertex* vertices, int vertexCount, const SoftMatrix* instances, int instanceCount,
+              const float clearColor[4], uint8_t* rgba, size_t pitch, int width, int height);
+
+private:
+    void Dispatch(int taskCount, const std::function<void(int)>& task);
+    void SetupChunk(int chunk);
+    void RasterTile(int tile);
+
+    JobSystem& m_jobs;
+    RasterIsa m_isa;
+
+    // Per-draw state shared with the workers.
+    const SoftVertex* m_vertices;
+    int m_vertexCount;
+    const SoftMatrix* m_instances;
+    int m_instanceCount;
+    uint32_t m_clearPixel;
+    uint8_t* m_target;
+    size_t m_pitch;
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    int m_chunks;
+    std::vector<RasterTriangle> m_triangles;
+    std::vector<std::vector<std::vector<uint32_t>>> m_bins;   // [chunk][tile] -> triangles
+};
+
+// Fills |matrices| with |count| copies of the producer's rotating triangle
+// laid out on a square grid; a count of 1 gives the plain full-size scene.
+void MakeInstanceGrid(float angle, int count, std::vector<SoftMatrix>& matrices);
+
+// Times SoftRasterizer across resolutions, instance counts, thread counts
+// and instruction sets and writes ms/frame and triangle rate to |out|.
+void RunRasterBenchmark(std::FILE* out);
@@ -0,0 +1,484 @@
+#include "SrgbConvert.h"
+
+#include "FrameAllocator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    // Rows per job when ConvertSrgb() is given a JobSystem.
+    const int kRowsPerJob = 32;
+
+    // Correctly rounded tables for the integer formats.
+    struct SrgbTables
+    {
+        uint8_t toLinear8[256];
+        uint8_t toSrgb8[256];
+        uint16_t toLinear10[1024];
+        uint16_t toSrgb10[1024];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                toLinear8[i] = static_cast<uint8_t>(std::lround(SrgbToLinear(i / 255.0) * 255.0));
+                toSrgb8[i] = static_cast<uint8_t>(std::lround(LinearToSrgb(i / 255.0) * 255.0));
+            }
+            for (int i = 0; i < 1024; ++i)
+            {
+                toLinear10[i] = static_cast<uint16_t>(std::lround(SrgbToLinear(i / 1023.0) * 1023.0));
+                toSrgb10[i] = static_cast<uint16_t>(std::lround(LinearToSrgb(i / 1023.0) * 1023.0));
+            }
+        }
+    };
+
+    const SrgbTables& Tables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    // Natural log for positive finite x (Cephes logf: mantissa folded into
+    // [sqrt(0.5), sqrt(2)), degree-8 polynomial in m - 1; ~1 float ULP).
+    inline __m128 Log(__m128 x)
+    {
+        const __m128i bits = _mm_castps_si128(x);
+        __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+        __m128 m = _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007FFFFF))),
+                             _mm_castsi128_ps(_mm_set1_epi32(0x3F000000)));
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 below = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+        e = _mm_sub_ps(e, _mm_and_ps(below, one));
+        m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(below, m));
+
+        const __m128 z = _mm_mul_ps(m, m);
+        __m128 y = _mm_set1_ps(7.0376836292e-2f);
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174e-1f));
+        y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+        y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+        y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+    }
+
+    // e^x (Cephes expf: x = n ln2 + r, degree-5 polynomial in r; ~1 float ULP).
+    inline __m128 Exp(__m128 x)
+    {
+        x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+        x = _mm_max_ps(x, _mm_set1_ps(-87.3365447505531f));
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 n = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+        const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(n));
+        n = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, n), one));
+
+        x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+
+        const __m128 z = _mm_mul_ps(x, x);
+        __m128 y = _mm_set1_ps(1.9875691500e-4f);
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+        y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), one);
+
+        const __m128i scale = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+        return _mm_mul_ps(y, _mm_castsi128_ps(scale));
+    }
+
+    // Four halves (zero-extended in 32-bit lanes) to floats, exact including
+    // denormals, Inf and NaN.
+    inline __m128 HalfToFloat(__m128i h)
+    {
+        const __m128i shiftedExp = _mm_set1_epi32(0x7C00 << 13);
+        __m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7FFF)), 13);
+        const __m128i exponent = _mm_and_si128(o, shiftedExp);
+        o = _mm_add_epi32(o, _mm_set1_epi32((127 - 15) << 23));
+
+        const __m128i infNan = _mm_cmpeq_epi32(exponent, shiftedExp);
+        o = _mm_add_epi32(o, _mm_and_si128(infNan, _mm_set1_epi32((128 - 16) << 23)));
+
+        const __m128i denormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+        const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+        const __m128 renormalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), magic);
+        o = Select(denormal, _mm_castps_si128(renormalized), o);
+
+        return _mm_castsi128_ps(_mm_or_si128(o, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+    }
+
+    // Floats to halves in 32-bit lanes, round to nearest even; overflow gives
+    // Inf and NaN stays NaN.
+    inline __m128i FloatToHalf(__m128 f)
+    {
+        __m128i bits = _mm_castps_si128(f);
+        const __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(static_cast<int>(0x80000000u)));
+        bits = _mm_xor_si128(bits, sign);
+
+        const __m128i overflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+        const __m128i nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(255 << 23));
+        const __m128i large = Select(nan, _mm_set1_epi32(0x7E00), _mm_set1_epi32(0x7C00));
+
+        const __m128i small = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+        const __m128 denormMagic = _mm_castsi128_ps(_mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23));
+        const __m128i denormal = _mm_sub_epi32(
+            _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), denormMagic)), _mm_castps_si128(denormMagic));
+
+        const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23)));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+        const __m128i half = Select(overflow, large, Select(small, denormal, normal));
+        return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+    }
+
+    // One RGBA pixel, all four channels; ConvertRowsHalf restores alpha and
+    // non-finite inputs bit for bit.
+    inline __m128 ConvertPixel(__m128 x, bool toSrgb)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+        const __m128 a = _mm_andnot_ps(signMask, x);
+
+        __m128 result;
+        if (toSrgb)
+        {
+            const __m128 curve = _mm_sub_ps(
+                _mm_mul_ps(Exp(_mm_mul_ps(Log(a), _mm_set1_ps(1.0f / 2.4f))), _mm_set1_ps(1.055f)),
+                _mm_set1_ps(0.055f));
+            result = Select(_mm_cmple_ps(a, _mm_set1_ps(0.0031308f)), _mm_mul_ps(a, _mm_set1_ps(12.92f)), curve);
+        }
+        else
+        {
+            const __m128 base = _mm_mul_ps(_mm_add_ps(a, _mm_set1_ps(0.055f)), _mm_set1_ps(1.0f / 1.055f));
+            const __m128 curve = Exp(_mm_mul_ps(Log(base), _mm_set1_ps(2.4f)));
+            result = Select(_mm_cmple_ps(a, _mm_set1_ps(0.04045f)), _mm_mul_ps(a, _mm_set1_ps(1.0f / 12.92f)), curve);
+        }
+        return _mm_or_ps(result, _mm_and_ps(x, signMask));
+    }
+
+    // Eight halves in 32-bit lanes back to 16 bits without signed saturation.
+    inline __m128i PackHalves(__m128i lo, __m128i hi)
+    {
+        lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+        hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+        return _mm_packs_epi32(lo, hi);
+    }
+
+    void ConvertRows8(const uint8_t* lut, const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch,
+                      int width, int height)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t* in = src + y * srcPitch;
+            uint8_t* out = dst + y * dstPitch;
+            for (int x = 0; x < width; ++x, in += 4, out += 4)
+            {
+                const uint8_t alpha = in[3];
+                out[0] = lut[in[0]];
+                out[1] = lut[in[1]];
+                out[2] = lut[in[2]];
+                out[3] = alpha;
+            }
+        }
+    }
+
+    void ConvertRows10(const uint16_t* lut, const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch,
+                       int width, int height)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t* in = src + y * srcPitch;
+            uint8_t* out = dst + y * dstPitch;
+            for (int x = 0; x < width; ++x, in += 4, out += 4)
+            {
+                uint32_t pixel;
+                std::memcpy(&pixel, in, 4);
+                pixel = (pixel & 0xC0000000u) |
+                        static_cast<uint32_t>(lut[pixel & 0x3FF]) |
+                        static_cast<uint32_t>(lut[(pixel >> 10) & 0x3FF]) << 10 |
+                        static_cast<uint32_t>(lut[(pixel >> 20) & 0x3FF]) << 20;
+                std::memcpy(out, &pixel, 4);
+            }
+        }
+    }
+
+    void ConvertRowsHalf(bool toSrgb, const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch,
+                         int width, int height)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i exponent = _mm_set1_epi16(0x7C00);
+        const __m128i alpha = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t* in = src + y * srcPitch;
+            uint8_t* out = dst + y * dstPitch;
+            int x = 0;
+            for (; x + 2 <= width; x += 2)
+            {
+                const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * 8));
+                const __m128 first = ConvertPixel(HalfToFloat(_mm_unpacklo_epi16(halves, zero)), toSrgb);
+                const __m128 second = ConvertPixel(HalfToFloat(_mm_unpackhi_epi16(halves, zero)), toSrgb);
+                const __m128i keep = _mm_or_si128(alpha, _mm_cmpeq_epi16(_mm_and_si128(halves, exponent), exponent));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 8),
+                                 Select(keep, halves, PackHalves(FloatToHalf(first), FloatToHalf(second))));
+            }
+            if (x < width)
+            {
+                const __m128i halves = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + x * 8));
+                const __m128 pixel = ConvertPixel(HalfToFloat(_mm_unpacklo_epi16(halves, zero)), toSrgb);
+                const __m128i keep = _mm_or_si128(alpha, _mm_cmpeq_epi16(_mm_and_si128(halves, exponent), exponent));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 8),
+                                 Select(keep, halves, PackHalves(FloatToHalf(pixel), zero)));
+            }
+        }
+    }
+
+    double HalfValue(uint16_t half)
+    {
+        const int exponent = (half >> 10) & 0x1F;
+        const int mantissa = half & 0x3FF;
+        const double magnitude = exponent == 0
+            ? std::ldexp(mantissa, -24)
+            : std::ldexp(1024 + mantissa, exponent - 25);
+        return (half & 0x8000) ? -magnitude : magnitude;
+    }
+
+    // Spacing of halves around |value| (denormal spacing below 2^-14).
+    double HalfUlp(double value)
+    {
+        const double magnitude = std::fabs(value);
+        if (magnitude < std::ldexp(1.0, -14))
+        {
+            return std::ldexp(1.0, -24);
+        }
+        int exponent = 0;
+        std::frexp(magnitude, &exponent);
+        return std::ldexp(1.0, exponent - 11);
+    }
+}
+
+const char* SrgbConversionName(SrgbConversion conversion)
+{
+    switch (conversion)
+    {
+    case SrgbConversion::ToLinear: return "to-linear";
+    case SrgbConversion::ToSrgb:   return "to-srgb";
+    default:                       return "none";
+    }
+}
+
+double SrgbToLinear(double value)
+{
+    const double magnitude = std::fabs(value);
+    const double linear = magnitude <= 0.04045 ? magnitude / 12.92 : std::pow((magnitude + 0.055) / 1.055, 2.4);
+    return value < 0.0 ? -linear : linear;
+}
+
+double LinearToSrgb(double value)
+{
+    const double magnitude = std::fabs(value);
+    const double encoded = magnitude <= 0.0031308 ? magnitude * 12.92 : 1.055 * std::pow(magnitude, 1.0 / 2.4) - 0.055;
+    return value < 0.0 ? -encoded : encoded;
+}
+
+bool ConvertSrgb(SrgbConversion conversion, FrameFormat format, const uint8_t* src, size_t srcPitch,
+                 uint8_t* dst, size_t dstPitch, int width, int height, JobSystem* jobs)
+{
+    if (IsYuvFormat(format) || !src || !dst || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    if (conversion == SrgbConversion::None && src == dst)
+    {
+        return true;
+    }
+
+    const bool toSrgb = conversion == SrgbConversion::ToSrgb;
+    auto convertRows = [&](int first, int last)
+    {
+        const uint8_t* from = src + first * srcPitch;
+        uint8_t* to = dst + first * dstPitch;
+        const int rows = last - first;
+        if (conversion == SrgbConversion::None)
+        {
+            const size_t rowBytes = static_cast<size_t>(width) * FramePixelBytes(format);
+            for (int y = 0; y < rows; ++y)
+            {
+                std::memcpy(to + y * dstPitch, from + y * srcPitch, rowBytes);
+            }
+            return;
+        }
+
+        switch (format)
+        {
+        case FrameFormat::Rgb10A2:
+            ConvertRows10(toSrgb ? Tables().toSrgb10 : Tables().toLinear10, from, srcPitch, to, dstPitch, width, rows);
+            break;
+        case FrameFormat::Rgba16F:
+            ConvertRowsHalf(toSrgb, from, srcPitch, to, dstPitch, width, rows);
+            break;
+        default:
+            ConvertRows8(toSrgb ? Tables().toSrgb8 : Tables().toLinear8, from, srcPitch, to, dstPitch, width, rows);
+            break;
+        }
+    };
+
+    if (!jobs)
+    {
+        convertRows(0, height);
+        return true;
+    }
+    jobs->ParallelFor(height, kRowsPerJob, convertRows);
+    return true;
+}
+
+void RunSrgbBenchmark(std::FILE* out)
+{
+    const FrameFormat formats[] = { FrameFormat::Rgba8, FrameFormat::Rgb10A2, FrameFormat::Rgba16F };
+    const SrgbConversion conversions[] = { SrgbConversion::ToLinear, SrgbConversion::ToSrgb };
+    const int width = 1920;
+    const int height = 1080;
+    const int iterations = 10;
+
+    std::fprintf(out, "%-8s %-10s %9s %10s %10s %9s %9s\n",
+        "format", "direction", "inputs", "max error", "unit", "ms", "MP/s");
+    for (FrameFormat format : formats)
+    {
+        // Every representable channel value, one per pixel, in all three colour
+        // channels; alpha carries the same value so changes to it are caught.
+        const int inputs = format == FrameFormat::Rgba16F ? 65536 : (format == FrameFormat::Rgb10A2 ? 1024 : 256);
+        const int pixelBytes = FramePixelBytes(format);
+        FrameBuffer source(static_cast<size_t>(inputs) * pixelBytes);
+        FrameBuffer converted(source.Size());
+        for (int i = 0; i < inputs; ++i)
+        {
+            uint8_t* pixel = source.Data() + static_cast<size_t>(i) * pixelBytes;
+            if (format == FrameFormat::Rgba16F)
+            {
+                const uint16_t half[4] = { static_cast<uint16_t>(i), static_cast<uint16_t>(i),
+                                           static_cast<uint16_t>(i), static_cast<uint16_t>(i) };
+                std::memcpy(pixel, half, sizeof(half));
+            }
+            else if (format == FrameFormat::Rgb10A2)
+            {
+                const uint32_t packed = static_cast<uint32_t>(i) * 0x100401u | static_cast<uint32_t>(i & 3) << 30;
+                std::memcpy(pixel, &packed, 4);
+            }
+            else
+            {
+                std::memset(pixel, i, 4);
+            }
+        }
+
+        // The timed frame holds ordinary content: half floats in 0..1 rather
+        // than the denormals and NaNs of the exhaustive set, which would
+        // measure the CPU's slow paths instead of the kernel.
+        FrameBuffer frame(static_cast<size_t>(width) * pixelBytes * height);
+        for (size_t i = 0; i < frame.Size(); ++i)
+        {
+            frame.Data()[i] = source.Data()[i % source.Size()];
+        }
+        if (format == FrameFormat::Rgba16F)
+        {
+            uint16_t* halves = reinterpret_cast<uint16_t*>(frame.Data());
+            for (size_t i = 0; i < frame.Size() / 2; ++i)
+            {
+                halves[i] = static_cast<uint16_t>(i * 2654435761u % 0x3C01);
+            }
+        }
+
+        for (SrgbConversion conversion : conversions)
+        {
+            ConvertSrgb(conversion, format, source.Data(), source.Size(), converted.Data(), converted.Size(), inputs, 1);
+
+            double maxError = 0.0;
+            bool untouchedOk = true;
+            for (int i = 0; i < inputs; ++i)
+            {
+                const uint8_t* before = source.Data() + static_cast<size_t>(i) * pixelBytes;
+                const uint8_t* after = converted.Data() + static_cast<size_t>(i) * pixelBytes;
+                double value = 0.0;
+                double exact = 0.0;
+                double unit = 1.0;
+                if (format == FrameFormat::Rgba16F)
+                {
+                    uint16_t in[4];
+                    uint16_t result[4];
+                    std::memcpy(in, before, sizeof(in));
+                    std::memcpy(result, after, sizeof(result));
+                    untouchedOk = untouchedOk && result[3] == in[3];
+                    if ((in[0] & 0x7C00) == 0x7C00)
+                    {
+                        untouchedOk = untouchedOk && result[0] == in[0];
+                        continue;
+                    }
+                    const double input = HalfValue(in[0]);
+                    exact = conversion == SrgbConversion::ToSrgb ? LinearToSrgb(input) : SrgbToLinear(input);
+                    if (std::fabs(exact) >= 65520.0)
+                    {
+                        untouchedOk = untouchedOk && (result[0] & 0x7FFF) == 0x7C00;
+                        continue;
+                    }
+                    value = HalfValue(result[0]);
+                    unit = HalfUlp(exact);
+                }
+                else if (format == FrameFormat::Rgb10A2)
+                {
+                    uint32_t in;
+                    uint32_t result;
+                    std::memcpy(&in, before, 4);
+                    std::memcpy(&result, after, 4);
+                    untouchedOk = untouchedOk && (result >> 30) == (in >> 30);
+                    const double input = (in & 0x3FF) / 1023.0;
+                    exact = (conversion == SrgbConversion::ToSrgb ? LinearToSrgb(input) : SrgbToLinear(input)) * 1023.0;
+                    value = result & 0x3FF;
+                }
+                else
+                {
+                    untouchedOk = untouchedOk && after[3] == before[3];
+                    const double input = before[0] / 255.0;
+                    exact = (conversion == SrgbConversion::ToSrgb ? LinearToSrgb(input) : SrgbToLinear(input)) * 255.0;
+                    value = after[0];
+                }
+                const double error = std::fabs(value - exact) / unit;
+                maxError = error > maxError ? error : maxError;
+            }
+
+            const size_t pitch = static_cast<size_t>(width) * pixelBytes;
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                ConvertSrgb(conversion, format, frame.Data(), pitch, frame.Data(), pitch, width, height);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+            std::fprintf(out, "%-8s %-10s %9d %10.4f %10s %9.3f %9.1f%s\n", FrameFormatName(format),
+                SrgbConversionName(conversion), inputs, maxError,
+                format == FrameFormat::Rgba16F ? "half ULP" : "LSB", ms, width * height / (ms * 1e3),
+                untouchedOk ? "" : "  ALPHA/SPECIAL MISMATCH");
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "VideoFrame.h"
+#include "JobSystem.h"
+
+enum class SrgbConversion
+{
+    None,
+    ToLinear,   // sRGB-encoded values -> linear light
+    ToSrgb,     // linear light -> sRGB-encoded values
+};
+
+const char* SrgbConversionName(SrgbConversion conversion);
+
+// Applies the sRGB transfer function (IEC 61966-2-1, with its linear toe) to
+// the colour channels of a packed frame; alpha is copied unchanged. |src| and
+// |dst| may be the same buffer for an in-place stage. Error bounds against the
+// exact curve:
+//   Rgba8 / Bgra8  256-entry table, correctly rounded (<= 0.5 LSB)
+//   Rgb10A2        1024-entry table, correctly rounded (<= 0.5 LSB)
+//   Rgba16F        SSE2 log/exp polynomials in float, <= 1 half ULP; the curve
+//                  is mirrored for negative values (scRGB) and Inf/NaN pass
+//                  through
+// RunSrgbBenchmark() re-checks these bounds over every representable input.
+// With |jobs| the rows are split across the job system. Returns false for
+// YUV formats.
+bool ConvertSrgb(SrgbConversion conversion, FrameFormat format, const uint8_t* src, size_t srcPitch,
+                 uint8_t* dst, size_t dstPitch, int width, int height, JobSystem* jobs = nullptr);
+
+// Exact transfer functions in double precision (the reference for the bounds).
+double SrgbToLinear(double value);
+double LinearToSrgb(double value);
+
+// Writes, per format and direction, the exhaustively measured maximum error
+// and the conversion rate on a 1920x1080 frame to |out|.
+void RunSrgbBenchmark(std::FILE* out);
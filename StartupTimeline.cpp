@@ -0,0 +1,113 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+
+#include "FrameLatency.h"
+
+StartupTimeline::StartupTimeline()
+    : m_startNs(0)
+    , m_firstFrameNs(0)
+{
+}
+
+void StartupTimeline::Start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.clear();
+    m_lanes.assign(1, std::this_thread::get_id());
+    m_startNs = FrameClockNs();
+    m_firstFrameNs = 0;
+}
+
+int StartupTimeline::LaneOf(std::thread::id thread)
+{
+    for (size_t i = 0; i < m_lanes.size(); ++i)
+    {
+        if (m_lanes[i] == thread)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    m_lanes.push_back(thread);
+    return static_cast<int>(m_lanes.size() - 1);
+}
+
+void StartupTimeline::Record(const char* phase, uint64_t beginNs, uint64_t endNs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back({ phase, LaneOf(std::this_thread::get_id()), beginNs, endNs });
+}
+
+void StartupTimeline::MarkFirstFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_firstFrameNs == 0)
+    {
+        m_firstFrameNs = FrameClockNs();
+    }
+}
+
+bool StartupTimeline::Finished() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstFrameNs != 0;
+}
+
+uint64_t StartupTimeline::FirstFrameNs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstFrameNs ? m_firstFrameNs - m_startNs : 0;
+}
+
+void StartupTimeline::Write(std::FILE* out, const char* mode) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Phase> phases = m_phases;
+    std::stable_sort(phases.begin(), phases.end(),
+        [](const Phase& a, const Phase& b) { return a.beginNs < b.beginNs; });
+
+    const int barWidth = 40;
+    uint64_t endNs = m_firstFrameNs;
+    for (const Phase& phase : phases)
+    {
+        endNs = std::max(endNs, phase.endNs);
+    }
+    const double span = endNs > m_startNs ? static_cast<double>(endNs - m_startNs) : 1.0;
+
+    std::fprintf(out, "startup timeline (%s), ms since WinMain\n", mode);
+    std::fprintf(out, "%-28s %4s %9s %9s %9s\n", "phase", "lane", "begin", "end", "duration");
+    for (const Phase& phase : phases)
+    {
+        const double begin = (phase.beginNs - m_startNs) / 1e6;
+        const double end = (phase.endNs - m_startNs) / 1e6;
+
+        char bar[barWidth + 1];
+        const int first = static_cast<int>((phase.beginNs - m_startNs) / span * barWidth);
+        const int last = std::max(first + 1, static_cast<int>((phase.endNs - m_startNs) / span * barWidth + 0.5));
+        for (int i = 0; i < barWidth; ++i)
+        {
+            bar[i] = i >= first && i < last ? '#' : '.';
+        }
+        bar[barWidth] = '\0';
+
+        std::fprintf(out, "%-28s %4d %9.2f %9.2f %9.2f |%s|\n", phase.name, phase.lane, begin, end, end - begin, bar);
+    }
+
+    if (m_firstFrameNs)
+    {
+        std::fprintf(out, "time to first frame: %.2f ms\n", (m_firstFrameNs - m_startNs) / 1e6);
+    }
+}
+
+StartupPhase::StartupPhase(StartupTimeline& timeline, const char* name)
+    : m_timeline(timeline)
+    , m_name(name)
+    , m_beginNs(FrameClockNs())
+    , m_zone(name)
+{
+}
+
+StartupPhase::~StartupPhase()
+{
+    m_timeline.Record(m_name, m_beginNs, FrameClockNs());
+}
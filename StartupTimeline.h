@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameTrace.h"
+
+// Wall-clock phases of application startup, recorded from whichever thread
+// runs them and written as a timeline relative to Start(). Each thread gets
+// its own lane (0 is the thread that called Start()), so overlap between the
+// D3D11, shader and GL tasks is visible at a glance. Phases are few and
+// recorded once, so recording takes a lock.
+class StartupTimeline
+{
+public:
+    StartupTimeline();
+
+    void Start();
+    void Record(const char* phase, uint64_t beginNs, uint64_t endNs);
+    // End of startup: the first frame has been presented.
+    void MarkFirstFrame();
+
+    bool Finished() const;
+    // Time to first frame in ns since Start(), 0 until MarkFirstFrame().
+    uint64_t FirstFrameNs() const;
+
+    // Phases in start order with lane, begin, end and duration in ms and a
+    // bar scaled to the time to first frame.
+    void Write(std::FILE* out, const char* mode) const;
+
+private:
+    struct Phase
+    {
+        const char* name;
+        int lane;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+
+    int LaneOf(std::thread::id thread);
+
+    mutable std::mutex m_mutex;
+    std::vector<Phase> m_phases;
+    std::vector<std::thread::id> m_lanes;
+    uint64_t m_startNs;
+    uint64_t m_firstFrameNs;
+};
+
+// Records the enclosing scope as a phase; also a trace zone when tracing is
+// on, so startup lines up with the first frames in the Chrome trace.
+class StartupPhase
+{
+public:
+    StartupPhase(StartupTimeline& timeline, const char* name);
+    ~StartupPhase();
+
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+    StartupTimeline& m_timeline;
+    const char* m_name;
+    uint64_t m_beginNs;
+    TraceZone m_zone;
+};
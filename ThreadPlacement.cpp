@@ -0,0 +1,415 @@
+#include "ThreadPlacement.h"
+
+#include "FrameAllocator.h"
+#include "FrameCopy.h"
+#include "FrameHistogram.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int kMaxCpus = 4096;
+
+#ifdef _WIN32
+    int LogicalCpuCount()
+    {
+        return static_cast<int>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    }
+
+    // Global CPU number -> processor group and index within it.
+    bool CpuToGroup(int cpu, WORD& group, BYTE& number)
+    {
+        const WORD groups = GetActiveProcessorGroupCount();
+        for (WORD g = 0; g < groups; ++g)
+        {
+            const int count = static_cast<int>(GetActiveProcessorCount(g));
+            if (cpu < count)
+            {
+                group = g;
+                number = static_cast<BYTE>(cpu);
+                return true;
+            }
+            cpu -= count;
+        }
+        return false;
+    }
+
+    bool SetAffinity(const std::vector<int>& cpus)
+    {
+        GROUP_AFFINITY affinity{};
+        BYTE number = 0;
+        if (!CpuToGroup(cpus.front(), affinity.Group, number))
+        {
+            return false;
+        }
+        for (int cpu : cpus)
+        {
+            WORD group = 0;
+            if (CpuToGroup(cpu, group, number) && group == affinity.Group)
+            {
+                affinity.Mask |= static_cast<KAFFINITY>(1) << number;
+            }
+        }
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+    }
+
+    // Thread priorities within the process' priority class need no privilege;
+    // REALTIME_PRIORITY_CLASS would, and would also starve input and the DWM.
+    ThreadPriority SetPriority(ThreadPriority priority)
+    {
+        if (priority == ThreadPriority::Realtime)
+        {
+            if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+            {
+                return ThreadPriority::Realtime;
+            }
+            priority = ThreadPriority::High;
+        }
+
+        if (priority == ThreadPriority::High && SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST))
+        {
+            return ThreadPriority::High;
+        }
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+        return ThreadPriority::Normal;
+    }
+#else
+    int LogicalCpuCount()
+    {
+        const long count = sysconf(_SC_NPROCESSORS_CONF);
+        return count > 0 ? static_cast<int>(count) : 1;
+    }
+
+    bool SetAffinity(const std::vector<int>& cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    ThreadPriority SetPriority(ThreadPriority priority)
+    {
+        const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (priority == ThreadPriority::Realtime)
+        {
+            // Low FIFO priority: above every normal thread, below the kernel's
+            // own real-time threads.
+            sched_param param{};
+            param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 9;
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+            {
+                return ThreadPriority::Realtime;
+            }
+            priority = ThreadPriority::High;
+        }
+        else
+        {
+            sched_param param{};
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        }
+
+        if (priority == ThreadPriority::High && setpriority(PRIO_PROCESS, tid, -10) == 0)
+        {
+            return ThreadPriority::High;
+        }
+        setpriority(PRIO_PROCESS, tid, 0);
+        return ThreadPriority::Normal;
+    }
+
+    bool PathExists(const char* path)
+    {
+        return access(path, F_OK) == 0;
+    }
+#endif
+}
+
+const char* ThreadRoleName(ThreadRole role)
+{
+    switch (role)
+    {
+    case ThreadRole::Worker: return "worker";
+    default:                 return "render";
+    }
+}
+
+const char* ThreadPriorityName(ThreadPriority priority)
+{
+    switch (priority)
+    {
+    case ThreadPriority::High:     return "high";
+    case ThreadPriority::Realtime: return "realtime";
+    default:                       return "normal";
+    }
+}
+
+bool ParseThreadRole(const std::string& name, ThreadRole& role)
+{
+    if (name == "render")
+        role = ThreadRole::Render;
+    else if (name == "worker")
+        role = ThreadRole::Worker;
+    else
+        return false;
+    return true;
+}
+
+bool ParseThreadPriority(const std::string& name, ThreadPriority& priority)
+{
+    if (name == "normal")
+        priority = ThreadPriority::Normal;
+    else if (name == "high")
+        priority = ThreadPriority::High;
+    else if (name == "realtime")
+        priority = ThreadPriority::Realtime;
+    else
+        return false;
+    return true;
+}
+
+bool ParseCpuList(const std::string& text, std::vector<int>& cpus)
+{
+    std::vector<int> parsed;
+    size_t begin = 0;
+    while (begin <= text.size())
+    {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        const std::string range = text.substr(begin, end - begin);
+        const size_t dash = range.find('-');
+        char* tail = nullptr;
+        const long first = std::strtol(range.c_str(), &tail, 10);
+        if (tail == range.c_str() || (dash == std::string::npos ? *tail != '\0' : tail != range.c_str() + dash))
+        {
+            return false;
+        }
+        long last = first;
+        if (dash != std::string::npos)
+        {
+            const char* lastText = range.c_str() + dash + 1;
+            last = std::strtol(lastText, &tail, 10);
+            if (tail == lastText || *tail != '\0')
+            {
+                return false;
+            }
+        }
+        if (first < 0 || last < first || last >= kMaxCpus)
+        {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu)
+        {
+            parsed.push_back(static_cast<int>(cpu));
+        }
+        begin = end + 1;
+    }
+
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    cpus.swap(parsed);
+    return true;
+}
+
+PlacementResult ApplyThreadPlacement(const ThreadPlacement& placement)
+{
+    PlacementResult result{};
+    result.pinned = !placement.cpus.empty() && SetAffinity(placement.cpus);
+    result.priority = SetPriority(placement.priority);
+    return result;
+}
+
+#ifdef _WIN32
+int NumaNodeCount()
+{
+    ULONG highest = 0;
+    return GetNumaHighestNodeNumber(&highest) ? static_cast<int>(highest) + 1 : 1;
+}
+
+int NumaNodeOfCpu(int cpu)
+{
+    PROCESSOR_NUMBER processor{};
+    if (!CpuToGroup(cpu, processor.Group, processor.Number))
+    {
+        return 0;
+    }
+    USHORT node = 0;
+    return GetNumaProcessorNodeEx(&processor, &node) ? node : 0;
+}
+
+int CurrentNumaNode()
+{
+    PROCESSOR_NUMBER processor{};
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    return GetNumaProcessorNodeEx(&processor, &node) ? node : 0;
+}
+#else
+int NumaNodeCount()
+{
+    int count = 0;
+    char path[64];
+    for (;;)
+    {
+        std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", count);
+        if (!PathExists(path))
+        {
+            break;
+        }
+        ++count;
+    }
+    return count > 0 ? count : 1;
+}
+
+int NumaNodeOfCpu(int cpu)
+{
+    char path[96];
+    const int nodes = NumaNodeCount();
+    for (int node = 0; node < nodes; ++node)
+    {
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+        if (PathExists(path))
+        {
+            return node;
+        }
+    }
+    return 0;
+}
+
+int CurrentNumaNode()
+{
+    const int cpu = sched_getcpu();
+    return cpu >= 0 ? NumaNodeOfCpu(cpu) : 0;
+}
+#endif
+
+std::vector<int> NumaNodeCpus(int node)
+{
+    std::vector<int> cpus;
+    const int count = LogicalCpuCount();
+    for (int cpu = 0; cpu < count; ++cpu)
+    {
+        if (NumaNodeOfCpu(cpu) == node)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void RunPlacementBenchmark(std::FILE* out)
+{
+    struct Case
+    {
+        const char* name;
+        ThreadPlacement render;
+        ThreadPlacement workers;
+        int bufferNode;
+    };
+
+    // The render thread takes the first CPU of its node, the job workers the
+    // rest of theirs.
+    const int nodes = NumaNodeCount();
+    const std::vector<int> node0 = NumaNodeCpus(0);
+    const std::vector<int> node1 = nodes > 1 ? NumaNodeCpus(1) : std::vector<int>();
+    auto renderOn = [](const std::vector<int>& cpus, ThreadPriority priority)
+    {
+        ThreadPlacement placement;
+        if (!cpus.empty())
+        {
+            placement.cpus.push_back(cpus.front());
+        }
+        placement.priority = priority;
+        return placement;
+    };
+    auto workersOn = [](const std::vector<int>& cpus, bool skipFirst)
+    {
+        ThreadPlacement placement;
+        placement.cpus.assign(cpus.begin() + (skipFirst && cpus.size() > 1 ? 1 : 0), cpus.end());
+        return placement;
+    };
+
+    std::vector<Case> cases;
+    cases.push_back({ "unpinned", ThreadPlacement(), ThreadPlacement(), kNumaNodeAny });
+    cases.push_back({ "node0", renderOn(node0, ThreadPriority::Normal), workersOn(node0, true), 0 });
+    cases.push_back({ "node0 high", renderOn(node0, ThreadPriority::High), workersOn(node0, true), 0 });
+    cases.push_back({ "node0 realtime", renderOn(node0, ThreadPriority::Realtime), workersOn(node0, true), 0 });
+    if (!node1.empty())
+    {
+        cases.push_back({ "node0, buffers node1", renderOn(node0, ThreadPriority::Normal), workersOn(node0, true), 1 });
+        cases.push_back({ "workers on node1", renderOn(node0, ThreadPriority::Normal), workersOn(node1, false), 0 });
+    }
+
+    const int width = 3840;
+    const int height = 2160;
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    const int frames = 120;
+    const int workerThreads = 4;
+
+    std::fprintf(out, "%d NUMA node(s), %d logical CPUs; %d frames of a %dx%d rgba8 copy, %d job threads\n",
+                 nodes, LogicalCpuCount(), frames, width, height, workerThreads);
+    std::fprintf(out, "%-22s %-9s %-8s %9s %9s %9s %9s\n",
+                 "placement", "priority", "pinned", "GB/s", "p50 ms", "p99 ms", "max-p50");
+
+    FrameAllocator& allocator = GetFrameAllocator();
+    for (const Case& c : cases)
+    {
+        // Each case runs on a fresh thread standing in for the render thread,
+        // so placements never leak from one case into the next.
+        PlacementResult placed{};
+        FrameHistogram frameNs;
+        std::thread runner([&]
+        {
+            placed = ApplyThreadPlacement(c.render);
+            allocator.Trim();
+            allocator.SetNumaNode(c.bufferNode);
+            {
+                FrameBuffer src(pitch * height);
+                FrameBuffer dst(pitch * height);
+                memset(src.Data(), 0x5A, src.Size());
+                JobSystem jobs(workerThreads, c.workers);
+                FrameCopyEngine engine(jobs);
+                engine.Copy(dst.Data(), pitch, src.Data(), pitch, pitch, height);
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    engine.Copy(dst.Data(), pitch, src.Data(), pitch, pitch, height);
+                    frameNs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count()));
+                }
+            }
+            allocator.SetNumaNode(kNumaNodeAny);
+            allocator.Trim();
+        });
+        runner.join();
+
+        const double p50 = frameNs.ValueAtQuantile(0.5) / 1e6;
+        std::fprintf(out, "%-22s %-9s %-8s %9.2f %9.3f %9.3f %9.3f\n",
+                     c.name, ThreadPriorityName(placed.priority), placed.pinned ? "yes" : "no",
+                     static_cast<double>(pitch) * height / frameNs.MeanNs(),
+                     p50, frameNs.ValueAtQuantile(0.99) / 1e6, frameNs.MaxNs() / 1e6 - p50);
+    }
+}
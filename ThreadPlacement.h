@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Pipeline threads that can be placed independently. Render is the main
+// thread (producer, transfer and consumer); Worker is every JobSystem worker.
+enum class ThreadRole
+{
+    Render,
+    Worker,
+    Count,
+};
+
+enum class ThreadPriority
+{
+    Normal,
+    High,       // THREAD_PRIORITY_HIGHEST / nice -10
+    Realtime,   // THREAD_PRIORITY_TIME_CRITICAL / SCHED_FIFO where permitted
+};
+
+const char* ThreadRoleName(ThreadRole role);
+const char* ThreadPriorityName(ThreadPriority priority);
+bool ParseThreadRole(const std::string& name, ThreadRole& role);
+bool ParseThreadPriority(const std::string& name, ThreadPriority& priority);
+
+// "0-3,8,10-11" -> { 0, 1, 2, 3, 8, 10, 11 }. CPU numbers are logical
+// processors counted across all Windows processor groups.
+bool ParseCpuList(const std::string& text, std::vector<int>& cpus);
+
+struct ThreadPlacement
+{
+    std::vector<int> cpus;  // empty: any CPU
+    ThreadPriority priority = ThreadPriority::Normal;
+};
+
+// What ApplyThreadPlacement() got from the OS. Realtime without the needed
+// privilege (CAP_SYS_NICE or an rtprio limit on Linux) falls back to High,
+// and High to Normal.
+struct PlacementResult
+{
+    bool pinned;
+    ThreadPriority priority;
+};
+
+// Applies |placement| to the calling thread. A CPU list that spans Windows
+// processor groups is trimmed to the group of its first CPU.
+PlacementResult ApplyThreadPlacement(const ThreadPlacement& placement);
+
+// NUMA topology; every function returns node 0 on a machine without NUMA.
+const int kNumaNodeAny = -1;    // let the OS place pages (first touch)
+const int kNumaNodeLocal = -2;  // the node of the render thread
+int NumaNodeCount();
+int NumaNodeOfCpu(int cpu);
+int CurrentNumaNode();
+// Logical CPUs of |node|, in ascending order.
+std::vector<int> NumaNodeCpus(int node);
+
+// For each placement of the render thread, the job workers and the frame
+// buffers (unpinned, one node, split across nodes, and each priority),
+// writes copy bandwidth and the jitter of a fixed per-frame workload (p50,
+// p99, max minus p50) to |out|.
+void RunPlacementBenchmark(std::FILE* out);
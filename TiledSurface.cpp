@@ -0,0 +1,169 @@
+#include "TiledSurface.h"
+
+#include <algorithm>
+#include <cmath>
+
+TiledSurface::TiledSurface()
+    : m_canvasWidth(0)
+    , m_canvasHeight(0)
+    , m_columns(0)
+    , m_rows(0)
+    , m_frames(0)
+{
+}
+
+bool TiledSurface::Configure(int canvasWidth, int canvasHeight, int maxTileSize)
+{
+    if (canvasWidth <= 0 || canvasHeight <= 0 || maxTileSize <= 0)
+    {
+        return false;
+    }
+
+    m_canvasWidth = canvasWidth;
+    m_canvasHeight = canvasHeight;
+    m_columns = (canvasWidth + maxTileSize - 1) / maxTileSize;
+    m_rows = (canvasHeight + maxTileSize - 1) / maxTileSize;
+    m_frames = 0;
+
+    // Even splits rather than full tiles plus a sliver, so every tile costs
+    // about the same to update.
+    m_tiles.clear();
+    for (int row = 0; row < m_rows; ++row)
+    {
+        for (int column = 0; column < m_columns; ++column)
+        {
+            m_tiles.push_back({
+                static_cast<int>(static_cast<int64_t>(canvasWidth) * column / m_columns),
+                static_cast<int>(static_cast<int64_t>(canvasHeight) * row / m_rows),
+                static_cast<int>(static_cast<int64_t>(canvasWidth) * (column + 1) / m_columns),
+                static_cast<int>(static_cast<int64_t>(canvasHeight) * (row + 1) / m_rows) });
+        }
+    }
+
+    m_dirty.assign(m_tiles.size(), 1);
+    m_updates.assign(m_tiles.size(), 0);
+    m_submitNs.reset(new FrameHistogram[m_tiles.size()]);
+    m_gpuNs.reset(new FrameHistogram[m_tiles.size()]);
+    return true;
+}
+
+void TiledSurface::Invalidate(const CanvasRect& rect)
+{
+    if (rect.Empty())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_tiles.size(); ++i)
+    {
+        if (m_tiles[i].Overlaps(rect))
+        {
+            m_dirty[i] = 1;
+        }
+    }
+}
+
+void TiledSurface::InvalidateAll()
+{
+    std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(1));
+}
+
+void TiledSurface::RecordUpdate(int tile, uint64_t submitNs)
+{
+    ++m_updates[tile];
+    m_submitNs[tile].Record(submitNs);
+}
+
+void TiledSurface::RecordGpuUpdate(int tile, uint64_t gpuNs)
+{
+    m_gpuNs[tile].Record(gpuNs);
+}
+
+void TiledSurface::EndFrame()
+{
+    ++m_frames;
+    std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(0));
+}
+
+void TiledSurface::Report(std::FILE* out, int bytesPerPixel, bool mipmapped) const
+{
+    std::fprintf(out, "canvas %dx%d in %dx%d tiles, %llu frames\n", m_canvasWidth, m_canvasHeight,
+        m_columns, m_rows, static_cast<unsigned long long>(m_frames));
+    std::fprintf(out, "%4s %6s %6s %6s %6s %8s %10s %10s %10s %10s %9s\n",
+        "tile", "x", "y", "width", "height", "updated", "gpu p50 us", "gpu p99 us", "gpu max us", "submit us",
+        "MB/update");
+
+    // A full mip chain adds a third on top of level 0.
+    const double mipFactor = mipmapped ? 4.0 / 3.0 : 1.0;
+    double gpuMs = 0.0;
+    double submitMs = 0.0;
+    double updateMB = 0.0;
+    for (size_t i = 0; i < m_tiles.size(); ++i)
+    {
+        const CanvasRect& tile = m_tiles[i];
+        const FrameHistogram& gpu = m_gpuNs[i];
+        const FrameHistogram& submit = m_submitNs[i];
+        const double megabytes = static_cast<double>(tile.right - tile.left) * (tile.bottom - tile.top) *
+                                 bytesPerPixel * mipFactor / 1e6;
+        const double updated = m_frames ? 100.0 * m_updates[i] / m_frames : 0.0;
+        std::fprintf(out, "%4zu %6d %6d %6d %6d %7.1f%% %10.1f %10.1f %10.1f %10.1f %9.2f\n", i, tile.left, tile.top,
+            tile.right - tile.left, tile.bottom - tile.top, updated,
+            gpu.ValueAtQuantile(0.50) / 1e3, gpu.ValueAtQuantile(0.99) / 1e3, gpu.MaxNs() / 1e3,
+            submit.ValueAtQuantile(0.50) / 1e3, megabytes);
+
+        // Some updates go untimed on the GPU; their mean stands in for them.
+        gpuMs += gpu.MeanNs() * m_updates[i] / 1e6;
+        submitMs += submit.MeanNs() * m_updates[i] / 1e6;
+        updateMB += megabytes * m_updates[i];
+    }
+
+    if (m_frames)
+    {
+        std::fprintf(out, "per frame: %.3f ms GPU updating tiles (%.3f ms to submit), %.2f MB written\n",
+            gpuMs / m_frames, submitMs / m_frames, updateMB / m_frames);
+    }
+}
+
+CanvasRect ProjectedBounds(const SoftVertex* vertices, int count, const SoftMatrix& matrix,
+                           int canvasWidth, int canvasHeight)
+{
+    const CanvasRect canvas{ 0, 0, canvasWidth, canvasHeight };
+    float minX = 1e30f;
+    float minY = 1e30f;
+    float maxX = -1e30f;
+    float maxY = -1e30f;
+    for (int i = 0; i < count; ++i)
+    {
+        const float* p = vertices[i].position;
+        float clip[4];
+        for (int column = 0; column < 4; ++column)
+        {
+            clip[column] = p[0] * matrix.m[0][column] + p[1] * matrix.m[1][column] +
+                           p[2] * matrix.m[2][column] + matrix.m[3][column];
+        }
+        if (clip[3] <= 0.0f)
+        {
+            return canvas;
+        }
+
+        const float x = (clip[0] / clip[3] * 0.5f + 0.5f) * canvasWidth;
+        const float y = (0.5f - clip[1] / clip[3] * 0.5f) * canvasHeight;
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+
+    // Clamp before converting so far-off vertices cannot overflow an int.
+    auto clampTo = [](float value, int size) { return std::min(std::max(value, -2.0f), size + 2.0f); };
+    CanvasRect bounds{
+        std::max(static_cast<int>(std::floor(clampTo(minX, canvasWidth))) - 1, 0),
+        std::max(static_cast<int>(std::floor(clampTo(minY, canvasHeight))) - 1, 0),
+        std::min(static_cast<int>(std::ceil(clampTo(maxX, canvasWidth))) + 1, canvasWidth),
+        std::min(static_cast<int>(std::ceil(clampTo(maxY, canvasHeight))) + 1, canvasHeight) };
+    if (bounds.Empty())
+    {
+        return CanvasRect{ 0, 0, 0, 0 };
+    }
+    return bounds;
+}
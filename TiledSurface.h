@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "FrameHistogram.h"
+#include "SoftRasterizer.h"
+
+// Pixel rectangle on the canvas, right/bottom exclusive.
+struct CanvasRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    bool Empty() const { return right <= left || bottom <= top; }
+    bool Overlaps(const CanvasRect& other) const
+    {
+        return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+    }
+};
+
+// A canvas too large for one texture, split into a grid of near-equal tiles
+// no larger than maxTileSize on either side. Tiles are updated independently:
+// the producer marks what changed with Invalidate(), re-renders only the
+// dirty tiles and records what each update cost (the CPU time to submit it
+// at once, the GPU time a few frames later), and EndFrame() starts the next
+// frame with every tile clean. The first frame has every tile dirty.
+class TiledSurface
+{
+public:
+    TiledSurface();
+
+    bool Configure(int canvasWidth, int canvasHeight, int maxTileSize);
+
+    int CanvasWidth() const { return m_canvasWidth; }
+    int CanvasHeight() const { return m_canvasHeight; }
+    int Columns() const { return m_columns; }
+    int Rows() const { return m_rows; }
+    int TileCount() const { return static_cast<int>(m_tiles.size()); }
+    const CanvasRect& Tile(int index) const { return m_tiles[index]; }
+
+    void Invalidate(const CanvasRect& rect);
+    void InvalidateAll();
+    bool IsDirty(int tile) const { return m_dirty[tile] != 0; }
+    void RecordUpdate(int tile, uint64_t submitNs);
+    void RecordGpuUpdate(int tile, uint64_t gpuNs);
+    void EndFrame();
+
+    // Per tile: rect, share of frames updated, GPU update time percentiles,
+    // median CPU submit time and bytes written per update (|bytesPerPixel| per texel, mips included
+    // when |mipmapped|), then the totals per frame.
+    void Report(std::FILE* out, int bytesPerPixel, bool mipmapped) const;
+
+private:
+    int m_canvasWidth;
+    int m_canvasHeight;
+    int m_columns;
+    int m_rows;
+    uint64_t m_frames;
+    std::vector<CanvasRect> m_tiles;
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint64_t> m_updates;
+    std::unique_ptr<FrameHistogram[]> m_submitNs;
+    std::unique_ptr<FrameHistogram[]> m_gpuNs;
+};
+
+// Canvas pixels covered by |count| vertices transformed by |matrix| (clip
+// space, D3D viewport conventions), grown by a pixel for rasterization and
+// filtering and clamped to the canvas. A vertex behind the eye makes the
+// bounds the whole canvas.
+CanvasRect ProjectedBounds(const SoftVertex* vertices, int count, const SoftMatrix& matrix,
+                           int canvasWidth, int canvasHeight);
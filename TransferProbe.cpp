@@ -0,0 +1,321 @@
+#include "TransferProbe.h"
+
+#include <dxgi1_2.h>
+#include <winrt/base.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "OpenGLSharedRenderer.h"
+
+using winrt::com_ptr;
+
+static const int kProbeSize = 64;
+static const int kProbeRounds = 2;
+
+// Every channel differs between neighbouring texels and between rounds, so a
+// stale, shifted or channel-swapped texture cannot pass. Alpha stays opaque
+// because rgb10a2 only has two alpha bits.
+static uint8_t PatternValue(int x, int y, int channel, int round)
+{
+    return static_cast<uint8_t>(x * 7 + y * 13 + channel * 61 + round * 101);
+}
+
+// value / 255 as a half float, rounded to nearest even; 0 is the only
+// input below the smallest normal half.
+static uint16_t HalfFromUnorm8(uint8_t value)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    const float f = value / 255.0f;
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    bits += 0x0FFF + ((bits >> 13) & 1);
+    return static_cast<uint16_t>(((((bits >> 23) & 0xFF) - 112) << 10) | ((bits >> 13) & 0x3FF));
+}
+
+static UINT EncodePattern(FrameFormat format, int round, std::vector<uint8_t>& texels)
+{
+    const UINT pitch = static_cast<UINT>(kProbeSize * FramePixelBytes(format));
+    texels.assign(static_cast<size_t>(pitch) * kProbeSize, 0);
+    for (int y = 0; y < kProbeSize; ++y)
+    {
+        uint8_t* row = texels.data() + static_cast<size_t>(y) * pitch;
+        for (int x = 0; x < kProbeSize; ++x)
+        {
+            const uint8_t r = PatternValue(x, y, 0, round);
+            const uint8_t g = PatternValue(x, y, 1, round);
+            const uint8_t b = PatternValue(x, y, 2, round);
+            switch (format)
+            {
+            case FrameFormat::Bgra8:
+            {
+                uint8_t* texel = row + x * 4;
+                texel[0] = b; texel[1] = g; texel[2] = r; texel[3] = 255;
+                break;
+            }
+            case FrameFormat::Rgb10A2:
+            {
+                auto to10 = [](uint8_t v) { return (static_cast<uint32_t>(v) * 1023 + 127) / 255; };
+                const uint32_t texel = to10(r) | (to10(g) << 10) | (to10(b) << 20) | (3u << 30);
+                std::memcpy(row + x * 4, &texel, sizeof(texel));
+                break;
+            }
+            case FrameFormat::Rgba16F:
+            {
+                const uint16_t texel[4] = { HalfFromUnorm8(r), HalfFromUnorm8(g), HalfFromUnorm8(b), 0x3C00 };
+                std::memcpy(row + x * 8, texel, sizeof(texel));
+                break;
+            }
+            default:
+            {
+                uint8_t* texel = row + x * 4;
+                texel[0] = r; texel[1] = g; texel[2] = b; texel[3] = 255;
+                break;
+            }
+            }
+        }
+    }
+    return pitch;
+}
+
+// GL converts every format to RGBA8 on readback; allow one step of rounding.
+static bool MatchesPattern(const std::vector<uint8_t>& rgba, int round, int& badX, int& badY)
+{
+    for (int y = 0; y < kProbeSize; ++y)
+    {
+        for (int x = 0; x < kProbeSize; ++x)
+        {
+            const uint8_t* texel = rgba.data() + (static_cast<size_t>(y) * kProbeSize + x) * 4;
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const int expected = channel == 3 ? 255 : PatternValue(x, y, channel, round);
+                const int difference = texel[channel] - expected;
+                if (difference < -1 || difference > 1)
+                {
+                    badX = x;
+                    badY = y;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// PCI ids of the default adapter (the one InitDX gets), its user-mode driver
+// version and the shared format. Empty when there is no adapter.
+static std::string AdapterIdentity(const char* formatName)
+{
+    com_ptr<IDXGIFactory1> factory;
+    com_ptr<IDXGIAdapter1> adapter;
+    DXGI_ADAPTER_DESC1 desc{};
+    if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(factory.put()))) ||
+        FAILED(factory->EnumAdapters1(0, adapter.put())) ||
+        FAILED(adapter->GetDesc1(&desc)))
+    {
+        return std::string();
+    }
+
+    LARGE_INTEGER driver{};
+    adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver);
+    char identity[160];
+    std::snprintf(identity, sizeof(identity), "%04X:%04X:%08X:%02X/%u.%u.%u.%u/%s",
+        desc.VendorId, desc.DeviceId, desc.SubSysId, desc.Revision,
+        static_cast<unsigned>(driver.HighPart >> 16), static_cast<unsigned>(driver.HighPart & 0xFFFF),
+        static_cast<unsigned>(driver.LowPart >> 16), static_cast<unsigned>(driver.LowPart & 0xFFFF), formatName);
+    return identity;
+}
+
+// Cache lines are "<identity> <verdict> <detail>"; identities have no spaces.
+static bool ReadCachedVerdict(const std::string& path, const std::string& identity, std::string& verdict,
+                              std::string& detail)
+{
+    FILE* in = nullptr;
+    if (fopen_s(&in, path.c_str(), "r") != 0 || !in)
+    {
+        return false;
+    }
+
+    bool found = false;
+    char line[512];
+    while (!found && std::fgets(line, sizeof(line), in))
+    {
+        line[std::strcspn(line, "\r\n")] = '\0';
+        const size_t length = identity.size();
+        if (std::strncmp(line, identity.c_str(), length) != 0 || line[length] != ' ')
+        {
+            continue;
+        }
+
+        const char* rest = line + length + 1;
+        const char* space = std::strchr(rest, ' ');
+        verdict.assign(rest, space ? space - rest : std::strlen(rest));
+        detail = space ? space + 1 : "";
+        found = true;
+    }
+    fclose(in);
+    return found;
+}
+
+static void WriteCachedVerdict(const std::string& path, const std::string& identity, const char* verdict,
+                               const std::string& detail)
+{
+    std::vector<std::string> lines;
+    FILE* file = nullptr;
+    if (fopen_s(&file, path.c_str(), "r") == 0 && file)
+    {
+        char line[512];
+        while (std::fgets(line, sizeof(line), file))
+        {
+            line[std::strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0' && !(std::strncmp(line, identity.c_str(), identity.size()) == 0 &&
+                                     line[identity.size()] == ' '))
+            {
+                lines.push_back(line);
+            }
+        }
+        fclose(file);
+    }
+    lines.push_back(identity + " " + verdict + " " + detail);
+
+    if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+    {
+        return;
+    }
+    for (const std::string& line : lines)
+    {
+        std::fprintf(file, "%s\n", line.c_str());
+    }
+    // The pending marker has to reach the disk before the probe can crash.
+    std::fflush(file);
+    fclose(file);
+}
+
+static bool RunProbe(const TransferProbeSetup& setup, std::string& detail)
+{
+    com_ptr<ID3D11Device> device;
+    com_ptr<ID3D11DeviceContext> context;
+    if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0,
+        D3D11_SDK_VERSION, device.put(), nullptr, context.put())))
+    {
+        detail = "no D3D11 device";
+        return false;
+    }
+
+    // Same flags as the real shared texture.
+    D3D11_TEXTURE2D_DESC desc{};
+    desc.Width = kProbeSize;
+    desc.Height = kProbeSize;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = setup.sharedFormat;
+    desc.SampleDesc.Count = 1;
+    desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+    com_ptr<ID3D11Texture2D> texture;
+    com_ptr<IDXGIResource> resource;
+    HANDLE sharedHandle = nullptr;
+    if (FAILED(device->CreateTexture2D(&desc, nullptr, texture.put())) ||
+        FAILED(texture->QueryInterface(IID_PPV_ARGS(resource.put()))) ||
+        FAILED(resource->GetSharedHandle(&sharedHandle)))
+    {
+        detail = "shared texture creation failed";
+        return false;
+    }
+
+    HWND hWnd = CreateWindow(setup.windowClass, L"Transfer probe", WS_OVERLAPPEDWINDOW,
+        0, 0, kProbeSize, kProbeSize, nullptr, nullptr, setup.instance, nullptr);
+    bool works = false;
+    {
+        OpenGLSharedRenderer renderer(kProbeSize, kProbeSize);
+        if (!hWnd || !renderer.Initialize(hWnd, setup.context))
+        {
+            detail = "no GL context";
+        }
+        else if (!renderer.SetupSharedTexture(device.get(), texture.get(), sharedHandle))
+        {
+            detail = "interop registration failed";
+        }
+        else
+        {
+            const char* glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+            detail = glRenderer ? glRenderer : "";
+            works = true;
+
+            std::vector<uint8_t> texels;
+            std::vector<uint8_t> readback(static_cast<size_t>(kProbeSize) * kProbeSize * 4);
+            for (int round = 0; round < kProbeRounds && works; ++round)
+            {
+                const UINT pitch = EncodePattern(setup.frameFormat, round, texels);
+                context->UpdateSubresource(texture.get(), 0, nullptr, texels.data(), pitch, 0);
+                context->Flush();
+
+                int badX = 0;
+                int badY = 0;
+                if (!renderer.ReadSharedTexture(readback.data(), kProbeSize, kProbeSize))
+                {
+                    detail = "interop readback failed";
+                    works = false;
+                }
+                else if (!MatchesPattern(readback, round, badX, badY))
+                {
+                    char mismatch[96];
+                    std::snprintf(mismatch, sizeof(mismatch), "pattern %d mismatch at %d,%d", round, badX, badY);
+                    detail = mismatch;
+                    works = false;
+                }
+            }
+        }
+        renderer.Cleanup();
+    }
+    if (hWnd)
+    {
+        DestroyWindow(hWnd);
+    }
+
+    for (char& c : detail)
+    {
+        if (c == '\n' || c == '\r')
+        {
+            c = ' ';
+        }
+    }
+    return works;
+}
+
+TransferProbeResult ProbeInteropTransfer(const TransferProbeSetup& setup)
+{
+    TransferProbeResult result{ false, false, AdapterIdentity(setup.formatName), std::string() };
+    const bool cacheable = !result.identity.empty() && !setup.cachePath.empty();
+
+    std::string verdict;
+    if (cacheable && ReadCachedVerdict(setup.cachePath, result.identity, verdict, result.detail))
+    {
+        if (verdict != "pending")
+        {
+            result.interopWorks = verdict == "interop";
+            result.cached = true;
+            return result;
+        }
+
+        // The last probe on this driver never got to write its verdict.
+        result.detail = "previous probe did not finish";
+        WriteCachedVerdict(setup.cachePath, result.identity, "cpu", result.detail);
+        return result;
+    }
+
+    if (cacheable)
+    {
+        WriteCachedVerdict(setup.cachePath, result.identity, "pending", std::string());
+    }
+    result.interopWorks = RunProbe(setup, result.detail);
+    if (cacheable)
+    {
+        WriteCachedVerdict(setup.cachePath, result.identity, result.interopWorks ? "interop" : "cpu", result.detail);
+    }
+    return result;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <string>
+
+#include "VideoFrame.h"
+#include "GLContextOptions.h"
+
+// Startup check for "-transfer auto". WGL_NV_DX_interop2 being advertised
+// says little: depending on driver and GPU, shared textures come out black,
+// stale, or take the driver down. The probe creates its own D3D11 device and
+// a hidden GL window, shares a small texture in the real format, writes two
+// different test patterns from D3D11 and reads each back through the
+// interop lock on the GL side. Interop is used only if both match.
+//
+// Verdicts are cached in a text file, one line per adapter (PCI ids) and
+// user-mode driver version plus format, so a driver update re-probes and
+// later launches only enumerate the adapter. The entry is written as
+// "pending" before the probe runs: if the probe crashes the process, the
+// next launch finds it and records interop as failed.
+struct TransferProbeSetup
+{
+    HINSTANCE instance;
+    const wchar_t* windowClass;
+    DXGI_FORMAT sharedFormat;
+    FrameFormat frameFormat;    // packed layout of sharedFormat
+    const char* formatName;
+    GLContextOptions context;
+    std::string cachePath;
+};
+
+struct TransferProbeResult
+{
+    bool interopWorks;
+    bool cached;
+    std::string identity;   // cache key
+    std::string detail;     // why interop was rejected, or the GL renderer
+};
+
+TransferProbeResult ProbeInteropTransfer(const TransferProbeSetup& setup);
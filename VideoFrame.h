@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class FrameFormat
+{
+    Rgba8,
+    Bgra8,
+    Rgb10A2,    // DXGI R10G10B10A2 / GL_UNSIGNED_INT_2_10_10_10_REV
+    Rgba16F,
+    Nv12,
+    I420,
+};
+
+struct FramePlane
+{
+    uint8_t* data;
+    int pitch;
+};
+
+// A CPU-visible frame. Packed formats (Rgba8, Bgra8, Rgb10A2, Rgba16F) use plane 0; Nv12 uses Y + interleaved UV;
+// I420 uses Y + U + V at quarter resolution.
+struct VideoFrame
+{
+    FrameFormat format;
+    int width;
+    int height;
+    FramePlane planes[3];
+};
+
+inline bool IsYuvFormat(FrameFormat format)
+{
+    return format == FrameFormat::Nv12 || format == FrameFormat::I420;
+}
+
+// Bytes per pixel of plane 0; 1 (luma) for the YUV formats.
+inline int FramePixelBytes(FrameFormat format)
+{
+    switch (format)
+    {
+    case FrameFormat::Rgba16F: return 8;
+    case FrameFormat::Nv12:
+    case FrameFormat::I420:    return 1;
+    default:                   return 4;
+    }
+}
+
+inline int FramePlaneCount(FrameFormat format)
+{
+    switch (format)
+    {
+    case FrameFormat::Nv12: return 2;
+    case FrameFormat::I420: return 3;
+    default:                return 1;
+    }
+}
+
+inline size_t FrameByteSize(FrameFormat format, int width, int height)
+{
+    const size_t pixels = static_cast<size_t>(width) * height;
+    return IsYuvFormat(format) ? pixels + pixels / 2 : pixels * FramePixelBytes(format);
+}
+
+inline const char* FrameFormatName(FrameFormat format)
+{
+    switch (format)
+    {
+    case FrameFormat::Bgra8:   return "bgra8";
+    case FrameFormat::Rgb10A2: return "rgb10a2";
+    case FrameFormat::Rgba16F: return "rgba16f";
+    case FrameFormat::Nv12:    return "nv12";
+    case FrameFormat::I420:    return "i420";
+    default:                   return "rgba8";
+    }
+}
+
+// Lays out tightly packed planes for |format| over |buffer|, which must hold
+// FrameByteSize() bytes.
+inline VideoFrame MakeVideoFrame(FrameFormat format, int width, int height, uint8_t* buffer)
+{
+    VideoFrame frame{ format, width, height, {} };
+    const size_t lumaSize = static_cast<size_t>(width) * height;
+
+    switch (format)
+    {
+    case FrameFormat::Nv12:
+        frame.planes[0] = { buffer, width };
+        frame.planes[1] = { buffer + lumaSize, width };
+        break;
+    case FrameFormat::I420:
+        frame.planes[0] = { buffer, width };
+        frame.planes[1] = { buffer + lumaSize, width / 2 };
+        frame.planes[2] = { buffer + lumaSize + lumaSize / 4, width / 2 };
+        break;
+    default:
+        frame.planes[0] = { buffer, width * FramePixelBytes(format) };
+        break;
+    }
+    return frame;
+}
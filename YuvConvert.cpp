@@ -0,0 +1,270 @@
+#include "YuvConvert.h"
+
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+    inline uint8_t Clamp255(int value)
+    {
+        return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    inline uint8_t LumaOf(int r, int g, int b)
+    {
+        return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    inline uint8_t ChromaUOf(int r, int g, int b)
+    {
+        return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+
+    inline uint8_t ChromaVOf(int r, int g, int b)
+    {
+        return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    // Loads eight RGBA pixels and splits them into 16-bit R, G and B lanes.
+    inline void LoadRgb8(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b)
+    {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+
+        r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+        g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                            _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+        b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                            _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+    }
+
+    // The weighted sum stays below 65536, so a logical shift is exact even
+    // though the intermediate wraps as signed 16-bit.
+    inline __m128i Luma8(__m128i r, __m128i g, __m128i b)
+    {
+        __m128i y = _mm_mullo_epi16(r, _mm_set1_epi16(66));
+        y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+        y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+        y = _mm_add_epi16(y, _mm_set1_epi16(128));
+        y = _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+        return _mm_packus_epi16(y, y);
+    }
+
+    inline __m128i Chroma4(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb)
+    {
+        __m128i c = _mm_mullo_epi16(r, _mm_set1_epi16(cr));
+        c = _mm_add_epi16(c, _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+        c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+        c = _mm_add_epi16(c, _mm_set1_epi16(128));
+        c = _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+        return _mm_packus_epi16(c, c);
+    }
+
+    // Averages 2x2 blocks from two rows of eight 16-bit samples into four.
+    inline __m128i Average2x2(__m128i row0, __m128i row1)
+    {
+        __m128i sum = _mm_madd_epi16(_mm_add_epi16(row0, row1), _mm_set1_epi16(1));
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+        return _mm_packs_epi32(sum, sum);
+    }
+
+    void ScalarRgbaToYuvBlock(const uint8_t* row0, const uint8_t* row1, int x,
+                              uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int uvStep)
+    {
+        const uint8_t* p[4] = { row0 + x * 4, row0 + x * 4 + 4, row1 + x * 4, row1 + x * 4 + 4 };
+        y0[x] = LumaOf(p[0][0], p[0][1], p[0][2]);
+        y0[x + 1] = LumaOf(p[1][0], p[1][1], p[1][2]);
+        y1[x] = LumaOf(p[2][0], p[2][1], p[2][2]);
+        y1[x + 1] = LumaOf(p[3][0], p[3][1], p[3][2]);
+
+        const int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+        const int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+        const int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+        u[(x / 2) * uvStep] = ChromaUOf(r, g, b);
+        v[(x / 2) * uvStep] = ChromaVOf(r, g, b);
+    }
+
+    inline void ScalarYuvToRgba(int y, int u, int v, uint8_t* out)
+    {
+        const int c = 298 * (y - 16);
+        const int d = u - 128;
+        const int e = v - 128;
+        out[0] = Clamp255((c + 409 * e + 128) >> 8);
+        out[1] = Clamp255((c - 100 * d - 208 * e + 128) >> 8);
+        out[2] = Clamp255((c + 516 * d + 128) >> 8);
+        out[3] = 255;
+    }
+
+    // Evaluates (a * ka + b * kb + c * kc + 128) >> 8 for eight 16-bit lanes
+    // in 32-bit precision, so the result rounds exactly like the scalar path.
+    inline __m128i Madd8(__m128i a, __m128i b, short ka, short kb, __m128i c, short kc)
+    {
+        const __m128i kab = _mm_setr_epi16(ka, kb, ka, kb, ka, kb, ka, kb);
+        const __m128i kcb = _mm_setr_epi16(kc, 128, kc, 128, kc, 128, kc, 128);
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), kab),
+                                   _mm_madd_epi16(_mm_unpacklo_epi16(c, one), kcb));
+        __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), kab),
+                                   _mm_madd_epi16(_mm_unpackhi_epi16(c, one), kcb));
+        return _mm_packs_epi32(_mm_srai_epi32(lo, 8), _mm_srai_epi32(hi, 8));
+    }
+
+    // Rows per job when a JobSystem is given; enough work to amortize the
+    // deque operations.
+    const int kRowsPerJob = 32;
+
+    // Row pairs [firstPair, lastPair) of ConvertRgbaToYuv.
+    void RgbaToYuvRows(const uint8_t* rgba, int rgbaPitch, const VideoFrame& dst, int firstPair, int lastPair)
+    {
+        const bool interleaved = (dst.format == FrameFormat::Nv12);
+        const int uvStep = interleaved ? 2 : 1;
+
+        for (int row = firstPair * 2; row < lastPair * 2; row += 2)
+        {
+            const uint8_t* src0 = rgba + static_cast<size_t>(row) * rgbaPitch;
+            const uint8_t* src1 = src0 + rgbaPitch;
+            uint8_t* y0 = dst.planes[0].data + static_cast<size_t>(row) * dst.planes[0].pitch;
+            uint8_t* y1 = y0 + dst.planes[0].pitch;
+            uint8_t* u = dst.planes[1].data + static_cast<size_t>(row / 2) * dst.planes[1].pitch;
+            uint8_t* v = interleaved ? u + 1 : dst.planes[2].data + static_cast<size_t>(row / 2) * dst.planes[2].pitch;
+
+            int x = 0;
+            for (; x + 8 <= dst.width; x += 8)
+            {
+                __m128i r0, g0, b0, r1, g1, b1;
+                LoadRgb8(src0 + x * 4, r0, g0, b0);
+                LoadRgb8(src1 + x * 4, r1, g1, b1);
+
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), Luma8(r0, g0, b0));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), Luma8(r1, g1, b1));
+
+                const __m128i r = Average2x2(r0, r1);
+                const __m128i g = Average2x2(g0, g1);
+                const __m128i b = Average2x2(b0, b1);
+                const __m128i cu = Chroma4(r, g, b, -38, -74, 112);
+                const __m128i cv = Chroma4(r, g, b, 112, -94, -18);
+
+                if (interleaved)
+                {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x), _mm_unpacklo_epi8(cu, cv));
+                }
+                else
+                {
+                    const int u32 = _mm_cvtsi128_si32(cu);
+                    const int v32 = _mm_cvtsi128_si32(cv);
+                    memcpy(u + x / 2, &u32, 4);
+                    memcpy(v + x / 2, &v32, 4);
+                }
+            }
+
+            for (; x < dst.width; x += 2)
+            {
+                ScalarRgbaToYuvBlock(src0, src1, x, y0, y1, u, v, uvStep);
+            }
+        }
+    }
+
+    // Rows [firstRow, lastRow) of ConvertYuvToRgba.
+    void YuvToRgbaRows(const VideoFrame& src, uint8_t* rgba, int rgbaPitch, int firstRow, int lastRow)
+    {
+        const bool interleaved = (src.format == FrameFormat::Nv12);
+        const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+        const __m128i zero = _mm_setzero_si128();
+
+        for (int row = firstRow; row < lastRow; ++row)
+        {
+            const uint8_t* y = src.planes[0].data + static_cast<size_t>(row) * src.planes[0].pitch;
+            const uint8_t* u = src.planes[1].data + static_cast<size_t>(row / 2) * src.planes[1].pitch;
+            const uint8_t* v = interleaved ? u + 1 : src.planes[2].data + static_cast<size_t>(row / 2) * src.planes[2].pitch;
+            uint8_t* out = rgba + static_cast<size_t>(row) * rgbaPitch;
+
+            int x = 0;
+            for (; x + 8 <= src.width; x += 8)
+            {
+                __m128i cu, cv;
+                if (interleaved)
+                {
+                    // UVUVUVUV -> four U and four V samples in 16-bit lanes.
+                    const __m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x)), zero);
+                    cu = _mm_and_si128(uv, _mm_set1_epi32(0xFFFF));
+                    cv = _mm_srli_epi32(uv, 16);
+                    cu = _mm_packs_epi32(cu, cu);
+                    cv = _mm_packs_epi32(cv, cv);
+                }
+                else
+                {
+                    int u32, v32;
+                    memcpy(&u32, u + x / 2, 4);
+                    memcpy(&v32, v + x / 2, 4);
+                    cu = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u32), zero);
+                    cv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v32), zero);
+                }
+
+                // Upsample chroma horizontally, then centre all components.
+                const __m128i d = _mm_sub_epi16(_mm_unpacklo_epi16(cu, cu), _mm_set1_epi16(128));
+                const __m128i e = _mm_sub_epi16(_mm_unpacklo_epi16(cv, cv), _mm_set1_epi16(128));
+                const __m128i c = _mm_sub_epi16(
+                    _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero),
+                    _mm_set1_epi16(16));
+
+                const __m128i r = Madd8(c, e, 298, 409, zero, 0);
+                const __m128i g = Madd8(c, d, 298, -100, e, -208);
+                const __m128i b = Madd8(c, d, 298, 516, zero, 0);
+
+                const __m128i r8 = _mm_packus_epi16(r, r);
+                const __m128i g8 = _mm_packus_epi16(g, g);
+                const __m128i b8 = _mm_packus_epi16(b, b);
+                const __m128i rg = _mm_unpacklo_epi8(r8, g8);
+                const __m128i ba = _mm_unpacklo_epi8(b8, alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+
+            const int uvStep = interleaved ? 2 : 1;
+            for (; x < src.width; ++x)
+            {
+                ScalarYuvToRgba(y[x], u[(x / 2) * uvStep], v[(x / 2) * uvStep], out + x * 4);
+            }
+        }
+    }
+}
+
+bool ConvertRgbaToYuv(const uint8_t* rgba, int rgbaPitch, const VideoFrame& dst, JobSystem* jobs)
+{
+    if (!rgba || !IsYuvFormat(dst.format) || (dst.width & 1) || (dst.height & 1))
+    {
+        return false;
+    }
+
+    const int pairs = dst.height / 2;
+    if (!jobs)
+    {
+        RgbaToYuvRows(rgba, rgbaPitch, dst, 0, pairs);
+        return true;
+    }
+    jobs->ParallelFor(pairs, kRowsPerJob / 2, [&](int first, int last)
+    {
+        RgbaToYuvRows(rgba, rgbaPitch, dst, first, last);
+    });
+    return true;
+}
+
+bool ConvertYuvToRgba(const VideoFrame& src, uint8_t* rgba, int rgbaPitch, JobSystem* jobs)
+{
+    if (!rgba || !IsYuvFormat(src.format) || (src.width & 1) || (src.height & 1))
+    {
+        return false;
+    }
+
+    if (!jobs)
+    {
+        YuvToRgbaRows(src, rgba, rgbaPitch, 0, src.height);
+        return true;
+    }
+    jobs->ParallelFor(src.height, kRowsPerJob, [&](int first, int last)
+    {
+        YuvToRgbaRows(src, rgba, rgbaPitch, first, last);
+    });
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "VideoFrame.h"
+#include "JobSystem.h"
+
+// BT.601 limited-range conversions between packed RGBA and planar YUV.
+// Width and height must be even. The SSE2 kernels handle eight pixels per
+// step and fall back to scalar code for the remaining columns. With |jobs|
+// the rows are split across the job system.
+
+bool ConvertRgbaToYuv(const uint8_t* rgba, int rgbaPitch, const VideoFrame& dst, JobSystem* jobs = nullptr);
+bool ConvertYuvToRgba(const VideoFrame& src, uint8_t* rgba, int rgbaPitch, JobSystem* jobs = nullptr);